@@ -0,0 +1,73 @@
+// Score an exam file into a text file of scores, one per line, with the
+// reading, the scoring and the writing overlapped by a ScoringSession:
+//
+//   score_exam_file <exams file> <answer key, e.g. ABCD...> <scores file>
+//
+// Every question is worth one point.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "answer_parser.h"
+#include "exam_file.h"
+#include "parallel_scorer.hpp"
+#include "scoring_session.hpp"
+
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    std::fprintf(stderr,
+                 "Usage: %s <exams file> <answer key> <scores file>\n",
+                 argv[0]);
+    return 1;
+  }
+
+  try {
+    const ExamFile exams(argv[1]);
+    const std::string key = argv[2];
+    const auto key_batch = parse_answer_sheets(key.data(), key.size(),
+                                               exams.question_count());
+    ByteArray correct_answers(exams.question_count());
+    std::copy_n(key_batch.data(), exams.question_count(),
+                correct_answers.data());
+    const ByteArray points(exams.question_count(), 1);
+
+    FILE *output = std::fopen(argv[3], "w");
+    if (!output) {
+      throw std::runtime_error(std::string("Failed to open ") + argv[3]);
+    }
+
+    // The write stage, on the session's completion thread
+    auto write_scores = [&](const Scorer::ScoringChunk &chunk) {
+      for (size_t i = 0; i < chunk.exam_count; ++i) {
+        std::fprintf(output, "%d\n", chunk.scores[i]);
+      }
+    };
+
+    Scorer::ScoringSession session(
+        std::make_shared<Scorer::ParallelScorer>(Scorer::make_best_scorer()),
+        correct_answers, points, write_scores);
+
+    // The read stage, on this thread
+    for (size_t first = 0; first < exams.exam_count();
+         first += session.chunk_exams()) {
+      auto &chunk = session.acquire();
+      chunk.exam_count =
+          std::min(session.chunk_exams(), exams.exam_count() - first);
+      std::memcpy(chunk.exams.data(), exams.row(first),
+                  chunk.exam_count * exams.pitch());
+      session.submit(chunk);
+    }
+
+    session.close();
+    if (std::fclose(output) != 0) {
+      throw std::runtime_error(std::string("Failed to write ") + argv[3]);
+    }
+  } catch (const std::exception &error) {
+    std::fprintf(stderr, "%s\n", error.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,290 @@
+#ifndef ADAPTIVE_SCORER_HPP
+#define ADAPTIVE_SCORER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "scorers.hpp"
+
+namespace Scorer {
+// Scores with whichever kernel was the fastest on this machine for the shape
+// of the batch. The shapes are split into buckets (powers of 8 exams by powers
+// of 4 questions), and the first call that falls in a bucket times every
+// kernel that the CPU supports on generated exams of that bucket's shape. The
+// winners are kept for the life of the scorer and, given a cache file, saved
+// to it and loaded by the next scorers so that they skip the calibration.
+// After that, a call costs the bucket lookup and one virtual call more than
+// the kernel itself.
+class AdaptiveScorer final : public BaseScorer {
+ public:
+  static constexpr size_t kExamBuckets = 7;
+  static constexpr size_t kQuestionBuckets = 7;
+  static constexpr size_t kBucketCount = kExamBuckets * kQuestionBuckets;
+
+ private:
+  static constexpr uint8_t kUncalibrated = 0xff;
+  // The largest calibration batch, capped so that the calibration of the
+  // largest buckets stays short
+  static constexpr size_t kCalibrationBytes = size_t{4} << 20;
+  // The shortest timed run, repeated with more calls below it
+  static constexpr std::chrono::microseconds kMinRunTime{50};
+  static constexpr const char *kCacheHeader = "adaptive-scorer 1";
+
+  struct Candidate {
+    std::string name;
+    std::shared_ptr<BaseScorer> kernel;
+  };
+
+  std::vector<Candidate> _candidates;
+  // The index in _candidates of the winner of every bucket
+  std::array<std::atomic<uint8_t>, kBucketCount> _winners;
+  std::string _cache_path;
+  std::mutex _calibration;
+
+  template <typename Kernel>
+  void add_candidate(const char *name) {
+    auto kernel = std::make_shared<Kernel>();
+    try {
+      kernel->ensure_cpu_support();
+    } catch (const std::runtime_error &) {
+      return;
+    }
+    _candidates.push_back({name, std::move(kernel)});
+  }
+
+ public:
+  // Without `cache_path`, every scorer calibrates from scratch. With it, the
+  // winners saved there are loaded, and every new calibration is saved.
+  explicit AdaptiveScorer(std::string cache_path = {})
+      : _cache_path(std::move(cache_path)) {
+    add_candidate<NaiveScorer>("naive");
+    add_candidate<BooleanMultiplicationScorer>("boolean");
+    add_candidate<SimdSse41Scorer>("sse41");
+    add_candidate<SimdScorer>("avx2");
+    add_candidate<SimdAvx512Scorer>("avx512");
+    add_candidate<SimdAvx512BlockedScorer>("avx512_blocked");
+
+    for (auto &winner : _winners) {
+      winner.store(kUncalibrated, std::memory_order_relaxed);
+    }
+    if (!_cache_path.empty()) {
+      load(_cache_path);
+    }
+  }
+
+  static size_t bucket(const size_t &exam_count, const size_t &question_count) {
+    const size_t exams =
+        std::min<size_t>(std::bit_width(exam_count) / 3, kExamBuckets - 1);
+    const size_t questions = std::min<size_t>(
+        std::bit_width(question_count) / 2, kQuestionBuckets - 1);
+    return questions * kExamBuckets + exams;
+  }
+
+  // The kernel that scores `exam_count` exams of `question_count` questions,
+  // calibrating their bucket first if needed (so it can be called ahead of
+  // time just to calibrate)
+  BaseScorer &kernel(const size_t &exam_count, const size_t &question_count) {
+    const size_t index = bucket(exam_count, question_count);
+    uint8_t winner = _winners[index].load(std::memory_order_acquire);
+    if (winner == kUncalibrated) {
+      winner = calibrate(index);
+    }
+    return *_candidates[winner].kernel;
+  }
+
+  [[nodiscard]] bool is_calibrated(const size_t &exam_count,
+                                   const size_t &question_count) const {
+    return _winners[bucket(exam_count, question_count)].load(
+               std::memory_order_acquire) != kUncalibrated;
+  }
+
+  // The name of the winner for the shape, empty if its bucket isn't
+  // calibrated yet
+  [[nodiscard]] std::string kernel_name(const size_t &exam_count,
+                                        const size_t &question_count) const {
+    const uint8_t winner = _winners[bucket(exam_count, question_count)].load(
+        std::memory_order_acquire);
+    return winner == kUncalibrated ? std::string()
+                                   : _candidates[winner].name;
+  }
+
+  // Calibrate every bucket that isn't yet, e.g. before saving the cache
+  void calibrate_all() {
+    for (size_t index = 0; index < kBucketCount; ++index) {
+      if (_winners[index].load(std::memory_order_acquire) == kUncalibrated) {
+        calibrate(index);
+      }
+    }
+  }
+
+  // Save the winners of the calibrated buckets to `path`, one
+  // "<exam bucket> <question bucket> <kernel>" line each. Returns false if
+  // the file can't be written.
+  bool save(const std::string &path) const {
+    const std::string temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary);
+      file << kCacheHeader << '\n';
+      for (size_t index = 0; index < kBucketCount; ++index) {
+        const uint8_t winner = _winners[index].load(std::memory_order_acquire);
+        if (winner != kUncalibrated) {
+          file << index % kExamBuckets << ' ' << index / kExamBuckets << ' '
+               << _candidates[winner].name << '\n';
+        }
+      }
+      if (!file) {
+        return false;
+      }
+    }
+    // Readers never see a partially written cache
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+  }
+
+  // Load the winners saved to `path`. The lines of kernels this CPU doesn't
+  // support (a cache copied from another machine) or that can't be parsed
+  // are skipped, and their buckets are calibrated again. Returns the number of
+  // buckets loaded.
+  size_t load(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line) || line != kCacheHeader) {
+      return 0;
+    }
+
+    size_t loaded = 0;
+    while (std::getline(file, line)) {
+      std::istringstream fields(line);
+      size_t exams, questions;
+      std::string name;
+      if (!(fields >> exams >> questions >> name) || exams >= kExamBuckets ||
+          questions >= kQuestionBuckets) {
+        continue;
+      }
+      for (size_t c = 0; c < _candidates.size(); ++c) {
+        if (_candidates[c].name == name) {
+          _winners[questions * kExamBuckets + exams].store(
+              static_cast<uint8_t>(c), std::memory_order_release);
+          ++loaded;
+          break;
+        }
+      }
+    }
+    return loaded;
+  }
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    kernel(last - first, correct_answers.size())
+        .score_range(exams, first, last, correct_answers, points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    kernel(count, correct_answers.size())
+        .score_rows(rows, pitch, count, correct_answers, points, out);
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    kernel(count, correct_answers.size())
+        .score_row_pointers(rows, count, correct_answers, points, out);
+  }
+
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    kernel(exams.exam_count(), correct_answers.size())
+        .score_view(exams, correct_answers, points, out);
+  }
+
+ private:
+  // Time every candidate on a batch of the bucket's shape and keep the
+  // fastest. Concurrent callers of the same bucket wait for the first one.
+  uint8_t calibrate(const size_t &index) {
+    const std::lock_guard lock(_calibration);
+    uint8_t winner = _winners[index].load(std::memory_order_acquire);
+    if (winner != kUncalibrated) {
+      return winner;
+    }
+
+    // Halfway through the bucket, in log scale
+    const size_t exam_bucket = index % kExamBuckets;
+    const size_t question_bucket = index / kExamBuckets;
+    const size_t question_count =
+        question_bucket == 0 ? 1 : size_t{3} << (2 * question_bucket - 1);
+    const size_t pitch = (question_count + 63) / 64 * 64;
+    const size_t exam_count =
+        std::min(size_t{2} << (3 * exam_bucket),
+                 std::max<size_t>(1, kCalibrationBytes / pitch));
+
+    const auto correct_answers = generate_correct_answers(question_count, 1);
+    const auto points = generate_points(question_count);
+    const auto exams = generate_exam_batch(exam_count, correct_answers, 2);
+    std::vector<int32_t> scores(exam_count);
+
+    double best_time = std::numeric_limits<double>::infinity();
+    for (size_t c = 0; c < _candidates.size(); ++c) {
+      const double time =
+          time_kernel(*_candidates[c].kernel, exams, correct_answers, points,
+                      scores.data());
+      if (time < best_time) {
+        best_time = time;
+        winner = static_cast<uint8_t>(c);
+      }
+    }
+
+    _winners[index].store(winner, std::memory_order_release);
+    if (!_cache_path.empty()) {
+      // The cache is only an optimization, scoring goes on without it
+      save(_cache_path);
+    }
+    return winner;
+  }
+
+  // The best time of a call over 3 runs, each of enough calls to last
+  // kMinRunTime
+  static double time_kernel(BaseScorer &kernel, const ExamBatch &exams,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points, int32_t *out) {
+    using Clock = std::chrono::steady_clock;
+    const auto run = [&](const size_t &calls) {
+      const auto start = Clock::now();
+      for (size_t i = 0; i < calls; ++i) {
+        kernel.score_rows(exams.data(), exams.pitch(), exams.exam_count(),
+                          correct_answers, points, out);
+      }
+      return Clock::now() - start;
+    };
+
+    size_t calls = 1;
+    auto elapsed = run(calls);
+    while (elapsed < kMinRunTime) {
+      calls *= 4;
+      elapsed = run(calls);
+    }
+
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      elapsed = std::min(elapsed, run(calls));
+    }
+    return std::chrono::duration<double>(elapsed).count() /
+           static_cast<double>(calls);
+  }
+};
+}  // namespace Scorer
+
+#endif
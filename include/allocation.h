@@ -0,0 +1,62 @@
+#ifndef ALLOCATION_H_INCLUDED
+#define ALLOCATION_H_INCLUDED
+
+#include <cstddef>
+
+// Where the pages of a large buffer are placed on a multi-socket machine
+enum class NumaPlacement {
+  // Wherever the thread that first writes a page runs (the kernel's default)
+  kDefault,
+  // Round-robin over the memory nodes, so that threads on every socket get
+  // the same bandwidth
+  kInterleave,
+  // Each of `first_touch_threads` threads touches one contiguous slice of the
+  // buffer, in the order a ParallelScorer splits it, pinned to the CPU of the
+  // matching worker of a ParallelScorer with `pin_threads`, so every slice is
+  // local to the thread that scores it
+  kParallelFirstTouch,
+};
+
+// How the storage of a ByteArray or an ExamBatch is allocated. The defaults
+// are a plain zero-filled heap allocation. Every option falls back to the
+// default behavior when the system doesn't support it.
+struct AllocationOptions {
+  // Back the buffer with 2 MiB pages: from the reserved hugetlbfs pool
+  // (MAP_HUGETLB) when it has room, else transparent huge pages
+  // (madvise(MADV_HUGEPAGE)), to cut the TLB misses of large batches
+  bool huge_pages = false;
+  // With false, the caller overwrites every answer, so only the padding
+  // (which the kernels read) is zeroed, not the whole buffer
+  bool zero_fill = true;
+  NumaPlacement numa = NumaPlacement::kDefault;
+  // For kParallelFirstTouch, 0 for one per hardware thread
+  size_t first_touch_threads = 0;
+
+  [[nodiscard]] bool is_default() const {
+    return !huge_pages && zero_fill && numa == NumaPlacement::kDefault;
+  }
+};
+
+// A buffer of `bytes` bytes, 64-byte aligned. Mapped buffers (huge pages, NUMA
+// placement) are zeroed by the kernel, heap ones only with `zero_fill`.
+struct Allocation {
+  void *data = nullptr;
+  size_t bytes = 0;
+  // The length of the mapping to munmap, 0 for a heap allocation
+  size_t mapped_bytes = 0;
+  // Whether the pages came from the hugetlbfs pool, or were advised to be
+  // transparent huge pages
+  bool hugetlb = false;
+  bool transparent_huge_pages = false;
+  // Whether the NUMA placement was applied: the pages were interleaved, or
+  // every first-touch thread was pinned to its CPU
+  bool numa_placed = false;
+};
+
+// Throws std::runtime_error if even the fallback allocation fails
+Allocation allocate_buffer(const size_t &bytes,
+                           const AllocationOptions &options);
+// Free the `data` of an Allocation, mapped over `mapped_bytes`
+void free_buffer(void *data, const size_t &mapped_bytes);
+
+#endif
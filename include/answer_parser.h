@@ -0,0 +1,53 @@
+#ifndef ANSWER_PARSER_H_INCLUDED
+#define ANSWER_PARSER_H_INCLUDED
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "exam.h"
+
+// Where a text answer sheet went wrong: `byte` is the offending byte of exam
+// `exam` at question `question`. A line that is too short reports its '\n'
+// at the first missing question, and a line that is too long reports its
+// first extra byte at question `question_count`.
+struct AnswerSheetError {
+  size_t exam;
+  size_t question;
+  char byte;
+};
+
+class AnswerSheetParseError : public std::runtime_error {
+ private:
+  AnswerSheetError _error;
+
+ public:
+  explicit AnswerSheetParseError(const AnswerSheetError &error)
+      : std::runtime_error("Invalid answer sheet byte " +
+                           std::to_string(static_cast<int>(error.byte)) +
+                           " in exam " + std::to_string(error.exam) +
+                           ", question " + std::to_string(error.question)),
+        _error(error) {}
+
+  [[nodiscard]] const AnswerSheetError &error() const { return _error; }
+};
+
+// Parse text answer sheets, one exam per line ('\n' or "\r\n" terminated, the
+// last line may be unterminated) of exactly `question_count` answers, each
+// one of 'A', 'B', 'C', 'D' or ' ' (blank). The lines are validated while
+// they are copied straight into the batch, 32 bytes at a time with AVX2.
+//
+// Without `errors`, the first invalid byte throws an AnswerSheetParseError.
+// Otherwise every invalid byte is appended to `errors` and stored as a blank,
+// and missing answers are blanks too.
+ExamBatch parse_answer_sheets(const char *text, const size_t &length,
+                              const size_t &question_count,
+                              std::vector<AnswerSheetError> *errors = nullptr);
+// The same, into the first rows of an existing batch (e.g. one that is reused
+// across chunks of text), and returns the number of exams parsed. The rows
+// past the last line are left untouched.
+size_t parse_answer_sheets(const char *text, const size_t &length,
+                           ExamBatch &exams,
+                           std::vector<AnswerSheetError> *errors = nullptr);
+
+#endif
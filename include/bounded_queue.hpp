@@ -0,0 +1,134 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// A lock-free, fixed-capacity multi-producer multi-consumer queue (Dmitry
+// Vyukov's bounded queue): every cell carries a sequence number that tells
+// the producers and the consumers whose turn it is, so a push or a pop is a
+// single CAS on the head or the tail. It is meant for small trivially
+// copyable items, such as the pointers that the stages of a ScoringSession
+// hand to each other.
+//
+// The blocking push() and pop() wait on a counter of the pops (resp. pushes)
+// with std::atomic::wait, i.e. a futex, instead of spinning.
+template <typename T>
+class BoundedQueue {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ private:
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask;
+  alignas(64) std::atomic<size_t> _head = 0;
+  alignas(64) std::atomic<size_t> _tail = 0;
+  alignas(64) std::atomic<uint32_t> _pushes = 0;
+  alignas(64) std::atomic<uint32_t> _pops = 0;
+
+ public:
+  // The capacity is rounded up to a power of 2
+  explicit BoundedQueue(const size_t &capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _cells = std::make_unique<Cell[]>(size);
+    _mask = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  [[nodiscard]] size_t capacity() const { return _mask + 1; }
+
+  // Push `value` unless the queue is full
+  bool try_push(const T &value) {
+    size_t position = _head.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = _cells[position & _mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+      if (difference == 0) {
+        if (_head.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          _pushes.fetch_add(1, std::memory_order_release);
+          _pushes.notify_all();
+          return true;
+        }
+      } else if (difference < 0) {
+        // The consumers haven't emptied this cell yet
+        return false;
+      } else {
+        position = _head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Pop the oldest value into `value` unless the queue is empty
+  bool try_pop(T &value) {
+    size_t position = _tail.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = _cells[position & _mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position + 1);
+
+      if (difference == 0) {
+        if (_tail.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          value = cell.value;
+          cell.sequence.store(position + _mask + 1, std::memory_order_release);
+          _pops.fetch_add(1, std::memory_order_release);
+          _pops.notify_all();
+          return true;
+        }
+      } else if (difference < 0) {
+        // The producers haven't filled this cell yet
+        return false;
+      } else {
+        position = _tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Push `value`, waiting for room if the queue is full
+  void push(const T &value) {
+    while (true) {
+      // Read the counter first, so that a pop between the failed try and the
+      // wait changes it and the wait returns right away
+      const uint32_t pops = _pops.load(std::memory_order_acquire);
+      if (try_push(value)) {
+        return;
+      }
+      _pops.wait(pops, std::memory_order_acquire);
+    }
+  }
+
+  // Pop the oldest value, waiting for one if the queue is empty
+  T pop() {
+    T value;
+    while (true) {
+      const uint32_t pushes = _pushes.load(std::memory_order_acquire);
+      if (try_pop(value)) {
+        return value;
+      }
+      _pushes.wait(pushes, std::memory_order_acquire);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+
+// GCC 12 warns about the placeholder operands inside some AVX-512 intrinsics
+// once they are inlined into a target attribute function (GCC bug 105593).
+// Every header gets the intrinsics from here, so the warning stays silenced.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+
+// The project is built for baseline x86-64, and every SIMD kernel opts into
+// its instruction set with one of these attributes. The kernels must only be
+// called after checking the matching `Cpu::supports_*` function.
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 \
+  __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq")))
+#define SIMD_TARGET_AVX512_VPOPCNTDQ \
+  __attribute__((target("avx512f,avx512vpopcntdq")))
+#define SIMD_TARGET_AVX512_VNNI \
+  __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx512vnni")))
+#define SIMD_TARGET_POPCNT __attribute__((target("popcnt")))
+// Every CPU with AVX-512 has POPCNT, so supports_avx512() covers both
+#define SIMD_TARGET_AVX512_POPCNT \
+  __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,popcnt")))
+
+namespace Cpu {
+inline bool supports_sse41() { return __builtin_cpu_supports("sse4.1"); }
+
+inline bool supports_avx2() { return __builtin_cpu_supports("avx2"); }
+
+inline bool supports_avx512() {
+  return __builtin_cpu_supports("avx512bw") &&
+         __builtin_cpu_supports("avx512vl") &&
+         __builtin_cpu_supports("avx512f") &&
+         __builtin_cpu_supports("avx512dq");
+}
+
+inline bool supports_avx512_vpopcntdq() {
+  return __builtin_cpu_supports("avx512f") &&
+         __builtin_cpu_supports("avx512vpopcntdq");
+}
+
+inline bool supports_avx512_vnni() {
+  return supports_avx512() && __builtin_cpu_supports("avx512vnni");
+}
+
+inline bool supports_popcnt() { return __builtin_cpu_supports("popcnt"); }
+}  // namespace Cpu
+
+#endif
@@ -1,42 +1,56 @@
 #ifndef EXAM_H_INCLUDED
 #define EXAM_H_INCLUDED
 
-#include <immintrin.h>
-
+#include <array>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <stdexcept>
 #include <vector>
 
+#include "allocation.h"
+#include "cpu.hpp"
+
 class ByteArray {
  private:
   size_t _size;
   size_t _capacity;
   size_t _block_count;
   int8_t *_values;
+  // Non-zero for the buffers mapped by allocate_buffer
+  size_t _mapped_bytes = 0;
 
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
-  bool _avx512 = true;
-#else
-  bool _avx512 = false;
-#endif
-
-  void construct(const size_t &size) {
+  void construct(const size_t &size, const AllocationOptions &options = {}) {
     _size = size;
-#if defined(__AVX2__) && !(defined(__AVX512BW__) && defined(__AVX512VL__) && \
-                           defined(__AVX512F__) && defined(__AVX512DQ__))
-    _block_count = (_size >> 5) + ((_size & 31) != 0);
-    _capacity = _block_count << 5;
-#else
+    // Always pad to 64 bytes, so that the same array can be used by every
+    // kernel that the CPU dispatch might pick at runtime
     _block_count = (_size >> 6) + ((_size & 63) != 0);
     _capacity = _block_count << 6;
-#endif
-    _values = static_cast<int8_t *>(calloc(_capacity, sizeof(int8_t)));
-    if (!_values) {
-      throw std::runtime_error("Failed to allocate memory for ByteArray");
+    _mapped_bytes = 0;
+
+    if (options.is_default()) {
+      _values = static_cast<int8_t *>(calloc(_capacity, sizeof(int8_t)));
+      if (!_values) {
+        throw std::runtime_error("Failed to allocate memory for ByteArray");
+      }
+      return;
+    }
+
+    const Allocation allocation = allocate_buffer(_capacity, options);
+    _values = static_cast<int8_t *>(allocation.data);
+    _mapped_bytes = allocation.mapped_bytes;
+    if (!options.zero_fill && _mapped_bytes == 0) {
+      // The kernels read the padding
+      std::memset(_values + _size, 0, _capacity - _size);
     }
   }
 
+  void release() {
+    free_buffer(_values, _mapped_bytes);
+    _values = nullptr;
+    _mapped_bytes = 0;
+  }
+
  public:
   // Initialize an empty ByteArray
   ByteArray() : _size(0), _capacity(0), _block_count(0), _values(nullptr) {}
@@ -44,6 +58,12 @@ class ByteArray {
   explicit ByteArray(const size_t &size) {  // NOLINT(*-pro-type-member-init)
     construct(size);
   }
+  // Initialize a ByteArray with `size`, allocated with `options` (e.g. huge
+  // pages, or without zero-filling the values that the caller overwrites)
+  ByteArray(const size_t &size,  // NOLINT(*-pro-type-member-init)
+            const AllocationOptions &options) {
+    construct(size, options);
+  }
 
   // Initializer list constructor
   ByteArray(                               // NOLINT(*-pro-type-member-init)
@@ -78,8 +98,10 @@ class ByteArray {
       : _size(other._size),
         _capacity(other._capacity),
         _block_count(other._block_count),
-        _values(other._values) {
+        _values(other._values),
+        _mapped_bytes(other._mapped_bytes) {
     other._values = nullptr;
+    other._mapped_bytes = 0;
     other._size = 0;
     other._capacity = 0;
     other._block_count = 0;
@@ -88,7 +110,7 @@ class ByteArray {
   // Copy assignment operator
   ByteArray &operator=(const ByteArray &other) {
     if (this != &other) {
-      free(_values);
+      release();
       construct(other._size);
       std::memcpy(_values, other._values, other._size * sizeof(int8_t));
     }
@@ -98,12 +120,14 @@ class ByteArray {
   // Move assignment operator
   ByteArray &operator=(ByteArray &&other) noexcept {
     if (this != &other) {
-      free(_values);
+      release();
       _size = other._size;
       _capacity = other._capacity;
       _block_count = other._block_count;
       _values = other._values;
+      _mapped_bytes = other._mapped_bytes;
       other._values = nullptr;
+      other._mapped_bytes = 0;
       other._size = 0;
       other._capacity = 0;
       other._block_count = 0;
@@ -117,33 +141,663 @@ class ByteArray {
   // Getters
   [[nodiscard]] size_t capacity() const { return _capacity; }
   [[nodiscard]] size_t size() const { return _size; }
-  [[nodiscard]] size_t block_count_avx2() const {
-    // ReSharper disable once CppDFAConstantConditions
-    return _avx512 ? _block_count << 1 : _block_count;
+  [[nodiscard]] size_t block_count_sse41() const { return _block_count << 2; }
+  [[nodiscard]] size_t block_count_avx2() const { return _block_count << 1; }
+  [[nodiscard]] size_t block_count_avx512() const { return _block_count; }
+
+  // Get the `values` array for direct access
+  [[nodiscard]] int8_t *data() const { return _values; }
+
+  // Iterators
+  [[nodiscard]] int8_t *begin() const { return _values; }
+  [[nodiscard]] int8_t *end() const { return _values + _size; }
+
+  ~ByteArray() {
+    if (_values) release();
+  }
+};
+
+// An array of `T` points (or penalties), one per question. Like a ByteArray,
+// it is zero-padded up to a multiple of 64 elements, so a kernel can read the
+// points of a whole 64-byte block of answers. The buffer is 64-byte aligned.
+template <typename T>
+class PointArray {
+ private:
+  size_t _size;
+  size_t _capacity;
+  T *_values;
+
+  void construct(const size_t &size) {
+    _size = size;
+    _capacity = ((_size >> 6) + ((_size & 63) != 0)) << 6;
+    _values = nullptr;
+
+    if (_capacity == 0) {
+      return;
+    }
+
+    _values = static_cast<T *>(std::aligned_alloc(64, _capacity * sizeof(T)));
+    if (!_values) {
+      throw std::runtime_error("Failed to allocate memory for PointArray");
+    }
+    std::memset(_values, 0, _capacity * sizeof(T));
+  }
+
+ public:
+  // Initialize an empty PointArray
+  PointArray() : _size(0), _capacity(0), _values(nullptr) {}
+  // Initialize a PointArray of `size` zeroes
+  explicit PointArray(const size_t &size) {  // NOLINT(*-pro-type-member-init)
+    construct(size);
+  }
+
+  // Initialize a PointArray with `size`, filled with `value`
+  PointArray(const size_t &size,  // NOLINT(*-pro-type-member-init)
+             const T &value) {
+    construct(size);
+    std::fill_n(_values, _size, value);
   }
-  [[nodiscard]] size_t block_count_avx512() const {
-    // ReSharper disable once CppDFAConstantConditions
-    if (!_avx512) {
-      throw std::runtime_error("AVX512 is not supported");
+
+  // Initializer list constructor
+  PointArray(  // NOLINT(*-pro-type-member-init)
+      const std::initializer_list<T> &list) {
+    construct(list.size());
+    std::copy(list.begin(), list.end(), _values);
+  }
+
+  // Copy constructor
+  PointArray(const PointArray &other) {  // NOLINT(*-pro-type-member-init)
+    construct(other._size);
+    if (_values) {
+      std::memcpy(_values, other._values, _size * sizeof(T));
     }
-    return _block_count;
   }
 
+  // Move constructor
+  PointArray(PointArray &&other) noexcept
+      : _size(other._size), _capacity(other._capacity), _values(other._values) {
+    other._values = nullptr;
+    other._size = 0;
+    other._capacity = 0;
+  }
+
+  // Copy assignment operator
+  PointArray &operator=(const PointArray &other) {
+    if (this != &other) {
+      std::free(_values);
+      construct(other._size);
+      if (_values) {
+        std::memcpy(_values, other._values, _size * sizeof(T));
+      }
+    }
+    return *this;
+  }
+
+  // Move assignment operator
+  PointArray &operator=(PointArray &&other) noexcept {
+    if (this != &other) {
+      std::free(_values);
+      _size = other._size;
+      _capacity = other._capacity;
+      _values = other._values;
+      other._values = nullptr;
+      other._size = 0;
+      other._capacity = 0;
+    }
+    return *this;
+  }
+
+  // Operators
+  T &operator[](const size_t &index) const { return _values[index]; }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _size; }
+  // The number of elements, padding included (a multiple of 64)
+  [[nodiscard]] size_t capacity() const { return _capacity; }
+
   // Get the `values` array for direct access
+  [[nodiscard]] T *data() const { return _values; }
+
+  // Iterators
+  [[nodiscard]] T *begin() const { return _values; }
+  [[nodiscard]] T *end() const { return _values + _size; }
+
+  ~PointArray() { std::free(_values); }
+};
+
+// A non-owning view over one exam (row) inside an ExamBatch
+class ExamRow {
+ private:
+  int8_t *_values;
+  size_t _size;
+
+ public:
+  ExamRow(int8_t *values, const size_t &size) : _values(values), _size(size) {}
+
+  // Operators
+  int8_t &operator[](const size_t &index) const { return _values[index]; }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _size; }
   [[nodiscard]] int8_t *data() const { return _values; }
 
   // Iterators
   [[nodiscard]] int8_t *begin() const { return _values; }
   [[nodiscard]] int8_t *end() const { return _values + _size; }
+};
 
-  ~ByteArray() {
-    if (_values) free(_values);
+// A batch of exams stored in a single contiguous, 64-byte aligned, row-major
+// buffer. Every row is padded up to `pitch()` bytes (a multiple of 64) and the
+// padding is zero-filled, so the SIMD scorers can read whole blocks of any row
+// just like they do with a ByteArray.
+class ExamBatch {
+ private:
+  size_t _exam_count;
+  size_t _question_count;
+  size_t _pitch;
+  int8_t *_values;
+  // Non-zero for the buffers mapped by allocate_buffer
+  size_t _mapped_bytes = 0;
+
+  void construct(const size_t &exam_count, const size_t &question_count,
+                 const AllocationOptions &options = {}) {
+    _exam_count = exam_count;
+    _question_count = question_count;
+    _pitch = ((_question_count >> 6) + ((_question_count & 63) != 0)) << 6;
+    _values = nullptr;
+    _mapped_bytes = 0;
+
+    const size_t bytes = _exam_count * _pitch;
+    if (bytes == 0) {
+      return;
+    }
+
+    if (options.is_default()) {
+      // std::aligned_alloc requires the size to be a multiple of the
+      // alignment, which is always the case since the pitch is a multiple of
+      // 64
+      _values = static_cast<int8_t *>(std::aligned_alloc(64, bytes));
+      if (!_values) {
+        throw std::runtime_error("Failed to allocate memory for ExamBatch");
+      }
+      std::memset(_values, 0, bytes);
+      return;
+    }
+
+    const Allocation allocation = allocate_buffer(bytes, options);
+    _values = static_cast<int8_t *>(allocation.data);
+    _mapped_bytes = allocation.mapped_bytes;
+    if (!options.zero_fill && _mapped_bytes == 0 && _pitch != _question_count) {
+      // Only the padding of every row, which the kernels read
+      for (size_t i = 0; i < _exam_count; ++i) {
+        std::memset(_values + i * _pitch + _question_count, 0,
+                    _pitch - _question_count);
+      }
+    }
+  }
+
+  void release() {
+    free_buffer(_values, _mapped_bytes);
+    _values = nullptr;
+    _mapped_bytes = 0;
+  }
+
+ public:
+  // Initialize an empty ExamBatch
+  ExamBatch()
+      : _exam_count(0), _question_count(0), _pitch(0), _values(nullptr) {}
+
+  // Initialize an ExamBatch of `exam_count` exams with `question_count`
+  // questions each
+  ExamBatch(const size_t &exam_count,  // NOLINT(*-pro-type-member-init)
+            const size_t &question_count) {
+    construct(exam_count, question_count);
+  }
+
+  // Initialize an ExamBatch allocated with `options`, e.g. on huge pages for
+  // large batches, or without zero-filling the answers that the caller
+  // overwrites
+  ExamBatch(const size_t &exam_count,  // NOLINT(*-pro-type-member-init)
+            const size_t &question_count, const AllocationOptions &options) {
+    construct(exam_count, question_count, options);
+  }
+
+  // Initialize an ExamBatch, with every answer set to `value`
+  ExamBatch(const size_t &exam_count,  // NOLINT(*-pro-type-member-init)
+            const size_t &question_count, const int8_t &value) {
+    construct(exam_count, question_count);
+    for (size_t i = 0; i < _exam_count; ++i) {
+      std::fill_n(row(i).data(), _question_count, value);
+    }
+  }
+
+  // Copy constructor
+  ExamBatch(const ExamBatch &other) {  // NOLINT(*-pro-type-member-init)
+    construct(other._exam_count, other._question_count);
+    if (_values) {
+      std::memcpy(_values, other._values, _exam_count * _pitch);
+    }
   }
+
+  // Move constructor
+  ExamBatch(ExamBatch &&other) noexcept
+      : _exam_count(other._exam_count),
+        _question_count(other._question_count),
+        _pitch(other._pitch),
+        _values(other._values),
+        _mapped_bytes(other._mapped_bytes) {
+    other._values = nullptr;
+    other._mapped_bytes = 0;
+    other._exam_count = 0;
+    other._question_count = 0;
+    other._pitch = 0;
+  }
+
+  // Copy assignment operator
+  ExamBatch &operator=(const ExamBatch &other) {
+    if (this != &other) {
+      release();
+      construct(other._exam_count, other._question_count);
+      if (_values) {
+        std::memcpy(_values, other._values, _exam_count * _pitch);
+      }
+    }
+    return *this;
+  }
+
+  // Move assignment operator
+  ExamBatch &operator=(ExamBatch &&other) noexcept {
+    if (this != &other) {
+      release();
+      _exam_count = other._exam_count;
+      _question_count = other._question_count;
+      _pitch = other._pitch;
+      _values = other._values;
+      _mapped_bytes = other._mapped_bytes;
+      other._values = nullptr;
+      other._mapped_bytes = 0;
+      other._exam_count = 0;
+      other._question_count = 0;
+      other._pitch = 0;
+    }
+    return *this;
+  }
+
+  // Operators
+  ExamRow operator[](const size_t &index) const { return row(index); }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _exam_count; }
+  [[nodiscard]] bool empty() const { return _exam_count == 0; }
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  // The distance in bytes between two consecutive exams
+  [[nodiscard]] size_t pitch() const { return _pitch; }
+  [[nodiscard]] ExamRow row(const size_t &index) const {
+    return {_values + index * _pitch, _question_count};
+  }
+
+  // Get the underlying buffer for direct access
+  [[nodiscard]] int8_t *data() const { return _values; }
+
+  ~ExamBatch() { release(); }
+};
+
+// A non-owning, read-only view over `size` bytes anywhere in memory, e.g. a
+// network buffer or an array owned by another library. Unlike a ByteArray,
+// there is no alignment and no padding: the scorers never read past
+// `data() + size()`.
+class ByteArrayView {
+ private:
+  const int8_t *_values;
+  size_t _size;
+
+ public:
+  ByteArrayView() : _values(nullptr), _size(0) {}
+  ByteArrayView(const int8_t *values, const size_t &size)
+      : _values(values), _size(size) {}
+  // NOLINTNEXTLINE(*-explicit-constructor)
+  ByteArrayView(const ByteArray &array)
+      : _values(array.data()), _size(array.size()) {}
+  // NOLINTNEXTLINE(*-explicit-constructor)
+  ByteArrayView(const ExamRow &row) : _values(row.data()), _size(row.size()) {}
+
+  // Operators
+  const int8_t &operator[](const size_t &index) const {
+    return _values[index];
+  }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _size; }
+  [[nodiscard]] bool empty() const { return _size == 0; }
+  [[nodiscard]] const int8_t *data() const { return _values; }
+
+  // Iterators
+  [[nodiscard]] const int8_t *begin() const { return _values; }
+  [[nodiscard]] const int8_t *end() const { return _values + _size; }
+};
+
+// A non-owning, read-only view over `exam_count` exams of `question_count`
+// answers, `stride` bytes apart (any stride, e.g. `question_count` for
+// tightly packed rows), at any alignment and without padding
+class ExamBatchView {
+ private:
+  const int8_t *_values;
+  size_t _exam_count;
+  size_t _question_count;
+  size_t _stride;
+
+ public:
+  ExamBatchView()
+      : _values(nullptr), _exam_count(0), _question_count(0), _stride(0) {}
+  ExamBatchView(const int8_t *values, const size_t &exam_count,
+                const size_t &question_count, const size_t &stride)
+      : _values(values),
+        _exam_count(exam_count),
+        _question_count(question_count),
+        _stride(stride) {}
+  // NOLINTNEXTLINE(*-explicit-constructor)
+  ExamBatchView(const ExamBatch &exams)
+      : _values(exams.data()),
+        _exam_count(exams.exam_count()),
+        _question_count(exams.question_count()),
+        _stride(exams.pitch()) {}
+
+  // Operators
+  ByteArrayView operator[](const size_t &index) const { return row(index); }
+
+  // Getters
+  [[nodiscard]] bool empty() const { return _exam_count == 0; }
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  [[nodiscard]] size_t stride() const { return _stride; }
+  [[nodiscard]] ByteArrayView row(const size_t &index) const {
+    return {_values + index * _stride, _question_count};
+  }
+  [[nodiscard]] const int8_t *data() const { return _values; }
+};
+
+// A batch of exams stored question-major, in groups of 64 exams: inside a
+// group, the answers of the 64 exams to question j sit side by side in the
+// 64-byte row j. The last group is padded with zeroed exams.
+class TransposedExamBatch {
+ private:
+  size_t _exam_count;
+  size_t _question_count;
+  size_t _group_count;
+  int8_t *_values;
+
+  void construct(const size_t &exam_count, const size_t &question_count) {
+    _exam_count = exam_count;
+    _question_count = question_count;
+    _group_count = (_exam_count >> 6) + ((_exam_count & 63) != 0);
+    _values = nullptr;
+
+    const size_t bytes = _group_count * group_size();
+    if (bytes == 0) {
+      return;
+    }
+
+    _values = static_cast<int8_t *>(std::aligned_alloc(64, bytes));
+    if (!_values) {
+      throw std::runtime_error(
+          "Failed to allocate memory for TransposedExamBatch");
+    }
+    std::memset(_values, 0, bytes);
+  }
+
+ public:
+  // Initialize an empty TransposedExamBatch
+  TransposedExamBatch()
+      : _exam_count(0), _question_count(0), _group_count(0), _values(nullptr) {}
+
+  TransposedExamBatch(  // NOLINT(*-pro-type-member-init)
+      const size_t &exam_count, const size_t &question_count) {
+    construct(exam_count, question_count);
+  }
+
+  // Copy constructor
+  TransposedExamBatch(  // NOLINT(*-pro-type-member-init)
+      const TransposedExamBatch &other) {
+    construct(other._exam_count, other._question_count);
+    if (_values) {
+      std::memcpy(_values, other._values, _group_count * group_size());
+    }
+  }
+
+  // Move constructor
+  TransposedExamBatch(TransposedExamBatch &&other) noexcept
+      : _exam_count(other._exam_count),
+        _question_count(other._question_count),
+        _group_count(other._group_count),
+        _values(other._values) {
+    other._values = nullptr;
+    other._exam_count = 0;
+    other._question_count = 0;
+    other._group_count = 0;
+  }
+
+  // Copy assignment operator
+  TransposedExamBatch &operator=(const TransposedExamBatch &other) {
+    if (this != &other) {
+      std::free(_values);
+      construct(other._exam_count, other._question_count);
+      if (_values) {
+        std::memcpy(_values, other._values, _group_count * group_size());
+      }
+    }
+    return *this;
+  }
+
+  // Move assignment operator
+  TransposedExamBatch &operator=(TransposedExamBatch &&other) noexcept {
+    if (this != &other) {
+      std::free(_values);
+      _exam_count = other._exam_count;
+      _question_count = other._question_count;
+      _group_count = other._group_count;
+      _values = other._values;
+      other._values = nullptr;
+      other._exam_count = 0;
+      other._question_count = 0;
+      other._group_count = 0;
+    }
+    return *this;
+  }
+
+  // Getters
+  [[nodiscard]] bool empty() const { return _exam_count == 0; }
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  [[nodiscard]] size_t group_count() const { return _group_count; }
+  // The number of bytes of a group of 64 exams
+  [[nodiscard]] size_t group_size() const { return _question_count << 6; }
+  [[nodiscard]] int8_t *group(const size_t &index) const {
+    return _values + index * group_size();
+  }
+  // The answer of exam `exam` to question `question`
+  [[nodiscard]] int8_t &at(const size_t &exam, const size_t &question) const {
+    return group(exam >> 6)[(question << 6) + (exam & 63)];
+  }
+
+  // Get the underlying buffer for direct access
+  [[nodiscard]] int8_t *data() const { return _values; }
+
+  ~TransposedExamBatch() { std::free(_values); }
 };
 
+// Transpose the 64 exams in `rows` (nullptr rows are treated as zeroed exams)
+// into one group of a TransposedExamBatch, `group` must hold
+// `question_count * 64` bytes. Every row must be readable up to
+// `question_count` rounded up to 16 bytes, which ByteArray and ExamBatch
+// padding guarantees.
+void transpose_exam_group(const int8_t *const rows[64],
+                          const size_t &question_count, int8_t *group);
+TransposedExamBatch transpose_exams(const ExamBatch &exams);
+
+// A batch of exams with every answer in 'A'..'D' packed into 2 bits (0-3),
+// answer k of an exam sitting at bits 2(k % 32) of word k / 32. Every exam is
+// padded with zeroes up to `words_per_exam()` words, a multiple of 8 (64
+// bytes), so the same SIMD kernels can score any row. A single PackedAnswers
+// exam is also how an answer key is packed.
+class PackedAnswers {
+ private:
+  size_t _exam_count;
+  size_t _question_count;
+  size_t _words_per_exam;
+  uint64_t *_words;
+
+  void construct(const size_t &exam_count, const size_t &question_count) {
+    _exam_count = exam_count;
+    _question_count = question_count;
+    const size_t words = (_question_count >> 5) + ((_question_count & 31) != 0);
+    _words_per_exam = (words + 7) & ~static_cast<size_t>(7);
+    _words = nullptr;
+
+    const size_t bytes = _exam_count * _words_per_exam * sizeof(uint64_t);
+    if (bytes == 0) {
+      return;
+    }
+
+    _words = static_cast<uint64_t *>(std::aligned_alloc(64, bytes));
+    if (!_words) {
+      throw std::runtime_error("Failed to allocate memory for PackedAnswers");
+    }
+    std::memset(_words, 0, bytes);
+  }
+
+ public:
+  // Initialize an empty PackedAnswers
+  PackedAnswers()
+      : _exam_count(0), _question_count(0), _words_per_exam(0), _words(nullptr) {}
+
+  PackedAnswers(const size_t &exam_count,  // NOLINT(*-pro-type-member-init)
+                const size_t &question_count) {
+    construct(exam_count, question_count);
+  }
+
+  // Copy constructor
+  PackedAnswers(const PackedAnswers &other) {  // NOLINT(*-pro-type-member-init)
+    construct(other._exam_count, other._question_count);
+    if (_words) {
+      std::memcpy(_words, other._words,
+                  _exam_count * _words_per_exam * sizeof(uint64_t));
+    }
+  }
+
+  // Move constructor
+  PackedAnswers(PackedAnswers &&other) noexcept
+      : _exam_count(other._exam_count),
+        _question_count(other._question_count),
+        _words_per_exam(other._words_per_exam),
+        _words(other._words) {
+    other._words = nullptr;
+    other._exam_count = 0;
+    other._question_count = 0;
+    other._words_per_exam = 0;
+  }
+
+  // Copy assignment operator
+  PackedAnswers &operator=(const PackedAnswers &other) {
+    if (this != &other) {
+      std::free(_words);
+      construct(other._exam_count, other._question_count);
+      if (_words) {
+        std::memcpy(_words, other._words,
+                    _exam_count * _words_per_exam * sizeof(uint64_t));
+      }
+    }
+    return *this;
+  }
+
+  // Move assignment operator
+  PackedAnswers &operator=(PackedAnswers &&other) noexcept {
+    if (this != &other) {
+      std::free(_words);
+      _exam_count = other._exam_count;
+      _question_count = other._question_count;
+      _words_per_exam = other._words_per_exam;
+      _words = other._words;
+      other._words = nullptr;
+      other._exam_count = 0;
+      other._question_count = 0;
+      other._words_per_exam = 0;
+    }
+    return *this;
+  }
+
+  // Getters
+  [[nodiscard]] bool empty() const { return _exam_count == 0; }
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  [[nodiscard]] size_t words_per_exam() const { return _words_per_exam; }
+  [[nodiscard]] uint64_t *row(const size_t &index) const {
+    return _words + index * _words_per_exam;
+  }
+  // The answer ('A'..'D') of exam `exam` to question `question`
+  [[nodiscard]] int8_t at(const size_t &exam, const size_t &question) const {
+    return static_cast<int8_t>(
+        'A' + ((row(exam)[question >> 5] >> ((question & 31) << 1)) & 3));
+  }
+
+  // Get the underlying buffer for direct access
+  [[nodiscard]] uint64_t *data() const { return _words; }
+
+  ~PackedAnswers() { std::free(_words); }
+};
+
+// Pack `count` answers in 'A'..'D' into 2-bit codes, and return false if any
+// answer is something else (e.g. a blank), which can't be represented and is
+// packed as an arbitrary code. With `valid`, both bits of every answer in
+// 'A'..'D' are also set there and the others' cleared, so they can be masked.
+bool pack_answers(const int8_t *answers, const size_t &count, uint64_t *words,
+                  uint64_t *valid = nullptr);
+// Unpack `count` 2-bit codes back into answers in 'A'..'D'
+void unpack_answers(const uint64_t *words, const size_t &count,
+                    int8_t *answers);
+// Throw if an answer isn't in 'A'..'D'
+PackedAnswers pack_answers(const ExamBatch &exams);
+PackedAnswers pack_answers(const ByteArray &answers);
+ExamBatch unpack_answers(const PackedAnswers &exams);
+
+// How the synthetic candidates answer. The defaults are uniformly random
+// answers in 'A'..'D', the fastest to generate.
+struct ExamGeneratorOptions {
+  // The mean probability of answering a question correctly
+  double correct_rate = 0.25;
+  // Every candidate's own rate is drawn uniformly in
+  // correct_rate +/- ability_spread (clamped to [0, 1]), so the scores spread
+  // out like a real cohort's instead of piling up around the mean
+  double ability_spread = 0;
+  // The probability of leaving a question blank (' ')
+  double blank_rate = 0;
+  // The relative popularity of 'A'..'D' among the wrong answers, e.g. to
+  // reproduce candidates' bias towards some options when guessing
+  std::array<double, 4> option_weights = {1, 1, 1, 1};
+  // 0 means one per hardware thread. The output doesn't depend on it.
+  size_t thread_count = 0;
+};
+
+// The generators below are deterministic for a given seed, on any machine and
+// with any number of threads. The overloads without a seed draw one from
+// std::random_device.
 std::vector<ByteArray> generate_exams(const int32_t &number_of_exams,
                                       const int32_t &number_of_questions);
 ByteArray generate_correct_answers(const int32_t &number_of_questions);
+ByteArray generate_correct_answers(const int32_t &number_of_questions,
+                                   const uint64_t &seed);
 ByteArray generate_points(const int32_t &number_of_questions);
+ExamBatch generate_exam_batch(const int32_t &number_of_exams,
+                              const int32_t &number_of_questions);
+// Generate the exams of candidates answering an exam whose answer key is
+// `correct_answers`
+ExamBatch generate_exam_batch(const int32_t &number_of_exams,
+                              const ByteArray &correct_answers,
+                              const uint64_t &seed,
+                              const ExamGeneratorOptions &options = {});
+std::vector<ByteArray> generate_exams(const int32_t &number_of_exams,
+                                      const ByteArray &correct_answers,
+                                      const uint64_t &seed,
+                                      const ExamGeneratorOptions &options = {});
 
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef EXAM_FILE_H_INCLUDED
+#define EXAM_FILE_H_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "exam.h"
+
+// A simple binary file of exams, laid out like an ExamBatch:
+//
+// | offset | size | field                                          |
+// |--------|------|------------------------------------------------|
+// | 0      | 8    | magic, "SIMDEXAM"                              |
+// | 8      | 4    | format version (1)                             |
+// | 12     | 4    | header size (64), where the first exam starts  |
+// | 16     | 8    | question count                                 |
+// | 24     | 8    | exam count                                     |
+// | 32     | 8    | row pitch, the question count rounded up to 64 |
+// | 40     | 24   | reserved, zero                                 |
+//
+// followed by `exam count` rows of `row pitch` bytes, zero-padded. All the
+// fields are little-endian.
+struct ExamFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t question_count;
+  uint64_t exam_count;
+  uint64_t pitch;
+  uint8_t reserved[24];
+};
+
+static_assert(sizeof(ExamFileHeader) == 64);
+
+constexpr char kExamFileMagic[8] = {'S', 'I', 'M', 'D', 'E', 'X', 'A', 'M'};
+constexpr uint32_t kExamFileVersion = 1;
+
+// Writes exams to an exam file one by one, so that files larger than memory
+// can be produced. The header is finalized by `close()` (or the destructor).
+class ExamFileWriter {
+ private:
+  FILE *_file;
+  uint64_t _question_count;
+  uint64_t _exam_count;
+  uint64_t _pitch;
+
+  void write_header();
+
+ public:
+  ExamFileWriter(const std::string &path, const size_t &question_count);
+
+  ExamFileWriter(const ExamFileWriter &) = delete;
+  ExamFileWriter &operator=(const ExamFileWriter &) = delete;
+
+  // Append one exam of `question_count` answers
+  void append(const int8_t *answers);
+  void append(const ExamBatch &exams);
+
+  void close();
+
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+
+  ~ExamFileWriter();
+};
+
+// A read-only, memory-mapped exam file. The rows are used in place, straight
+// from the page cache.
+class ExamFile {
+ private:
+  int8_t *_mapping;
+  size_t _mapping_size;
+  size_t _question_count;
+  size_t _exam_count;
+  size_t _pitch;
+
+ public:
+  explicit ExamFile(const std::string &path);
+
+  ExamFile(const ExamFile &) = delete;
+  ExamFile &operator=(const ExamFile &) = delete;
+
+  ExamFile(ExamFile &&other) noexcept;
+  ExamFile &operator=(ExamFile &&other) noexcept;
+
+  // Getters
+  [[nodiscard]] bool empty() const { return _exam_count == 0; }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  [[nodiscard]] size_t exam_count() const { return _exam_count; }
+  [[nodiscard]] size_t pitch() const { return _pitch; }
+  // The first row, 64-byte aligned
+  [[nodiscard]] const int8_t *rows() const {
+    return _mapping + sizeof(ExamFileHeader);
+  }
+  [[nodiscard]] const int8_t *row(const size_t &index) const {
+    return rows() + index * _pitch;
+  }
+
+  // Hint the kernel about how the rows in [first, last) are going to be used
+  // (see madvise(2)), e.g. MADV_SEQUENTIAL, MADV_WILLNEED or MADV_DONTNEED
+  void advise(const size_t &first, const size_t &last, const int &advice) const;
+
+  ~ExamFile();
+};
+
+void write_exam_file(const std::string &path, const ExamBatch &exams);
+// Load every exam of the file into its own ByteArray
+std::vector<ByteArray> read_exams(const ExamFile &file);
+
+#endif
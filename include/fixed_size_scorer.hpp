@@ -0,0 +1,234 @@
+#ifndef FIXED_SIZE_SCORER_HPP
+#define FIXED_SIZE_SCORER_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// The question counts of our exam formats, which get a specialized kernel
+using FixedQuestionCounts = std::index_sequence<10, 40, 50, 100, 200>;
+
+// An AVX-512 kernel for exams of exactly `Questions` questions. The block
+// count and the tail mask are constants, so the block loop is fully unrolled,
+// and the blocks of the key and of the points are loaded into registers once
+// per call instead of once per exam. The sizes are checked once per call too
+// (per exam only for a vector of exams, against the constant).
+template <size_t Questions>
+class SimdAvx512FixedScorer final : public BaseScorer {
+  static_assert(Questions > 0, "An exam has at least one question.");
+
+ public:
+  static constexpr size_t kQuestions = Questions;
+
+  SIMD_TARGET_AVX512
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    check_key(correct_answers.size());
+
+    const LoadedKey key = load_key(correct_answers.data(), points.data());
+    for (size_t i = first; i < last; ++i) {
+      // Against the constant, and in the same pass, so that the exams' sizes
+      // aren't read twice
+      if (exams[i].size() != Questions) {
+        check_exam(exams[i].size(), correct_answers);
+      }
+      out[i - first] = score_exam(exams[i].data(), key);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    check_key(correct_answers.size());
+
+    const LoadedKey key = load_key(correct_answers.data(), points.data());
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, key);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    check_key(correct_answers.size());
+
+    const LoadedKey key = load_key(correct_answers.data(), points.data());
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows[i], key);
+    }
+  }
+
+  // The tail block is loaded with a mask, so views are scored in place
+  SIMD_TARGET_AVX512
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    check_key(correct_answers.size());
+
+    const LoadedKey key = load_key(correct_answers.data(), points.data());
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      out[i] = score_exam(exams.data() + i * exams.stride(), key);
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx512()) {
+      throw std::runtime_error(
+          "SIMD AVX512 fixed size checker not supported because the CPU "
+          "lacks AVX512{BW,VL,F,DQ} support.");
+    }
+  }
+
+ private:
+  static constexpr size_t kBlockCount = (Questions + 63) / 64;
+
+  struct LoadedKey {
+    __m512i correct_answers[kBlockCount];
+    __m512i points[kBlockCount];
+  };
+
+  // Every block is full but the last one, which holds Questions % 64
+  // questions (if that isn't 0)
+  static constexpr __mmask64 block_mask(const size_t &block) {
+    return block + 1 < kBlockCount || Questions % 64 == 0
+               ? ~__mmask64{0}
+               : (__mmask64{1} << (Questions % 64)) - 1;
+  }
+
+  static void check_key(const size_t &question_count) {
+    if (question_count != Questions) {
+      throw std::runtime_error(
+          "The size of the correct answers doesn't match the question count "
+          "of the kernel.");
+    }
+  }
+
+  template <size_t Block>
+  SIMD_TARGET_AVX512 static __m512i load_block(const int8_t *values) {
+    if constexpr (block_mask(Block) == ~__mmask64{0}) {
+      return _mm512_loadu_si512(values + Block * 64);
+    } else {
+      return _mm512_maskz_loadu_epi8(block_mask(Block), values + Block * 64);
+    }
+  }
+
+  template <size_t... Blocks>
+  SIMD_TARGET_AVX512 static LoadedKey load_key(
+      const int8_t *correct_answers, const int8_t *points,
+      std::index_sequence<Blocks...>) {
+    return {{load_block<Blocks>(correct_answers)...},
+            {load_block<Blocks>(points)...}};
+  }
+
+  SIMD_TARGET_AVX512
+  static LoadedKey load_key(const int8_t *correct_answers,
+                            const int8_t *points) {
+    return load_key(correct_answers, points,
+                    std::make_index_sequence<kBlockCount>());
+  }
+
+  template <size_t Block>
+  SIMD_TARGET_AVX512 static __m512i score_block(const int8_t *exam,
+                                                const LoadedKey &key) {
+    const __mmask64 mask = _mm512_cmpeq_epi8_mask(
+        load_block<Block>(exam), key.correct_answers[Block]);
+    return _mm512_sad_epu8(_mm512_maskz_mov_epi8(mask, key.points[Block]),
+                           _mm512_setzero_si512());
+  }
+
+  template <size_t... Blocks>
+  SIMD_TARGET_AVX512 static int32_t score_exam(const int8_t *exam,
+                                               const LoadedKey &key,
+                                               std::index_sequence<Blocks...>) {
+    __m512i sums = _mm512_setzero_si512();
+    ((sums = _mm512_add_epi64(sums, score_block<Blocks>(exam, key))), ...);
+    return static_cast<int32_t>(_mm512_reduce_add_epi64(sums));
+  }
+
+  SIMD_TARGET_AVX512
+  static int32_t score_exam(const int8_t *exam, const LoadedKey &key) {
+    return score_exam(exam, key, std::make_index_sequence<kBlockCount>());
+  }
+};
+
+// Scores with the specialized kernel of the key's question count, when there
+// is one (see FixedQuestionCounts) and the CPU has AVX-512, and with the
+// generic kernel otherwise. The kernel is looked up once per call.
+class FixedSizeScorer final : public BaseScorer {
+ private:
+  std::shared_ptr<BaseScorer> _generic;
+  // The specialized kernels by question count
+  std::vector<std::pair<size_t, std::shared_ptr<BaseScorer>>> _kernels;
+
+  template <size_t... Counts>
+  void register_kernels(std::index_sequence<Counts...>) {
+    (_kernels.emplace_back(Counts,
+                           std::make_shared<SimdAvx512FixedScorer<Counts>>()),
+     ...);
+  }
+
+ public:
+  explicit FixedSizeScorer(std::shared_ptr<BaseScorer> generic =
+                               make_best_scorer())
+      : _generic(std::move(generic)) {
+    if (Cpu::supports_avx512()) {
+      register_kernels(FixedQuestionCounts());
+    }
+  }
+
+  // The kernel that scores exams of `question_count` questions
+  [[nodiscard]] BaseScorer &kernel(const size_t &question_count) const {
+    for (const auto &[count, kernel] : _kernels) {
+      if (count == question_count) {
+        return *kernel;
+      }
+    }
+    return *_generic;
+  }
+
+  [[nodiscard]] bool is_specialized(const size_t &question_count) const {
+    return &kernel(question_count) != _generic.get();
+  }
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    kernel(correct_answers.size())
+        .score_range(exams, first, last, correct_answers, points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    kernel(correct_answers.size())
+        .score_rows(rows, pitch, count, correct_answers, points, out);
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    kernel(correct_answers.size())
+        .score_row_pointers(rows, count, correct_answers, points, out);
+  }
+
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    kernel(correct_answers.size())
+        .score_view(exams, correct_answers, points, out);
+  }
+
+  void ensure_cpu_support() const override { _generic->ensure_cpu_support(); }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef INSTRUMENTED_SCORER_HPP
+#define INSTRUMENTED_SCORER_HPP
+
+#include <memory>
+#include <utility>
+
+#include "perf_counters.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// Runs any other scorer (the kernel) and accumulates the hardware counters of
+// every score() call (see PerfCounters). Without perf events the scores are
+// the same and the counts stay unavailable. Like PerfCounters, it only counts
+// the thread that created it.
+class InstrumentedScorer final : public BaseScorer {
+ private:
+  std::shared_ptr<BaseScorer> _kernel;
+  PerfCounters _counters;
+  size_t _calls = 0;
+
+ public:
+  explicit InstrumentedScorer(std::shared_ptr<BaseScorer> kernel)
+      : _kernel(std::move(kernel)) {}
+
+  // The counts of every score() call so far, and how many calls there were
+  [[nodiscard]] const PerfCounts &counts() const { return _counters.counts(); }
+  [[nodiscard]] size_t calls() const { return _calls; }
+  void reset() {
+    _counters.reset();
+    _calls = 0;
+  }
+
+  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
+                             const ByteArray &correct_answers,
+                             const ByteArray &points) override {
+    PerfScope scope(&_counters);
+    ++_calls;
+    return _kernel->score(exams, correct_answers, points);
+  }
+
+  std::vector<int32_t> score(const ExamBatch &exams,
+                             const ByteArray &correct_answers,
+                             const ByteArray &points) override {
+    PerfScope scope(&_counters);
+    ++_calls;
+    return _kernel->score(exams, correct_answers, points);
+  }
+
+  std::vector<int32_t> score(const ExamBatchView &exams,
+                             const ByteArrayView &correct_answers,
+                             const ByteArrayView &points) override {
+    PerfScope scope(&_counters);
+    ++_calls;
+    return _kernel->score(exams, correct_answers, points);
+  }
+
+  void ensure_cpu_support() const override { _kernel->ensure_cpu_support(); }
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    _kernel->score_range(exams, first, last, correct_answers, points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    _kernel->score_rows(rows, pitch, count, correct_answers, points, out);
+  }
+
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    _kernel->score_view(exams, correct_answers, points, out);
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    _kernel->score_row_pointers(rows, count, correct_answers, points, out);
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef MULTI_SELECT_SCORER_HPP
+#define MULTI_SELECT_SCORER_HPP
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+
+namespace Scorer {
+// How a question is scored. A "choose all that apply" answer (and key) is a
+// bitmask of the selected options, bit 0 for 'A' to bit 3 for 'D' (see
+// select_options), a blank selecting nothing.
+enum class QuestionRule : int8_t {
+  // All or nothing: the answer must be the key, byte for byte. Single-select
+  // questions ('A'..'D') use this rule.
+  kExact,
+  // points * (correct options selected) / (correct options), rounded down
+  kPartial,
+  // The same, with every wrong option selected cancelling a correct one, and
+  // never below 0
+  kPartialWithPenalty,
+};
+
+// The multiple-select byte selecting `options`, e.g. "AC"
+inline int8_t select_options(const std::string_view &options) {
+  int8_t selected = 0;
+  for (const char &option : options) {
+    if (option < 'A' || option > 'D') {
+      throw std::runtime_error("The options must be 'A', 'B', 'C' or 'D'.");
+    }
+    selected |= static_cast<int8_t>(1 << (option - 'A'));
+  }
+  return selected;
+}
+
+// An answer key with a rule per question, so that single- and
+// multiple-select questions can be mixed in one exam. The rules are turned
+// into per-question tables once, with the key, and the kernels apply them to
+// every question the same way, without branching on the rule:
+//
+//   net   = popcount(answer & key) - popcount(answer & ~key & wrong_mask)
+//   score = (answer == key ? exact_points : 0) + credit[net]
+//
+// where an exact question has no credit and a partial one no exact points.
+class MultiSelectKey {
+ private:
+  ByteArray _correct_answers;
+  ByteArray _points;
+  std::vector<QuestionRule> _rules;
+  ByteArray _exact_points;
+  ByteArray _wrong_masks;
+  // _credits[k - 1][j] is the credit of question j for a net of k options
+  std::array<ByteArray, 4> _credits;
+
+ public:
+  // The points are unsigned bytes, as in the SAD-based scorers
+  MultiSelectKey(const ByteArray &correct_answers, const ByteArray &points,
+                 const std::vector<QuestionRule> &rules)
+      : _correct_answers(correct_answers),
+        _points(points),
+        _rules(rules),
+        _exact_points(correct_answers.size()),
+        _wrong_masks(correct_answers.size()) {
+    if (points.size() != correct_answers.size() ||
+        rules.size() != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of correct answers, points and rules must be the same.");
+    }
+
+    for (auto &credit : _credits) {
+      credit = ByteArray(correct_answers.size());
+    }
+
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      if (rules[j] == QuestionRule::kExact) {
+        _exact_points[j] = points[j];
+        continue;
+      }
+
+      const int8_t key = correct_answers[j];
+      if (key <= 0 || key > 0x0f) {
+        throw std::runtime_error(
+            "The key of a partial credit question must select at least one "
+            "option (see select_options).");
+      }
+
+      const uint32_t correct_count = __builtin_popcount(key);
+      const auto question_points = static_cast<uint8_t>(points[j]);
+      for (uint32_t k = 1; k <= correct_count; ++k) {
+        _credits[k - 1][j] =
+            static_cast<int8_t>(question_points * k / correct_count);
+      }
+      if (rules[j] == QuestionRule::kPartialWithPenalty) {
+        _wrong_masks[j] = 0x0f;
+      }
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return _correct_answers.size(); }
+  [[nodiscard]] const ByteArray &correct_answers() const {
+    return _correct_answers;
+  }
+  [[nodiscard]] const ByteArray &points() const { return _points; }
+  [[nodiscard]] const std::vector<QuestionRule> &rules() const {
+    return _rules;
+  }
+  [[nodiscard]] const ByteArray &exact_points() const { return _exact_points; }
+  [[nodiscard]] const ByteArray &wrong_masks() const { return _wrong_masks; }
+  // The credits for a net of `k` (1 to 4) options
+  [[nodiscard]] const ByteArray &credits(const size_t &k) const {
+    return _credits[k - 1];
+  }
+};
+
+class BaseMultiSelectScorer {
+ public:
+  virtual ~BaseMultiSelectScorer() = default;
+
+  std::vector<int32_t> score(const ExamBatch &exams,
+                             const MultiSelectKey &key) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_exam(exams.question_count(), key);
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    score_rows(exams.data(), exams.pitch(), exams.exam_count(), key,
+               scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
+                             const MultiSelectKey &key) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    std::vector<const int8_t *> rows;
+    rows.reserve(exams.size());
+    for (const auto &exam : exams) {
+      check_exam(exam.size(), key);
+      rows.push_back(exam.data());
+    }
+
+    std::vector<int32_t> scored_exams_points(exams.size());
+    score_row_pointers(rows.data(), rows.size(), key,
+                       scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  // Score `count` exams stored `pitch` bytes apart, starting at `rows`, and
+  // write the results to out[0, count). Every row must be readable (and
+  // zero-padded) up to `key.correct_answers().capacity()` bytes.
+  virtual void score_rows(const int8_t *rows, const size_t &pitch,
+                          const size_t &count, const MultiSelectKey &key,
+                          int32_t *out) = 0;
+
+  // The same, for the `count` exams pointed to by `rows`
+  virtual void score_row_pointers(const int8_t *const *rows,
+                                  const size_t &count,
+                                  const MultiSelectKey &key, int32_t *out) = 0;
+
+  // Throw if the CPU can't run this scorer
+  virtual void ensure_cpu_support() const {}
+
+ protected:
+  static void check_exam(const size_t &exam_size, const MultiSelectKey &key) {
+    if (exam_size != key.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+  }
+};
+
+// The reference: the rules applied question by question
+class NaiveMultiSelectScorer final : public BaseMultiSelectScorer {
+ public:
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, key);
+    }
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows[i], key);
+    }
+  }
+
+ private:
+  static int32_t score_exam(const int8_t *exam, const MultiSelectKey &key) {
+    int32_t score = 0;
+
+    for (size_t j = 0; j < key.size(); ++j) {
+      const int8_t correct = key.correct_answers()[j];
+      const auto points = static_cast<int32_t>(
+          static_cast<uint8_t>(key.points()[j]));
+
+      if (key.rules()[j] == QuestionRule::kExact) {
+        score += (exam[j] == correct) * points;
+        continue;
+      }
+
+      const int8_t selected = exam[j] & 0x0f;
+      const int32_t correct_count = __builtin_popcount(correct);
+      int32_t net = __builtin_popcount(selected & correct);
+      if (key.rules()[j] == QuestionRule::kPartialWithPenalty) {
+        net = std::max(net - __builtin_popcount(selected & ~correct), 0);
+      }
+      score += points * net / correct_count;
+    }
+
+    return score;
+  }
+};
+
+// Both SIMD kernels count the options of 32 (resp. 64) answers at once with a
+// nibble lookup table (pshufb), so mixed single- and multiple-select exams
+// stay on the vector path.
+class SimdMultiSelectScorer final : public BaseMultiSelectScorer {
+ public:
+  SIMD_TARGET_AVX2
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, key);
+    }
+  }
+
+  SIMD_TARGET_AVX2
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows[i], key);
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx2()) {
+      throw std::runtime_error(
+          "SIMD multiple-select checker not supported because the CPU lacks "
+          "AVX2 support.");
+    }
+  }
+
+ private:
+  SIMD_TARGET_AVX2
+  static __m256i load(const ByteArray &values, const size_t &j) {
+    return _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(values.data() + j));
+  }
+
+  SIMD_TARGET_AVX2
+  static int32_t score_exam(const int8_t *exam, const MultiSelectKey &key) {
+    // The number of set bits of every nibble
+    const __m256i popcount = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+        1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i options = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+
+    for (size_t j = 0, _j = 0; j < key.correct_answers().block_count_avx2();
+         ++j, _j = j << 5) {
+      const __m256i answers =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(exam + _j));
+      const __m256i correct_answers = load(key.correct_answers(), _j);
+      const __m256i selected = _mm256_and_si256(answers, options);
+
+      const __m256i hits = _mm256_shuffle_epi8(
+          popcount, _mm256_and_si256(selected, correct_answers));
+      const __m256i misses = _mm256_shuffle_epi8(
+          popcount,
+          _mm256_and_si256(_mm256_andnot_si256(correct_answers, selected),
+                           load(key.wrong_masks(), _j)));
+      const __m256i net = _mm256_subs_epu8(hits, misses);
+
+      // An exact question has no credits and a partial one no exact points,
+      // so the two can be or'ed
+      __m256i points = _mm256_and_si256(
+          _mm256_cmpeq_epi8(answers, correct_answers),
+          load(key.exact_points(), _j));
+      for (size_t k = 1; k <= 4; ++k) {
+        points = _mm256_or_si256(
+            points,
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(net, _mm256_set1_epi8(static_cast<char>(k))),
+                load(key.credits(k), _j)));
+      }
+
+      sums = _mm256_add_epi64(sums,
+                              _mm256_sad_epu8(points, _mm256_setzero_si256()));
+    }
+
+    const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums),
+                                      _mm256_extracti128_si256(sums, 1));
+    return static_cast<int32_t>(_mm_cvtsi128_si64(sum) +
+                                _mm_extract_epi64(sum, 1));
+  }
+};
+
+class SimdAvx512MultiSelectScorer final : public BaseMultiSelectScorer {
+ public:
+  SIMD_TARGET_AVX512
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, key);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const MultiSelectKey &key, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows[i], key);
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx512()) {
+      throw std::runtime_error(
+          "SIMD AVX512 multiple-select checker not supported because the CPU "
+          "lacks AVX512{BW,VL,F,DQ} support.");
+    }
+  }
+
+ private:
+  SIMD_TARGET_AVX512
+  static int32_t score_exam(const int8_t *exam, const MultiSelectKey &key) {
+    // The number of set bits of every nibble, in every 128-bit lane
+    const __m512i popcount = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i options = _mm512_set1_epi8(0x0f);
+    __m512i sums = _mm512_setzero_si512();
+
+    for (size_t j = 0, _j = 0; j < key.correct_answers().block_count_avx512();
+         ++j, _j = j << 6) {
+      const __m512i answers = _mm512_loadu_si512(exam + _j);
+      const __m512i correct_answers =
+          _mm512_loadu_si512(key.correct_answers().data() + _j);
+      const __m512i selected = _mm512_and_si512(answers, options);
+
+      const __m512i hits = _mm512_shuffle_epi8(
+          popcount, _mm512_and_si512(selected, correct_answers));
+      const __m512i misses = _mm512_shuffle_epi8(
+          popcount,
+          _mm512_and_si512(_mm512_andnot_si512(correct_answers, selected),
+                           _mm512_loadu_si512(key.wrong_masks().data() + _j)));
+      const __m512i net = _mm512_subs_epu8(hits, misses);
+
+      // An exact question has no credits and a partial one no exact points
+      __m512i points = _mm512_maskz_mov_epi8(
+          _mm512_cmpeq_epi8_mask(answers, correct_answers),
+          _mm512_loadu_si512(key.exact_points().data() + _j));
+      for (size_t k = 1; k <= 4; ++k) {
+        points = _mm512_or_si512(
+            points,
+            _mm512_maskz_mov_epi8(
+                _mm512_cmpeq_epi8_mask(net,
+                                       _mm512_set1_epi8(static_cast<char>(k))),
+                _mm512_loadu_si512(key.credits(k).data() + _j)));
+      }
+
+      sums = _mm512_add_epi64(sums,
+                              _mm512_sad_epu8(points, _mm512_setzero_si512()));
+    }
+
+    return static_cast<int32_t>(_mm512_reduce_add_epi64(sums));
+  }
+};
+
+// Create the fastest multiple-select scorer that the CPU supports
+inline std::shared_ptr<BaseMultiSelectScorer> make_best_multi_select_scorer() {
+  if (Cpu::supports_avx512()) {
+    return std::make_shared<SimdAvx512MultiSelectScorer>();
+  }
+  if (Cpu::supports_avx2()) {
+    return std::make_shared<SimdMultiSelectScorer>();
+  }
+  return std::make_shared<NaiveMultiSelectScorer>();
+}
+}  // namespace Scorer
+
+#endif
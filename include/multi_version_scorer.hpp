@@ -0,0 +1,187 @@
+#ifndef MULTI_VERSION_SCORER_HPP
+#define MULTI_VERSION_SCORER_HPP
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "exam.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// The answer keys and points of every variant of a shuffled exam (e.g. codes
+// 101, 102, ...). Variants are identified by their index in the table, in the
+// order they were added.
+class AnswerKeyTable {
+ private:
+  size_t _question_count;
+  std::vector<ByteArray> _correct_answers;
+  std::vector<ByteArray> _points;
+
+ public:
+  explicit AnswerKeyTable(const size_t &question_count)
+      : _question_count(question_count) {}
+
+  // Add a variant, and return its index
+  uint32_t add(ByteArray correct_answers, ByteArray points) {
+    if (correct_answers.size() != points.size()) {
+      throw std::runtime_error(
+          "The size of correct answers and points must be the same.");
+    }
+    if (correct_answers.size() != _question_count) {
+      throw std::runtime_error(
+          "The size of correct answers and the table's questions must be the "
+          "same.");
+    }
+
+    _correct_answers.push_back(std::move(correct_answers));
+    _points.push_back(std::move(points));
+    return static_cast<uint32_t>(_correct_answers.size() - 1);
+  }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _correct_answers.size(); }
+  [[nodiscard]] size_t question_count() const { return _question_count; }
+  [[nodiscard]] const ByteArray &correct_answers(const size_t &variant) const {
+    return _correct_answers[variant];
+  }
+  [[nodiscard]] const ByteArray &points(const size_t &variant) const {
+    return _points[variant];
+  }
+};
+
+// Scores a batch that mixes several variants of an exam in one pass, each
+// exam against the key of its own variant. The table is small, so every key
+// stays in cache while the exams stream through.
+//
+// By default, each run of consecutive exams of the same variant goes to the
+// kernel at once, which is ideal when the batch is already sorted by variant.
+// With `group_by_variant`, the exams are first bucketed by variant (a counting
+// sort of their indices, the exams themselves are not moved), and every
+// variant's exams are scored in one kernel call, with a single key. That only
+// pays off when all the keys together don't fit in cache, since the gather
+// and scatter of the exams costs more than switching keys per exam.
+class MultiVersionScorer {
+ private:
+  std::shared_ptr<BaseScorer> _kernel;
+  bool _group_by_variant;
+
+  template <typename Row>
+  std::vector<int32_t> score_rows(const size_t &count, const Row &row,
+                                  const std::vector<uint32_t> &variants,
+                                  const AnswerKeyTable &keys) {
+    _kernel->ensure_cpu_support();
+
+    if (variants.size() != count) {
+      throw std::runtime_error(
+          "The number of variants and exams must be the same.");
+    }
+    for (const auto &variant : variants) {
+      if (variant >= keys.size()) {
+        throw std::runtime_error("Unknown exam variant " +
+                                 std::to_string(variant) + ".");
+      }
+    }
+
+    std::vector<int32_t> scored_exams_points(count);
+    std::vector<const int8_t *> rows;
+
+    if (!_group_by_variant) {
+      for (size_t first = 0, last; first < count; first = last) {
+        for (last = first + 1; last < count && variants[last] == variants[first];
+             ++last) {
+        }
+
+        rows.clear();
+        for (size_t i = first; i < last; ++i) {
+          rows.push_back(row(i));
+        }
+        _kernel->score_row_pointers(rows.data(), rows.size(),
+                                    keys.correct_answers(variants[first]),
+                                    keys.points(variants[first]),
+                                    scored_exams_points.data() + first);
+      }
+
+      return scored_exams_points;
+    }
+
+    // Counting sort of the exams' indices by variant
+    std::vector<size_t> offsets(keys.size() + 1, 0);
+    for (const auto &variant : variants) {
+      ++offsets[variant + 1];
+    }
+    for (size_t v = 0; v < keys.size(); ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<size_t> order(count);
+    {
+      auto next = offsets;
+      for (size_t i = 0; i < count; ++i) {
+        order[next[variants[i]]++] = i;
+      }
+    }
+
+    rows.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+      rows[k] = row(order[k]);
+    }
+
+    std::vector<int32_t> grouped_scores(count);
+    for (size_t v = 0; v < keys.size(); ++v) {
+      _kernel->score_row_pointers(rows.data() + offsets[v],
+                                  offsets[v + 1] - offsets[v],
+                                  keys.correct_answers(v), keys.points(v),
+                                  grouped_scores.data() + offsets[v]);
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+      scored_exams_points[order[k]] = grouped_scores[k];
+    }
+
+    return scored_exams_points;
+  }
+
+ public:
+  explicit MultiVersionScorer(std::shared_ptr<BaseScorer> kernel,
+                              const bool &group_by_variant = false)
+      : _kernel(std::move(kernel)), _group_by_variant(group_by_variant) {}
+
+  // Score every exam against the variant `variants[i]` of `keys`
+  std::vector<int32_t> score(const ExamBatch &exams,
+                             const std::vector<uint32_t> &variants,
+                             const AnswerKeyTable &keys) {
+    if (!exams.empty() && exams.question_count() != keys.question_count()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+
+    return score_rows(
+        exams.exam_count(),
+        [&](const size_t &i) -> const int8_t * {
+          return exams.row(i).data();
+        },
+        variants, keys);
+  }
+
+  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
+                             const std::vector<uint32_t> &variants,
+                             const AnswerKeyTable &keys) {
+    for (const auto &exam : exams) {
+      if (exam.size() != keys.question_count()) {
+        throw std::runtime_error(
+            "The size of exams' questions and correct answers must be the "
+            "same.");
+      }
+    }
+
+    return score_rows(
+        exams.size(),
+        [&](const size_t &i) -> const int8_t * { return exams[i].data(); },
+        variants, keys);
+  }
+};
+}  // namespace Scorer
+
+#endif
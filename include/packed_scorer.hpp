@@ -0,0 +1,280 @@
+#ifndef PACKED_SCORER_HPP
+#define PACKED_SCORER_HPP
+
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// Scores 2-bit packed answers (see PackedAnswers), which need 4 times less
+// memory bandwidth than one byte per answer. The answer key must be in
+// 'A'..'D'.
+//
+// For every 64-bit word, x = exam ^ key has both bits of a 2-bit code cleared
+// exactly when the answers match, so ~(x | x >> 1) & 0x5555... has one bit set
+// per correct answer. The points are split into 8 bit planes (bit b of every
+// question's points, the sign bit weighing -128), so the score is the sum over
+// the planes of 2^b * popcount(matches & plane). Only the planes that have a
+// bit set somewhere are evaluated, e.g. a single one when every question is
+// worth 2 points.
+class PackedSimdScorer final : public BaseScorer {
+ private:
+  static constexpr uint64_t kLowBits = 0x5555555555555555ULL;
+
+  // The bit planes of a points vector, `words_per_exam` words each
+  struct PointPlanes {
+    size_t words_per_exam = 0;
+    // b for bit b of the points, whose plane weighs 2^b (-2^7 for b = 7)
+    std::vector<int32_t> shifts;
+    std::vector<uint64_t> planes;
+  };
+
+  static PointPlanes make_planes(const ByteArray &points,
+                                 const size_t &words_per_exam) {
+    PointPlanes result;
+    result.words_per_exam = words_per_exam;
+
+    for (int32_t b = 0; b < 8; ++b) {
+      std::vector<uint64_t> plane(words_per_exam, 0);
+      bool used = false;
+
+      for (size_t j = 0; j < points.size(); ++j) {
+        if ((static_cast<uint8_t>(points[j]) >> b) & 1) {
+          plane[j >> 5] |= 1ULL << ((j & 31) << 1);
+          used = true;
+        }
+      }
+
+      if (used) {
+        result.shifts.push_back(b);
+        result.planes.insert(result.planes.end(), plane.begin(), plane.end());
+      }
+    }
+
+    return result;
+  }
+
+  // Score `count` packed exams laid out `words_per_exam` words apart
+  SIMD_TARGET_AVX512_VPOPCNTDQ
+  static void score_exams_vpopcntdq(const uint64_t *exams, const size_t &count,
+                                    const uint64_t *key,
+                                    const PointPlanes &planes, int32_t *out) {
+    const __m512i low_bits = _mm512_set1_epi64(static_cast<int64_t>(kLowBits));
+    const size_t words = planes.words_per_exam;
+
+    for (size_t i = 0; i < count; ++i, exams += words) {
+      // Every plane's popcounts, already shifted by its weight
+      __m512i total = _mm512_setzero_si512();
+
+      for (size_t w = 0; w < words; w += 8) {
+        const __m512i x = _mm512_xor_si512(_mm512_load_si512(exams + w),
+                                           _mm512_load_si512(key + w));
+        const __m512i matches = _mm512_andnot_si512(
+            _mm512_or_si512(x, _mm512_srli_epi64(x, 1)), low_bits);
+
+        for (size_t b = 0; b < planes.shifts.size(); ++b) {
+          const __m512i count_b = _mm512_sll_epi64(
+              _mm512_popcnt_epi64(_mm512_and_si512(
+                  matches, _mm512_loadu_si512(planes.planes.data() +
+                                              b * words + w))),
+              _mm_cvtsi32_si128(planes.shifts[b]));
+          total = planes.shifts[b] == 7 ? _mm512_sub_epi64(total, count_b)
+                                        : _mm512_add_epi64(total, count_b);
+        }
+      }
+
+      out[i] = static_cast<int32_t>(_mm512_reduce_add_epi64(total));
+    }
+  }
+
+  // Without VPOPCNTQ, count the bits of every byte with a 16-entry nibble
+  // lookup table (pshufb), then sum the bytes of each 64-bit lane with SAD
+  SIMD_TARGET_AVX2
+  static void score_exams_avx2(const uint64_t *exams, const size_t &count,
+                               const uint64_t *key, const PointPlanes &planes,
+                               int32_t *out) {
+    const __m256i low_bits = _mm256_set1_epi64x(static_cast<int64_t>(kLowBits));
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    const __m256i lookup =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,  //
+                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const size_t words = planes.words_per_exam;
+
+    for (size_t i = 0; i < count; ++i, exams += words) {
+      __m256i total = _mm256_setzero_si256();
+
+      for (size_t w = 0; w < words; w += 4) {
+        const __m256i x = _mm256_xor_si256(
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(exams + w)),
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(key + w)));
+        const __m256i matches = _mm256_andnot_si256(
+            _mm256_or_si256(x, _mm256_srli_epi64(x, 1)), low_bits);
+
+        for (size_t b = 0; b < planes.shifts.size(); ++b) {
+          const __m256i v = _mm256_and_si256(
+              matches, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                           planes.planes.data() + b * words + w)));
+          const __m256i bits = _mm256_add_epi8(
+              _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibbles)),
+              _mm256_shuffle_epi8(
+                  lookup,
+                  _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles)));
+          const __m256i count_b =
+              _mm256_sll_epi64(_mm256_sad_epu8(bits, _mm256_setzero_si256()),
+                               _mm_cvtsi32_si128(planes.shifts[b]));
+          total = planes.shifts[b] == 7 ? _mm256_sub_epi64(total, count_b)
+                                        : _mm256_add_epi64(total, count_b);
+        }
+      }
+
+      const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(total),
+                                        _mm256_extracti128_si256(total, 1));
+      out[i] = static_cast<int32_t>(_mm_cvtsi128_si64(sum) +
+                                    _mm_extract_epi64(sum, 1));
+    }
+  }
+
+  // Without the popcnt target, __builtin_popcountll is a library call, so
+  // this also runs on the baseline x86-64 CPUs that lack the instruction
+  static void score_exams_scalar(const uint64_t *exams, const size_t &count,
+                                 const uint64_t *key, const PointPlanes &planes,
+                                 int32_t *out) {
+    const size_t words = planes.words_per_exam;
+
+    for (size_t i = 0; i < count; ++i, exams += words) {
+      int32_t score = 0;
+
+      for (size_t w = 0; w < words; ++w) {
+        const uint64_t x = exams[w] ^ key[w];
+        const uint64_t matches = ~(x | x >> 1) & kLowBits;
+
+        for (size_t b = 0; b < planes.shifts.size(); ++b) {
+          const int32_t count_b =
+              __builtin_popcountll(matches & planes.planes[b * words + w])
+              << planes.shifts[b];
+          score += planes.shifts[b] == 7 ? -count_b : count_b;
+        }
+      }
+
+      out[i] = score;
+    }
+  }
+
+  // The same, inlined with the POPCNT instruction
+  SIMD_TARGET_POPCNT
+  static void score_exams_popcnt(const uint64_t *exams, const size_t &count,
+                                 const uint64_t *key, const PointPlanes &planes,
+                                 int32_t *out) {
+    score_exams_scalar(exams, count, key, planes, out);
+  }
+
+  static void score_exams(const uint64_t *exams, const size_t &count,
+                          const uint64_t *key, const PointPlanes &planes,
+                          int32_t *out) {
+    if (Cpu::supports_avx512_vpopcntdq()) {
+      score_exams_vpopcntdq(exams, count, key, planes, out);
+    } else if (Cpu::supports_avx2()) {
+      score_exams_avx2(exams, count, key, planes, out);
+    } else if (Cpu::supports_popcnt()) {
+      score_exams_popcnt(exams, count, key, planes, out);
+    } else {
+      score_exams_scalar(exams, count, key, planes, out);
+    }
+  }
+
+  // Pack and score the byte answers given by `row(i)` for i in [0, count).
+  // The answers outside 'A'..'D' (e.g. blanks) get the code next to the key's
+  // instead, so they are scored as wrong like in the byte kernels.
+  template <typename Row>
+  static void score_packing(const size_t &count, const Row &row,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points, int32_t *out) {
+    const auto key = pack_answers(correct_answers);
+    const auto planes = make_planes(points, key.words_per_exam());
+    PackedAnswers exam(1, correct_answers.size());
+    const size_t words = (correct_answers.size() + 31) >> 5;
+    std::vector<uint64_t> valid(words);
+
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t *packed = exam.row(0);
+      if (!pack_answers(row(i), correct_answers.size(), packed,
+                        valid.data())) {
+        for (size_t w = 0; w < words; ++w) {
+          packed[w] = (packed[w] & valid[w]) |
+                      ((key.row(0)[w] ^ kLowBits) & ~valid[w]);
+        }
+      }
+      score_exams(packed, 1, key.row(0), planes, out + i);
+    }
+  }
+
+ public:
+  // Score packed exams against a packed key
+  std::vector<int32_t> score(const PackedAnswers &exams,
+                             const PackedAnswers &correct_answers,
+                             const ByteArray &points) {
+    if (exams.empty()) {
+      return {};
+    }
+
+    if (correct_answers.exam_count() != 1 ||
+        correct_answers.question_count() != points.size()) {
+      throw std::runtime_error(
+          "The size of correct answers and points must be the same.");
+    }
+    if (exams.question_count() != correct_answers.question_count()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+
+    const auto planes = make_planes(points, exams.words_per_exam());
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+
+    score_exams(exams.data(), exams.exam_count(), correct_answers.row(0),
+                planes, scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  using BaseScorer::score;
+
+  // Byte answers are packed on the fly, one exam at a time
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    for (size_t i = first; i < last; ++i) {
+      check_exam(exams[i].size(), correct_answers);
+    }
+
+    score_packing(
+        last - first,
+        [&](const size_t &i) -> const int8_t * {
+          return exams[first + i].data();
+        },
+        correct_answers, points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    score_packing(
+        count,
+        [&](const size_t &i) -> const int8_t * { return rows + i * pitch; },
+        correct_answers, points, out);
+  }
+
+  // The key and its point planes are packed once for all the exams
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    score_packing(
+        count, [&](const size_t &i) -> const int8_t * { return rows[i]; },
+        correct_answers, points, out);
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef PARALLEL_SCORER_HPP
+#define PARALLEL_SCORER_HPP
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "scorers.hpp"
+#include "thread_pool.hpp"
+
+namespace Scorer {
+// Runs any other scorer (the kernel) on a persistent work-stealing thread
+// pool. The exams are split into chunks, and every chunk writes its scores
+// into its own slice of the output, so the results are identical to the
+// kernel's serial run.
+class ParallelScorer final : public BaseScorer {
+ private:
+  std::shared_ptr<BaseScorer> _kernel;
+  ThreadPool _pool;
+  size_t _chunk_size;
+
+  // Aim for chunks whose answers fit in a typical L2 cache
+  static constexpr size_t kChunkBytes = 256 * 1024;
+
+  // The number of exams per chunk, picked or given. It's kept a multiple of
+  // 16 so that two chunks never write into the same cache line of the output
+  // (as long as the output is 64-byte aligned).
+  [[nodiscard]] size_t chunk_size(const size_t &exam_count,
+                                  const size_t &exam_bytes) const {
+    size_t chunk = _chunk_size;
+
+    if (chunk == 0) {
+      chunk = kChunkBytes / std::max<size_t>(exam_bytes, 1);
+      // Keep a few chunks per thread around, so there is something to steal
+      chunk = std::min(chunk, exam_count / (_pool.thread_count() * 4));
+    }
+
+    return std::max<size_t>((chunk + 15) & ~static_cast<size_t>(15), 16);
+  }
+
+ public:
+  // `thread_count` of 0 uses every hardware thread, and `chunk_size` of 0 picks
+  // a cache-sized number of exams per chunk (any other is rounded up to a
+  // multiple of 16, see chunk_size()). With `pin_threads`, every worker
+  // stays on the CPU that first touched its slice of a batch allocated with
+  // NumaPlacement::kParallelFirstTouch and as many threads.
+  explicit ParallelScorer(std::shared_ptr<BaseScorer> kernel,
+                          const size_t &thread_count = 0,
+                          const size_t &chunk_size = 0,
+                          const bool &pin_threads = false)
+      : _kernel(std::move(kernel)),
+        _pool(thread_count, pin_threads),
+        _chunk_size(chunk_size) {}
+
+  [[nodiscard]] size_t thread_count() const { return _pool.thread_count(); }
+
+  void ensure_cpu_support() const override { _kernel->ensure_cpu_support(); }
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    const size_t count = last - first;
+    const size_t chunk = chunk_size(count, correct_answers.capacity());
+
+    _pool.run((count + chunk - 1) / chunk, [&](const size_t &c) {
+      const size_t begin = first + c * chunk;
+      const size_t end = std::min(begin + chunk, last);
+      _kernel->score_range(exams, begin, end, correct_answers, points,
+                           out + (begin - first));
+    });
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    const size_t chunk = chunk_size(count, pitch);
+
+    _pool.run((count + chunk - 1) / chunk, [&](const size_t &c) {
+      const size_t begin = c * chunk;
+      const size_t end = std::min(begin + chunk, count);
+      _kernel->score_rows(rows + begin * pitch, pitch, end - begin,
+                          correct_answers, points, out + begin);
+    });
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    const size_t chunk = chunk_size(count, correct_answers.capacity());
+
+    _pool.run((count + chunk - 1) / chunk, [&](const size_t &c) {
+      const size_t begin = c * chunk;
+      const size_t end = std::min(begin + chunk, count);
+      _kernel->score_row_pointers(rows + begin, end - begin, correct_answers,
+                                  points, out + begin);
+    });
+  }
+
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    const size_t count = exams.exam_count();
+    const size_t chunk = chunk_size(count, exams.stride());
+
+    _pool.run((count + chunk - 1) / chunk, [&](const size_t &c) {
+      const size_t begin = c * chunk;
+      const size_t end = std::min(begin + chunk, count);
+      _kernel->score_view(
+          ExamBatchView(exams.row(begin).data(), end - begin,
+                        exams.question_count(), exams.stride()),
+          correct_answers, points, out + begin);
+    });
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef PERF_COUNTERS_H_INCLUDED
+#define PERF_COUNTERS_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// The hardware events measured around the scorers, to tell whether a kernel
+// is bound by the front-end, the caches, the TLB or the branch predictor
+enum class PerfEvent : size_t {
+  kCycles,
+  kInstructions,
+  kL1dMisses,
+  kLlcMisses,
+  kDtlbMisses,
+  kBranchMisses,
+};
+
+constexpr size_t kPerfEventCount = 6;
+
+// A short name for each event, e.g. for benchmark counters
+const char *perf_event_name(const PerfEvent &event);
+
+// The counts accumulated by PerfCounters. An event that couldn't be opened
+// is unavailable and stays at 0.
+struct PerfCounts {
+  std::array<uint64_t, kPerfEventCount> values{};
+  std::array<bool, kPerfEventCount> available{};
+
+  [[nodiscard]] uint64_t operator[](const PerfEvent &event) const {
+    return values[static_cast<size_t>(event)];
+  }
+  [[nodiscard]] bool has(const PerfEvent &event) const {
+    return available[static_cast<size_t>(event)];
+  }
+};
+
+// Linux perf_event_open counters for the thread that creates them, user space
+// only (the threads of a ParallelScorer are not counted). Every event is
+// opened on its own, so a PMU that lacks one of them (or a VM without any, or
+// a perf_event_paranoid that forbids them) only disables those: start() and
+// stop() are then no-ops for them. When the kernel multiplexes the events,
+// the counts are scaled to the whole time they were enabled.
+class PerfCounters {
+ private:
+  std::array<int, kPerfEventCount> _fds;
+  PerfCounts _counts;
+  bool _running = false;
+
+ public:
+  PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // Whether at least one event could be opened
+  [[nodiscard]] bool available() const;
+  [[nodiscard]] const PerfCounts &counts() const { return _counts; }
+
+  // Count from now on, until stop() adds what was counted to counts()
+  void start();
+  void stop();
+  void reset() { _counts.values = {}; }
+
+  ~PerfCounters();
+};
+
+// Counts the lifetime of the scope with `counters`, if any, so that the
+// instrumentation can be left in place and turned on by passing counters
+class PerfScope {
+ private:
+  PerfCounters *_counters;
+
+ public:
+  explicit PerfScope(PerfCounters *counters) : _counters(counters) {
+    if (_counters) {
+      _counters->start();
+    }
+  }
+
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+  ~PerfScope() {
+    if (_counters) {
+      _counters->stop();
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef RESCORER_HPP
+#define RESCORER_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+
+namespace Scorer {
+// A question whose answer or points changed between two answer keys
+struct KeyChange {
+  uint32_t question;
+  int8_t old_answer;
+  int8_t new_answer;
+  int32_t old_points;
+  int32_t new_points;
+  // Every candidate gets `new_points`, whatever they answered, and
+  // `new_answer` is ignored
+  bool given_to_everyone = false;
+};
+
+// The questions that differ between the old and the new key
+inline std::vector<KeyChange> key_changes(const ByteArray &old_correct_answers,
+                                          const ByteArray &old_points,
+                                          const ByteArray &new_correct_answers,
+                                          const ByteArray &new_points) {
+  const size_t question_count = old_correct_answers.size();
+  if (old_points.size() != question_count ||
+      new_correct_answers.size() != question_count ||
+      new_points.size() != question_count) {
+    throw std::runtime_error(
+        "The old and new correct answers and points must all have the same "
+        "size.");
+  }
+
+  std::vector<KeyChange> changes;
+  for (size_t j = 0; j < question_count; ++j) {
+    if (old_correct_answers[j] != new_correct_answers[j] ||
+        old_points[j] != new_points[j]) {
+      changes.push_back({static_cast<uint32_t>(j), old_correct_answers[j],
+                         new_correct_answers[j], old_points[j],
+                         new_points[j]});
+    }
+  }
+  return changes;
+}
+
+// Void `question` of the key: it's worth 0 points to everyone
+inline KeyChange void_question(const ByteArray &correct_answers,
+                               const ByteArray &points,
+                               const uint32_t &question) {
+  return {question, correct_answers[question], correct_answers[question],
+          points[question], 0};
+}
+
+// Void `question` of the key and give its `points` to every candidate
+inline KeyChange give_to_everyone(const ByteArray &correct_answers,
+                                  const ByteArray &points,
+                                  const uint32_t &question,
+                                  const int32_t &given_points) {
+  return {question, correct_answers[question], correct_answers[question],
+          points[question], given_points, true};
+}
+
+// Brings scores up to date after a correction of the answer key
+class Rescorer {
+ private:
+  // Turn the questions given to everyone into the points added to every
+  // score, without reading the exams, and the removal of their old points
+  // from the candidates who had them right (nothing when they were worth 0)
+  static int32_t split_given_points(std::vector<KeyChange> &changes) {
+    int32_t given = 0;
+    std::vector<KeyChange> answer_changes;
+    for (auto change : changes) {
+      if (change.given_to_everyone) {
+        given += change.new_points;
+        change.new_points = 0;
+        change.given_to_everyone = false;
+        if (change.old_points == 0) {
+          continue;
+        }
+      }
+      answer_changes.push_back(change);
+    }
+    changes = std::move(answer_changes);
+    return given;
+  }
+
+  static void add_given_points(std::vector<int32_t> &scores,
+                               const int32_t &given) {
+    if (given != 0) {
+      for (auto &score : scores) {
+        score += given;
+      }
+    }
+  }
+
+  static int32_t rescore_delta(const int8_t *exam,
+                               const std::vector<KeyChange> &changes) {
+    int32_t delta = 0;
+    for (const auto &change : changes) {
+      const int8_t answer = exam[change.question];
+      delta += (answer == change.new_answer) * change.new_points -
+               (answer == change.old_answer) * change.old_points;
+    }
+    return delta;
+  }
+
+  // Add the deltas of group `g` to its scores, the last group being padded
+  // with zeroed exams
+  static void add_group_delta(const TransposedExamBatch &exams,
+                              const size_t &g, const int32_t *delta,
+                              int32_t *scores) {
+    const size_t first = g << 6;
+    const size_t lanes = std::min<size_t>(64, exams.exam_count() - first);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      scores[first + lane] += delta[lane];
+    }
+  }
+
+  // One compare per key per change turns the 64 answers of a row into two
+  // masks, which add and subtract the points straight into 4 x 16 deltas
+  SIMD_TARGET_AVX512
+  static void rescore_groups_avx512(const TransposedExamBatch &exams,
+                                    const std::vector<KeyChange> &changes,
+                                    int32_t *scores) {
+    alignas(64) int32_t delta[64];
+
+    for (size_t g = 0; g < exams.group_count(); ++g) {
+      const int8_t *group = exams.group(g);
+      __m512i deltas[4] = {_mm512_setzero_si512(), _mm512_setzero_si512(),
+                           _mm512_setzero_si512(), _mm512_setzero_si512()};
+
+      for (const auto &change : changes) {
+        const __m512i row = _mm512_load_si512(
+            group + (static_cast<size_t>(change.question) << 6));
+        const __mmask64 right =
+            _mm512_cmpeq_epi8_mask(row, _mm512_set1_epi8(change.new_answer));
+        const __mmask64 was_right =
+            _mm512_cmpeq_epi8_mask(row, _mm512_set1_epi8(change.old_answer));
+        const __m512i new_points = _mm512_set1_epi32(change.new_points);
+        const __m512i old_points = _mm512_set1_epi32(change.old_points);
+
+        for (size_t k = 0; k < 4; ++k) {
+          deltas[k] = _mm512_mask_add_epi32(
+              deltas[k], static_cast<__mmask16>(right >> (16 * k)), deltas[k],
+              new_points);
+          deltas[k] = _mm512_mask_sub_epi32(
+              deltas[k], static_cast<__mmask16>(was_right >> (16 * k)),
+              deltas[k], old_points);
+        }
+      }
+
+      for (size_t k = 0; k < 4; ++k) {
+        _mm512_store_si512(delta + 16 * k, deltas[k]);
+      }
+      add_group_delta(exams, g, delta, scores);
+    }
+  }
+
+  static void check_rescore(const size_t &exam_count,
+                            const size_t &score_count) {
+    if (exam_count != score_count) {
+      throw std::runtime_error(
+          "There must be one previous score per exam to rescore.");
+    }
+  }
+
+  static void check_exam(const size_t &exam_size,
+                         const ByteArray &correct_answers) {
+    if (exam_size != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+  }
+
+  static void check_changes(const size_t &question_count,
+                            const std::vector<KeyChange> &changes) {
+    for (const auto &change : changes) {
+      if (change.question >= question_count) {
+        throw std::runtime_error("A changed question is past the exams' end.");
+      }
+    }
+  }
+
+ public:
+  // Update `scores`, computed with the old key, to the scores of the new key.
+  // Only the answers to the changed questions are read: one gathered byte per
+  // changed question and exam, instead of whole exams, so the cost follows the
+  // number of changes rather than the exam width. The result is the same as
+  // scoring the exams again with the new key.
+  void rescore(const ExamBatch &exams, std::vector<int32_t> &scores,
+               const ByteArray &old_correct_answers,
+               const ByteArray &old_points,
+               const ByteArray &new_correct_answers,
+               const ByteArray &new_points) {
+    check_exam(exams.question_count(), new_correct_answers);
+    rescore(exams, scores,
+            key_changes(old_correct_answers, old_points, new_correct_answers,
+                        new_points));
+  }
+
+  // The same with the changes themselves, e.g. the questions voided or given
+  // to everyone (see void_question and give_to_everyone)
+  void rescore(const ExamBatch &exams, std::vector<int32_t> &scores,
+               std::vector<KeyChange> changes) {
+    check_rescore(exams.exam_count(), scores.size());
+    check_changes(exams.question_count(), changes);
+    add_given_points(scores, split_given_points(changes));
+    if (changes.empty()) {
+      return;
+    }
+
+    // Exam by exam, so the lines that hold several changed questions are only
+    // loaded once
+    const int8_t *rows = exams.data();
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      scores[i] += rescore_delta(rows + i * exams.pitch(), changes);
+    }
+  }
+
+  void rescore(const std::vector<ByteArray> &exams,
+               std::vector<int32_t> &scores,
+               const ByteArray &old_correct_answers,
+               const ByteArray &old_points,
+               const ByteArray &new_correct_answers,
+               const ByteArray &new_points) {
+    for (const auto &exam : exams) {
+      check_exam(exam.size(), new_correct_answers);
+    }
+    rescore(exams, scores,
+            key_changes(old_correct_answers, old_points, new_correct_answers,
+                        new_points));
+  }
+
+  void rescore(const std::vector<ByteArray> &exams,
+               std::vector<int32_t> &scores, std::vector<KeyChange> changes) {
+    check_rescore(exams.size(), scores.size());
+    for (const auto &exam : exams) {
+      check_changes(exam.size(), changes);
+    }
+    add_given_points(scores, split_given_points(changes));
+    for (size_t i = 0; i < exams.size(); ++i) {
+      scores[i] += rescore_delta(exams[i].data(), changes);
+    }
+  }
+
+  // The same on question-major exams, where the answers of 64 exams to a
+  // changed question are one contiguous 64-byte row: every change costs a
+  // single vectorized pass over one row per group (with AVX-512 when the CPU
+  // has it).
+  void rescore(const TransposedExamBatch &exams, std::vector<int32_t> &scores,
+               const ByteArray &old_correct_answers,
+               const ByteArray &old_points,
+               const ByteArray &new_correct_answers,
+               const ByteArray &new_points) {
+    check_exam(exams.question_count(), new_correct_answers);
+    rescore(exams, scores,
+            key_changes(old_correct_answers, old_points, new_correct_answers,
+                        new_points));
+  }
+
+  void rescore(const TransposedExamBatch &exams, std::vector<int32_t> &scores,
+               std::vector<KeyChange> changes) {
+    check_rescore(exams.exam_count(), scores.size());
+    check_changes(exams.question_count(), changes);
+    add_given_points(scores, split_given_points(changes));
+    if (changes.empty()) {
+      return;
+    }
+
+    if (Cpu::supports_avx512()) {
+      rescore_groups_avx512(exams, changes, scores.data());
+      return;
+    }
+
+    for (size_t g = 0; g < exams.group_count(); ++g) {
+      const int8_t *group = exams.group(g);
+      int32_t delta[64] = {};
+
+      for (const auto &change : changes) {
+        const int8_t *row =
+            group + (static_cast<size_t>(change.question) << 6);
+        for (size_t lane = 0; lane < 64; ++lane) {
+          delta[lane] += (row[lane] == change.new_answer) * change.new_points -
+                         (row[lane] == change.old_answer) * change.old_points;
+        }
+      }
+
+      add_group_delta(exams, g, delta, scores.data());
+    }
+  }
+};
+}  // namespace Scorer
+
+#endif
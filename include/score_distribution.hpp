@@ -0,0 +1,324 @@
+#ifndef SCORE_DISTRIBUTION_HPP
+#define SCORE_DISTRIBUTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "exam.h"
+#include "thread_pool.hpp"
+
+namespace Scorer {
+// The lowest and the highest score that `points` can give, whatever the
+// answers are
+inline std::pair<int32_t, int32_t> score_bounds(const ByteArray &points) {
+  int32_t min_score = 0, max_score = 0;
+  for (const auto &point : points) {
+    (point < 0 ? min_score : max_score) += point;
+  }
+  return {min_score, max_score};
+}
+
+// The same, when a wrong answer subtracts `penalties[j]` (see
+// BaseWeightedScorer)
+template <typename Point>
+std::pair<int32_t, int32_t> score_bounds(const PointArray<Point> &points,
+                                         const PointArray<Point> &penalties) {
+  int32_t min_score = 0, max_score = 0;
+  for (size_t j = 0; j < points.size(); ++j) {
+    // A blank gives 0
+    const int32_t correct = points[j], wrong = -int32_t{penalties[j]};
+    min_score += std::min({correct, wrong, 0});
+    max_score += std::max({correct, wrong, 0});
+  }
+  return {min_score, max_score};
+}
+
+// The distribution of the scores of a batch, for ranking the candidates. The
+// scores are bounded (see score_bounds), so one histogram with a counter per
+// possible score is built in a single pass, and its prefix sums answer the
+// rank, percentile and cut-off queries in O(1) and order the candidates with
+// a counting sort, instead of sorting the scores.
+//
+// Candidates are ranked from the highest score, tied candidates sharing the
+// same (competition) rank: 1, 2, 2, 4...
+class ScoreDistribution {
+ private:
+  int32_t _min_score;
+  int32_t _max_score;
+  size_t _count;
+  std::vector<uint32_t> _histogram;
+  // _above[s - min] is the number of scores greater than s, one more entry
+  // holds the total
+  std::vector<uint32_t> _above;
+
+  [[nodiscard]] size_t bucket(const int32_t &score) const {
+    return static_cast<size_t>(static_cast<int64_t>(score) - _min_score);
+  }
+
+  // The lowest score that at most `above` candidates exceeded
+  [[nodiscard]] int32_t lowest_score_with_above(const size_t &above) const {
+    const auto it = std::partition_point(
+        _above.begin(), _above.end() - 1,
+        [&](const uint32_t &count) { return count > above; });
+    return _min_score + static_cast<int32_t>(it - _above.begin());
+  }
+
+  [[noreturn]] void throw_out_of_bounds() const {
+    throw std::runtime_error("A score is out of the [" +
+                             std::to_string(_min_score) + ", " +
+                             std::to_string(_max_score) + "] bounds.");
+  }
+
+  // The bucket of a score of the scores being ranked, checked like in the
+  // constructor
+  [[nodiscard]] size_t checked_bucket(const int32_t &score) const {
+    const size_t b = bucket(score);
+    if (b >= _histogram.size()) {
+      throw_out_of_bounds();
+    }
+    return b;
+  }
+
+  // The scores being ranked must be the ones the distribution was built from
+  void check_scores(const std::vector<int32_t> &scores) const {
+    if (scores.size() != _count) {
+      throw std::runtime_error(
+          "The scores must be the ones the distribution was built from.");
+    }
+  }
+
+  // The next free position of bucket `b`, throwing once the scores hold more
+  // of it than the histogram counted
+  [[nodiscard]] uint32_t take_position(std::vector<uint32_t> &next,
+                                       const size_t &index,
+                                       const size_t &b) const {
+    if (next[index] >= _above[b] + _histogram[b]) {
+      throw std::runtime_error(
+          "The scores must be the ones the distribution was built from.");
+    }
+    return next[index]++;
+  }
+
+  // Split [0, count) into the pool's threads, or run it in one go
+  template <typename Task>
+  static void for_each_chunk(const size_t &count, ThreadPool *pool,
+                             const Task &task) {
+    const size_t chunks = pool ? pool->thread_count() : 1;
+    if (chunks <= 1) {
+      task(0, 0, count);
+      return;
+    }
+
+    pool->run(chunks, [&](const size_t &c) {
+      task(c, count * c / chunks, count * (c + 1) / chunks);
+    });
+  }
+
+  // Count the scores in [first, last), 4 at a time
+  void count_scores(const int32_t *scores, const size_t &first,
+                    const size_t &last, uint32_t *histogram) const {
+    const uint32_t range = static_cast<uint32_t>(_histogram.size());
+    bool in_range = true;
+    size_t i = first;
+
+    for (; i + 4 <= last; i += 4) {
+      const auto b0 = static_cast<uint32_t>(bucket(scores[i]));
+      const auto b1 = static_cast<uint32_t>(bucket(scores[i + 1]));
+      const auto b2 = static_cast<uint32_t>(bucket(scores[i + 2]));
+      const auto b3 = static_cast<uint32_t>(bucket(scores[i + 3]));
+      // A score below the minimum wraps around to a huge bucket
+      in_range &= (b0 < range) & (b1 < range) & (b2 < range) & (b3 < range);
+      if (in_range) {
+        ++histogram[b0];
+        ++histogram[b1];
+        ++histogram[b2];
+        ++histogram[b3];
+      }
+    }
+    for (; i < last && in_range; ++i) {
+      const auto b = static_cast<uint32_t>(bucket(scores[i]));
+      in_range = b < range;
+      if (in_range) {
+        ++histogram[b];
+      }
+    }
+
+    if (!in_range) {
+      throw_out_of_bounds();
+    }
+  }
+
+ public:
+  // Build the distribution of `scores`, which must all lie in
+  // [min_score, max_score]. With a pool, every thread counts a part of the
+  // scores into its own histogram.
+  ScoreDistribution(const std::vector<int32_t> &scores,
+                    const int32_t &min_score, const int32_t &max_score,
+                    ThreadPool *pool = nullptr)
+      : _min_score(min_score), _max_score(max_score), _count(scores.size()) {
+    if (min_score > max_score) {
+      throw std::runtime_error("The minimum score must not exceed the maximum.");
+    }
+    if (scores.size() > UINT32_MAX) {
+      throw std::runtime_error("Too many scores to rank.");
+    }
+
+    const size_t range = bucket(max_score) + 1;
+    _histogram.assign(range, 0);
+
+    const size_t chunks = pool ? pool->thread_count() : 1;
+    std::vector<std::vector<uint32_t>> partial(chunks > 1 ? chunks - 1 : 0,
+                                               std::vector<uint32_t>(range, 0));
+    for_each_chunk(scores.size(), pool,
+                   [&](const size_t &c, const size_t &first,
+                       const size_t &last) {
+                     count_scores(scores.data(), first, last,
+                                  c ? partial[c - 1].data()
+                                    : _histogram.data());
+                   });
+    for (const auto &histogram : partial) {
+      for (size_t b = 0; b < range; ++b) {
+        _histogram[b] += histogram[b];
+      }
+    }
+
+    _above.resize(range + 1);
+    _above[range - 1] = 0;
+    for (size_t b = range - 1; b > 0; --b) {
+      _above[b - 1] = _above[b] + _histogram[b];
+    }
+    _above[range] = static_cast<uint32_t>(_count);
+  }
+
+  // Getters
+  [[nodiscard]] size_t size() const { return _count; }
+  [[nodiscard]] int32_t min_score() const { return _min_score; }
+  [[nodiscard]] int32_t max_score() const { return _max_score; }
+  // histogram()[s - min_score()] is the number of candidates who scored s
+  [[nodiscard]] const std::vector<uint32_t> &histogram() const {
+    return _histogram;
+  }
+
+  // The number of candidates who scored more than `score`
+  [[nodiscard]] size_t count_above(const int32_t &score) const {
+    if (score < _min_score) return _count;
+    if (score >= _max_score) return 0;
+    return _above[bucket(score)];
+  }
+
+  // The number of candidates who scored at least `score`, i.e. who pass a
+  // cut-off of `score`
+  [[nodiscard]] size_t count_at_least(const int32_t &score) const {
+    if (score <= _min_score) return _count;
+    if (score > _max_score) return 0;
+    return _above[bucket(score) - 1];
+  }
+
+  // The rank of a candidate who scored `score`
+  [[nodiscard]] size_t rank(const int32_t &score) const {
+    return count_above(score) + 1;
+  }
+
+  // The percentage of candidates who scored less than `score`, ties counting
+  // as half
+  [[nodiscard]] double percentile_rank(const int32_t &score) const {
+    if (_count == 0) return 0;
+    const size_t below = _count - count_at_least(score);
+    const size_t ties = count_at_least(score) - count_above(score);
+    return 100.0 * (static_cast<double>(below) + 0.5 * ties) /
+           static_cast<double>(_count);
+  }
+
+  // The lowest score that at least `percent`% of the candidates didn't exceed
+  // (the nearest-rank percentile), `percent` being in (0, 100]
+  [[nodiscard]] int32_t percentile(const double &percent) const {
+    if (_count == 0 || !(percent > 0 && percent <= 100)) {
+      throw std::runtime_error(
+          "The percentile of an empty distribution, or outside of (0, 100], is "
+          "undefined.");
+    }
+
+    const auto needed = std::min(
+        _count, static_cast<size_t>(
+                    std::ceil(percent / 100.0 * static_cast<double>(_count))));
+    return lowest_score_with_above(_count - needed);
+  }
+
+  // The rank of every candidate. `scores` must be the ones the distribution
+  // was built from, and this throws if they can't be.
+  [[nodiscard]] std::vector<uint32_t> ranks(const std::vector<int32_t> &scores,
+                                            ThreadPool *pool = nullptr) const {
+    check_scores(scores);
+    std::vector<uint32_t> result(scores.size());
+
+    for_each_chunk(scores.size(), pool,
+                   [&](const size_t &, const size_t &first,
+                       const size_t &last) {
+                     for (size_t i = first; i < last; ++i) {
+                       result[i] = _above[checked_bucket(scores[i])] + 1;
+                     }
+                   });
+
+    return result;
+  }
+
+  // The indices of the `k` best candidates, best first and ties in index
+  // order. Only the candidates at or above the k-th best score are placed,
+  // straight at their final position.
+  [[nodiscard]] std::vector<uint32_t> top_k(const std::vector<int32_t> &scores,
+                                            size_t k) const {
+    check_scores(scores);
+    k = std::min(k, _count);
+    if (k == 0) {
+      return {};
+    }
+
+    // The k-th best score, and how many of its ties make the cut
+    const int32_t threshold = lowest_score_with_above(k - 1);
+    size_t ties_left = k - count_above(threshold);
+
+    std::vector<uint32_t> next(_above.begin() + bucket(threshold),
+                               _above.begin() + bucket(_max_score) + 1);
+    std::vector<uint32_t> result(k);
+
+    for (size_t i = 0; i < scores.size(); ++i) {
+      if (scores[i] < threshold) {
+        continue;
+      }
+      if (scores[i] == threshold) {
+        if (ties_left == 0) {
+          continue;
+        }
+        --ties_left;
+      }
+      const size_t b = checked_bucket(scores[i]);
+      result[take_position(next, b - bucket(threshold), b)] =
+          static_cast<uint32_t>(i);
+    }
+
+    return result;
+  }
+
+  // The indices of all the candidates, best first and ties in index order.
+  // Since the histogram already holds the offset of every score, this is a
+  // stable radix sort with a single digit (the whole score), in one pass.
+  [[nodiscard]] std::vector<uint32_t> stable_order(
+      const std::vector<int32_t> &scores) const {
+    check_scores(scores);
+    std::vector<uint32_t> next(_above.begin(), _above.end() - 1);
+    std::vector<uint32_t> result(scores.size());
+
+    for (size_t i = 0; i < scores.size(); ++i) {
+      const size_t b = checked_bucket(scores[i]);
+      result[take_position(next, b, b)] = static_cast<uint32_t>(i);
+    }
+
+    return result;
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef SCORERS_HPP
 #define SCORERS_HPP
 
-#include <immintrin.h>
+#include <memory>
 
+#include "cpu.hpp"
 #include "exam.h"
+#include "scoring_report.hpp"
 
 namespace Scorer {
 class BaseScorer {
@@ -12,228 +14,1031 @@ class BaseScorer {
 
   virtual std::vector<int32_t> score(const std::vector<ByteArray> &exams,
                                      const ByteArray &correct_answers,
-                                     const ByteArray &points) = 0;
-};
+                                     const ByteArray &points) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_answers(correct_answers, points);
+
+    std::vector<int32_t> scored_exams_points(exams.size());
+    score_range(exams, 0, exams.size(), correct_answers, points,
+                scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  virtual std::vector<int32_t> score(const ExamBatch &exams,
+                                     const ByteArray &correct_answers,
+                                     const ByteArray &points) {
+    ensure_cpu_support();
 
-class NaiveScorer final : public BaseScorer {
- public:
-  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
-                             const ByteArray &correct_answers,
-                             const ByteArray &points) override {
     if (exams.empty()) {
       return {};
     }
 
+    check_answers(correct_answers, points);
+    check_exam(exams.question_count(), correct_answers);
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    score_rows(exams.data(), exams.pitch(), exams.exam_count(),
+               correct_answers, points, scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  // Score exams borrowed from any buffer (see ExamBatchView), against a key
+  // and points that may be borrowed too. Nothing is copied or padded, the
+  // kernels never read past the end of a row.
+  virtual std::vector<int32_t> score(const ExamBatchView &exams,
+                                     const ByteArrayView &correct_answers,
+                                     const ByteArrayView &points) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_answers(correct_answers, points);
+    check_exam(exams.question_count(), correct_answers);
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    score_view(exams, correct_answers, points, scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  // Score the exams of `exams` and write the results to out[0, exam_count)
+  virtual void score_view(const ExamBatchView &exams,
+                          const ByteArrayView &correct_answers,
+                          const ByteArrayView &points, int32_t *out) {
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      const int8_t *exam = exams.row(i).data();
+      int32_t score = 0;
+      for (size_t j = 0; j < correct_answers.size(); ++j) {
+        score +=
+            (exam[j] == correct_answers[j]) * static_cast<int32_t>(points[j]);
+      }
+      out[i] = score;
+    }
+  }
+
+  // Score exams[first, last) and write the results to out[0, last - first)
+  virtual void score_range(const std::vector<ByteArray> &exams,
+                           const size_t &first, const size_t &last,
+                           const ByteArray &correct_answers,
+                           const ByteArray &points, int32_t *out) = 0;
+
+  // Score `count` exams stored `pitch` bytes apart, starting at `rows`, and
+  // write the results to out[0, count). Like an ExamBatch, every row must be
+  // readable (and zero-padded) up to `correct_answers.capacity()` bytes.
+  virtual void score_rows(const int8_t *rows, const size_t &pitch,
+                          const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) = 0;
+
+  // Score the `count` exams pointed to by `rows` and write the results to
+  // out[0, count), with the same padding requirements as `score_rows`. This is
+  // how scattered exams (e.g. the ones sharing an answer key) are scored
+  // without copying them together first.
+  virtual void score_row_pointers(const int8_t *const *rows,
+                                  const size_t &count,
+                                  const ByteArray &correct_answers,
+                                  const ByteArray &points, int32_t *out) {
+    for (size_t i = 0; i < count; ++i) {
+      score_rows(rows[i], 0, 1, correct_answers, points, out + i);
+    }
+  }
+
+  // Throw if the CPU can't run this scorer
+  virtual void ensure_cpu_support() const {}
+
+ protected:
+  static void check_answers(const ByteArray &correct_answers,
+                            const ByteArray &points) {
     if (correct_answers.size() != points.size()) {
       throw std::runtime_error(
           "The size of correct answers and points must be the same.");
     }
+  }
 
-    std::vector<int32_t> scored_exams_points(exams.size());
+  static void check_exam(const size_t &exam_size,
+                         const ByteArray &correct_answers) {
+    if (exam_size != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+  }
 
-    for (size_t i = 0; i < exams.size(); ++i) {
-      if (exams[i].size() != correct_answers.size()) {
-        throw std::runtime_error(
-            "The size of exams' questions and correct answers must be the "
-            "same.");
+  static void check_answers(const ByteArrayView &correct_answers,
+                            const ByteArrayView &points) {
+    if (correct_answers.size() != points.size()) {
+      throw std::runtime_error(
+          "The size of correct answers and points must be the same.");
+    }
+  }
+
+  static void check_exam(const size_t &exam_size,
+                         const ByteArrayView &correct_answers) {
+    if (exam_size != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+  }
+};
+
+class NaiveScorer final : public BaseScorer {
+ public:
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    for (size_t i = first; i < last; ++i) {
+      check_exam(exams[i].size(), correct_answers);
+      out[i - first] = score_exam(exams[i].data(), correct_answers, points);
+    }
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points);
+    }
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      if (i + 1 < count) {
+        __builtin_prefetch(rows[i + 1]);
       }
+      out[i] = score_exam(rows[i], correct_answers, points);
+    }
+  }
 
-      for (size_t j = 0; j < exams[i].size(); ++j) {
-        if (exams[i][j] == correct_answers[j]) {
-          scored_exams_points[i] += static_cast<int32_t>(points[j]);
-        }
+ private:
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    int32_t score = 0;
+
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      if (exam[j] == correct_answers[j]) {
+        score += static_cast<int32_t>(points[j]);
       }
     }
 
-    return scored_exams_points;
+    return score;
   }
 };
 
 class BooleanMultiplicationScorer final : public BaseScorer {
  public:
-  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
-                             const ByteArray &correct_answers,
-                             const ByteArray &points) override {
-    if (exams.empty()) {
-      return {};
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    for (size_t i = first; i < last; ++i) {
+      check_exam(exams[i].size(), correct_answers);
+      out[i - first] = score_exam(exams[i].data(), correct_answers, points);
     }
+  }
 
-    if (correct_answers.size() != points.size()) {
-      throw std::runtime_error(
-          "The size of correct answers and points must be the same.");
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points);
     }
+  }
 
-    std::vector<int32_t> scored_exams_points(exams.size());
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      if (i + 1 < count) {
+        __builtin_prefetch(rows[i + 1]);
+      }
+      out[i] = score_exam(rows[i], correct_answers, points);
+    }
+  }
+
+ private:
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    int32_t score = 0;
 
-    for (size_t i = 0; i < exams.size(); ++i) {
-      if (exams[i].size() != correct_answers.size()) {
-        throw std::runtime_error(
-            "The size of exams' questions and correct answers must be the "
-            "same.");
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      // Idea: to reduce false branch predictions
+      score += (exam[j] == correct_answers[j]) * static_cast<int32_t>(points[j]);
+    }
+
+    return score;
+  }
+};
+
+class SimdSse41Scorer final : public BaseScorer {
+ public:
+  SIMD_TARGET_SSE41
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    // Process each exam
+    for (size_t i = first; i < last; ++i) {
+      auto &exam = exams[i];
+
+      // Prefetch the next exam's answers
+      if (i + 1 < last) {
+        __builtin_prefetch(exams[i + 1].data());
       }
 
-      for (size_t j = 0; j < exams[i].size(); ++j) {
-        // Idea: to reduce false branch predictions
-        scored_exams_points[i] += (exams[i][j] == correct_answers[j]) *
-                                  static_cast<int32_t>(points[j]);
+      check_exam(exam.size(), correct_answers);
+      out[i - first] = score_exam(exam.data(), correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_SSE41
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_SSE41
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      if (i + 1 < count) {
+        __builtin_prefetch(rows[i + 1]);
       }
+      out[i] = score_exam(rows[i], correct_answers, points);
     }
+  }
 
-    return scored_exams_points;
+  SIMD_TARGET_SSE41
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      out[i] = score_view_exam(exams.row(i).data(), correct_answers.data(),
+                               points.data(), correct_answers.size());
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_sse41()) {
+      throw std::runtime_error(
+          "SIMD SSE4.1 checker not supported because the CPU lacks SSE4.1 "
+          "support.");
+    }
+  }
+
+ private:
+  SIMD_TARGET_SSE41
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    int32_t score = 0;
+
+    // Same as the AVX2 kernel, but with 128-bit registers
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_sse41();
+         ++j, _j = j << 4) {
+      __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(exam + _j));
+      __m128i v2 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(correct_answers.data() + _j));
+
+      v1 = _mm_cmpeq_epi8(v1, v2);
+      v2 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(points.data() + _j));
+      v1 = _mm_and_si128(v1, v2);
+
+      // 2 sums, in the first 16 bits of both 64-bit halves
+      v1 = _mm_sad_epu8(v1, _mm_setzero_si128());
+      score += _mm_extract_epi16(v1, 0) + _mm_extract_epi16(v1, 4);
+    }
+
+    return score;
+  }
+
+  // The same kernel on unpadded rows: SSE has no masked byte loads, so the
+  // last `size % 16` answers are scored one by one
+  SIMD_TARGET_SSE41
+  static int32_t score_view_exam(const int8_t *exam, const int8_t *key,
+                                 const int8_t *points, const size_t &size) {
+    __m128i sums = _mm_setzero_si128();
+    size_t j = 0;
+
+    for (; j + 16 <= size; j += 16) {
+      __m128i v1 = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(exam + j)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + j)));
+      v1 = _mm_and_si128(
+          v1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(points + j)));
+      sums = _mm_add_epi64(sums, _mm_sad_epu8(v1, _mm_setzero_si128()));
+    }
+
+    auto score = static_cast<int32_t>(_mm_cvtsi128_si64(sums) +
+                                      _mm_extract_epi64(sums, 1));
+    for (; j < size; ++j) {
+      // Unsigned, like the SAD
+      score += (exam[j] == key[j]) * static_cast<uint8_t>(points[j]);
+    }
+
+    return score;
   }
 };
 
 class SimdScorer final : public BaseScorer {
  public:
-  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
-                             const ByteArray &correct_answers,
-                             const ByteArray &points) override {
-    if (!__builtin_cpu_supports("avx2")) {
+  SIMD_TARGET_AVX2
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    // Process each exam
+    for (size_t i = first; i < last; ++i) {
+      auto &exam = exams[i];
+
+      // Prefetch the next exam's answers (not just its ByteArray header)
+      // https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html
+      if (i + 1 < last) {
+        __builtin_prefetch(exams[i + 1].data());
+      }
+
+      check_exam(exam.size(), correct_answers);
+      out[i - first] = score_exam(exam.data(), correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_AVX2
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    // The rows are contiguous, so the hardware prefetcher streams them for us
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_AVX2
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      if (i + 1 < count) {
+        __builtin_prefetch(rows[i + 1]);
+      }
+      out[i] = score_exam(rows[i], correct_answers, points);
+    }
+  }
+
+  // Score the exams and, in the same pass, compute the item analysis of
+  // every question (see ScoringReport)
+  ScoringReport score_with_report(const std::vector<ByteArray> &exams,
+                                  const ByteArray &correct_answers,
+                                  const ByteArray &points) {
+    for (const auto &exam : exams) {
+      check_exam(exam.size(), correct_answers);
+    }
+
+    return report_rows(
+        exams.size(),
+        [&](const size_t &i) -> const int8_t * { return exams[i].data(); },
+        correct_answers, points);
+  }
+
+  ScoringReport score_with_report(const ExamBatch &exams,
+                                  const ByteArray &correct_answers,
+                                  const ByteArray &points) {
+    if (!exams.empty()) {
+      check_exam(exams.question_count(), correct_answers);
+    }
+
+    return report_rows(
+        exams.exam_count(),
+        [&](const size_t &i) -> const int8_t * {
+          return exams.row(i).data();
+        },
+        correct_answers, points);
+  }
+
+  SIMD_TARGET_AVX2
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      out[i] = score_view_exam(exams.row(i).data(), correct_answers.data(),
+                               points.data(), correct_answers.size());
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx2()) {
       throw std::runtime_error(
           "SIMD checker not supported because the CPU lacks AVX2 support.");
     }
+  }
 
-    if (exams.empty()) {
-      return {};
+ private:
+  template <typename Row>
+  ScoringReport report_rows(const size_t &count, const Row &row,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    ensure_cpu_support();
+    check_answers(correct_answers, points);
+
+    ScoringReportBuilder report(correct_answers);
+    std::vector<int32_t> scores(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      scores[i] = score_exam(row(i), correct_answers, points, report);
     }
 
-    const auto answers_size = correct_answers.size();
+    return report.finish(std::move(scores));
+  }
 
-    if (answers_size != points.size()) {
-      throw std::runtime_error(
-          "The size of correct answers and points must be the same.");
+  SIMD_TARGET_AVX2
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    int32_t score = 0;
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
+         ++j, _j = j << 5) {
+      // Vectorize exam's MCQs
+      __m256i v1 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(exam + _j));
+      // Vectorize correct MCQs
+      __m256i v2 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(correct_answers.data() + _j));
+
+      // Mark the correct answers with 0xff, otherwise 0
+      v1 = _mm256_cmpeq_epi8(v1, v2);
+      // Vectorize points
+      v2 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(points.data() + _j));
+
+      // Imagine that we have a mark vector of 3 elements 0xff00ff, and the
+      // points are 0x010101, 0xff00ff & 0x010101 = 0x010001, which is
+      // correct. Hence, the use of bitwise AND.
+      v1 = _mm256_and_si256(v1, v2);
+      // Reference:
+      // https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#text=_mm256_sad_epu8&ig_expand=5674
+      // This will produce 4 sums, stored in the first 16 bits of every 64-bit
+      // block inside the 256-bit vector
+      v1 = _mm256_sad_epu8(v1, _mm256_setzero_si256());
+      score += _mm256_extract_epi16(v1, 0) + _mm256_extract_epi16(v1, 4) +
+               _mm256_extract_epi16(v1, 8) + _mm256_extract_epi16(v1, 12);
     }
 
-    std::vector<int32_t> scored_exams_points(exams.size(), 0);
+    return score;
+  }
 
-    // Process each exam
-    for (size_t i = 0; i < exams.size(); ++i) {
-      auto &exam = exams[i];
+  // The same kernel on unpadded rows. AVX2 only masks 32-bit lanes, so the
+  // whole words of the tail are loaded with vpmaskmovd (the masked-out lanes
+  // read as 0 and never fault), and its last 0-3 answers are scored one by
+  // one.
+  SIMD_TARGET_AVX2
+  static int32_t score_view_exam(const int8_t *exam, const int8_t *key,
+                                 const int8_t *points, const size_t &size) {
+    __m256i sums = _mm256_setzero_si256();
+    size_t j = 0;
 
-      // Prefetch the next exam
-      // https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html
-      if (i + 1 < exams.size()) {
-        __builtin_prefetch(&exams[i + 1]);
-      }
-
-      if (exam.size() != answers_size) {
-        throw std::runtime_error(
-            "The size of exams' questions and correct answers must be the "
-            "same.");
-      }
-
-      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
-           ++j, _j = j << 5) {
-        // Vectorize exam's MCQs
-        __m256i v1 = _mm256_loadu_si256(
-            reinterpret_cast<const __m256i *>(exam.data() + _j));
-        // Vectorize correct MCQs
-        __m256i v2 = _mm256_loadu_si256(
-            reinterpret_cast<const __m256i *>(correct_answers.data() + _j));
-
-        // Mark the correct answers with 0xff, otherwise 0
-        v1 = _mm256_cmpeq_epi8(v1, v2);
-        // Vectorize points
-        v2 = _mm256_loadu_si256(
-            reinterpret_cast<const __m256i *>(points.data() + _j));
-
-        // Imagine that we have a mark vector of 3 elements 0xff00ff, and the
-        // points are 0x010101, 0xff00ff & 0x010101 = 0x010001, which is
-        // correct. Hence, the use of bitwise AND.
-        v1 = _mm256_and_si256(v1, v2);
-        // Reference:
-        // https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#text=_mm256_sad_epu8&ig_expand=5674
-        // This will produce 4 sums, stored in the first 16 bits of every 64-bit
-        // block inside the 256-bit vector
-        v1 = _mm256_sad_epu8(v1, _mm256_setzero_si256());
-        scored_exams_points[i] +=
-            _mm256_extract_epi16(v1, 0) + _mm256_extract_epi16(v1, 4) +
-            _mm256_extract_epi16(v1, 8) + _mm256_extract_epi16(v1, 12);
+    for (; j + 32 <= size; j += 32) {
+      sums = _mm256_add_epi64(
+          sums, score_block_avx2(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(exam + j)),
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(key + j)),
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(points + j))));
+    }
+
+    if (const size_t words = (size - j) >> 2; words != 0) {
+      const __m256i lanes = _mm256_cmpgt_epi32(
+          _mm256_set1_epi32(static_cast<int>(words)),
+          _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+      sums = _mm256_add_epi64(
+          sums,
+          score_block_avx2(
+              _mm256_maskload_epi32(reinterpret_cast<const int *>(exam + j),
+                                    lanes),
+              _mm256_maskload_epi32(reinterpret_cast<const int *>(key + j),
+                                    lanes),
+              _mm256_maskload_epi32(reinterpret_cast<const int *>(points + j),
+                                    lanes)));
+      j += words << 2;
+    }
+
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums),
+                                       _mm256_extracti128_si256(sums, 1));
+    auto score = static_cast<int32_t>(_mm_cvtsi128_si64(half) +
+                                      _mm_extract_epi64(half, 1));
+    for (; j < size; ++j) {
+      // Unsigned, like the SAD
+      score += (exam[j] == key[j]) * static_cast<uint8_t>(points[j]);
+    }
+
+    return score;
+  }
+
+  // The 4 partial sums of the points of the correct answers of a block
+  SIMD_TARGET_AVX2
+  static __m256i score_block_avx2(const __m256i &answers, const __m256i &keys,
+                                  const __m256i &weights) {
+    return _mm256_sad_epu8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(answers, keys), weights),
+        _mm256_setzero_si256());
+  }
+
+  // The same kernel, which also counts the correct answers and the chosen
+  // options of every question
+  SIMD_TARGET_AVX2
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points,
+                            ScoringReportBuilder &report) {
+    int32_t score = 0;
+    int8_t *correct = report.correct_counters();
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
+         ++j, _j = j << 5) {
+      const __m256i answers =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(exam + _j));
+      __m256i v1 = _mm256_cmpeq_epi8(
+          answers, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                       correct_answers.data() + _j)));
+
+      // Subtracting a 0xff mark adds 1 to the counter
+      auto *counters = reinterpret_cast<__m256i *>(correct + _j);
+      _mm256_storeu_si256(
+          counters, _mm256_sub_epi8(_mm256_loadu_si256(counters), v1));
+      for (size_t o = 0; o < 4; ++o) {
+        counters = reinterpret_cast<__m256i *>(report.option_counters(o) + _j);
+        _mm256_storeu_si256(
+            counters,
+            _mm256_sub_epi8(
+                _mm256_loadu_si256(counters),
+                _mm256_cmpeq_epi8(answers,
+                                  _mm256_set1_epi8(static_cast<char>('A' + o)))));
       }
+
+      v1 = _mm256_and_si256(v1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                                    points.data() + _j)));
+      v1 = _mm256_sad_epu8(v1, _mm256_setzero_si256());
+      score += _mm256_extract_epi16(v1, 0) + _mm256_extract_epi16(v1, 4) +
+               _mm256_extract_epi16(v1, 8) + _mm256_extract_epi16(v1, 12);
     }
 
-    return scored_exams_points;
+    // The exam is still in L1, add its score to the questions it got right.
+    // Every 4 marks are sign-extended into 64-bit lanes, to mask the score.
+    const __m256i s = _mm256_set1_epi64x(score);
+    int64_t *sums = report.correct_score_sums();
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
+         ++j, _j = j << 5) {
+      const __m256i marks = _mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(exam + _j)),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+              correct_answers.data() + _j)));
+
+      for (size_t h = 0; h < 2; ++h) {
+        __m128i half = h ? _mm256_extracti128_si256(marks, 1)
+                         : _mm256_castsi256_si128(marks);
+        for (size_t g = 0; g < 4; ++g, half = _mm_srli_si128(half, 4)) {
+          auto *sum =
+              reinterpret_cast<__m256i *>(sums + _j + (h << 4) + (g << 2));
+          _mm256_storeu_si256(
+              sum, _mm256_add_epi64(_mm256_loadu_si256(sum),
+                                    _mm256_and_si256(
+                                        _mm256_cvtepi8_epi64(half), s)));
+        }
+      }
+    }
+
+    report.add_exam(score);
+    return score;
   }
 };
 
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
 class SimdAvx512Scorer final : public BaseScorer {
  public:
-  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
-                             const ByteArray &correct_answers,
-                             const ByteArray &points) override {
-    // The idea is the same as the AVX2 functions, the only difference is that
-    // we have double the registers' size (512 bits instead of 256 bits)
-    if (!__builtin_cpu_supports("avx512bw") ||
-        !__builtin_cpu_supports("avx512vl") ||
-        !__builtin_cpu_supports("avx512f") ||
-        !__builtin_cpu_supports("avx512dq")) {
+  // The idea is the same as the AVX2 functions, the only difference is that
+  // we have double the registers' size (512 bits instead of 256 bits)
+  SIMD_TARGET_AVX512
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    // Process each exam
+    for (size_t i = first; i < last; ++i) {
+      auto &exam = exams[i];
+
+      // Prefetch the next exam's answers
+      if (i + 1 < last) {
+        __builtin_prefetch(exams[i + 1].data());
+      }
+
+      check_exam(exam.size(), correct_answers);
+      out[i - first] = score_exam(exam.data(), correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      if (i + 1 < count) {
+        __builtin_prefetch(rows[i + 1]);
+      }
+      out[i] = score_exam(rows[i], correct_answers, points);
+    }
+  }
+
+  // Score the exams and, in the same pass, compute the item analysis of
+  // every question (see ScoringReport)
+  ScoringReport score_with_report(const std::vector<ByteArray> &exams,
+                                  const ByteArray &correct_answers,
+                                  const ByteArray &points) {
+    for (const auto &exam : exams) {
+      check_exam(exam.size(), correct_answers);
+    }
+
+    return report_rows(
+        exams.size(),
+        [&](const size_t &i) -> const int8_t * { return exams[i].data(); },
+        correct_answers, points);
+  }
+
+  ScoringReport score_with_report(const ExamBatch &exams,
+                                  const ByteArray &correct_answers,
+                                  const ByteArray &points) {
+    if (!exams.empty()) {
+      check_exam(exams.question_count(), correct_answers);
+    }
+
+    return report_rows(
+        exams.exam_count(),
+        [&](const size_t &i) -> const int8_t * {
+          return exams.row(i).data();
+        },
+        correct_answers, points);
+  }
+
+  SIMD_TARGET_AVX512
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      out[i] = score_view_exam(exams.row(i).data(), correct_answers.data(),
+                               points.data(), correct_answers.size());
+    }
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx512()) {
       throw std::runtime_error(
           "SIMD AVX512 checker not supported because the CPU lacks "
           "AVX512{BW,VL,F,DQ} "
           "support.");
     }
+  }
 
-    if (exams.empty()) {
-      return {};
+ private:
+  template <typename Row>
+  ScoringReport report_rows(const size_t &count, const Row &row,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    ensure_cpu_support();
+    check_answers(correct_answers, points);
+
+    ScoringReportBuilder report(correct_answers);
+    std::vector<int32_t> scores(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      scores[i] = score_exam(row(i), correct_answers, points, report);
     }
 
-    const auto answers_size = correct_answers.size();
+    return report.finish(std::move(scores));
+  }
 
-    if (answers_size != points.size()) {
-      throw std::runtime_error(
-          "The size of correct answers and points must be the same.");
+  SIMD_TARGET_AVX512
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points) {
+    int32_t score = 0;
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+         ++j, _j = j << 6) {
+      // Load the exam and the correct answers
+      __m512i v1 = _mm512_loadu_si512(exam + _j);
+      const __m512i v2 = _mm512_loadu_si512(correct_answers.data() + _j);
+
+      // Compute the mask
+      const __mmask64 mask = _mm512_cmpeq_epi8_mask(v1, v2);
+
+      // Load the points
+      v1 = _mm512_loadu_si512(points.data() + _j);
+
+      // The masked points
+      v1 = _mm512_maskz_mov_epi8(mask, v1);
+
+      // Final sum calculation
+      v1 = _mm512_sad_epu8(v1, _mm512_setzero_si512());
+      uint64_t sum[8];
+      _mm512_storeu_si512(sum, v1);
+
+      for (const auto &k : sum) {
+        // In fact, the results are stored at the lower 16-bit of each 64-bit
+        // group, so we can safely cast here
+        score += static_cast<int32_t>(k);
+      }
     }
 
-    std::vector<int32_t> scored_exams_points(exams.size());
+    return score;
+  }
 
-    // Process each exam
-    for (size_t i = 0; i < exams.size(); ++i) {
-      auto &exam = exams[i];
+  // The same kernel on unpadded rows: the tail block is loaded with byte
+  // masks, which zero the bytes past the end without ever touching them
+  SIMD_TARGET_AVX512
+  static int32_t score_view_exam(const int8_t *exam, const int8_t *key,
+                                 const int8_t *points, const size_t &size) {
+    __m512i sums = _mm512_setzero_si512();
 
-      // Prefetch the next exam
-      if (i + 1 < exams.size()) {
-        __builtin_prefetch(&exams[i + 1]);
+    for (size_t j = 0; j < size; j += 64) {
+      const __mmask64 tail =
+          size - j >= 64 ? ~__mmask64{0} : (__mmask64{1} << (size - j)) - 1;
+      const __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+          tail, _mm512_maskz_loadu_epi8(tail, exam + j),
+          _mm512_maskz_loadu_epi8(tail, key + j));
+      sums = _mm512_add_epi64(
+          sums, _mm512_sad_epu8(_mm512_maskz_loadu_epi8(mask, points + j),
+                                _mm512_setzero_si512()));
+    }
+
+    return static_cast<int32_t>(_mm512_reduce_add_epi64(sums));
+  }
+
+  // The same kernel, which also counts the correct answers and the chosen
+  // options of every question
+  SIMD_TARGET_AVX512
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const ByteArray &points,
+                            ScoringReportBuilder &report) {
+    int32_t score = 0;
+    const __m512i one = _mm512_set1_epi8(1);
+    int8_t *correct = report.correct_counters();
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+         ++j, _j = j << 6) {
+      const __m512i answers = _mm512_loadu_si512(exam + _j);
+      const __mmask64 mask = _mm512_cmpeq_epi8_mask(
+          answers, _mm512_loadu_si512(correct_answers.data() + _j));
+
+      __m512i counters = _mm512_loadu_si512(correct + _j);
+      _mm512_storeu_si512(correct + _j,
+                          _mm512_mask_add_epi8(counters, mask, counters, one));
+      for (size_t o = 0; o < 4; ++o) {
+        int8_t *option = report.option_counters(o) + _j;
+        counters = _mm512_loadu_si512(option);
+        _mm512_storeu_si512(
+            option,
+            _mm512_mask_add_epi8(
+                counters,
+                _mm512_cmpeq_epi8_mask(
+                    answers, _mm512_set1_epi8(static_cast<char>('A' + o))),
+                counters, one));
       }
 
-      if (exam.size() != answers_size) {
-        throw std::runtime_error(
-            "The size of exams' questions and correct answers must be the "
-            "same.");
+      __m512i v1 = _mm512_maskz_mov_epi8(
+          mask, _mm512_loadu_si512(points.data() + _j));
+      v1 = _mm512_sad_epu8(v1, _mm512_setzero_si512());
+      uint64_t sum[8];
+      _mm512_storeu_si512(sum, v1);
+
+      for (const auto &k : sum) {
+        score += static_cast<int32_t>(k);
       }
+    }
 
-      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
-           ++j, _j = j << 6) {
-        // Load the exam and the correct answers
-        __m512i v1 = _mm512_loadu_si512(exam.data() + _j);
-        const __m512i v2 = _mm512_loadu_si512(correct_answers.data() + _j);
+    // The exam is still in L1, add its score to the questions it got right
+    const __m512i s = _mm512_set1_epi64(score);
+    int64_t *sums = report.correct_score_sums();
 
-        // Compute the mask
-        const __mmask64 mask = _mm512_cmpeq_epi8_mask(v1, v2);
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+         ++j, _j = j << 6) {
+      const __mmask64 mask =
+          _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(exam + _j),
+                                 _mm512_loadu_si512(correct_answers.data() + _j));
 
-        // Load the points
-        v1 = _mm512_loadu_si512(points.data() + _j);
+      for (size_t g = 0; g < 8; ++g) {
+        int64_t *sum = sums + _j + (g << 3);
+        const __m512i v = _mm512_loadu_si512(sum);
+        _mm512_storeu_si512(
+            sum, _mm512_mask_add_epi64(v, static_cast<__mmask8>(mask >> (g << 3)),
+                                       v, s));
+      }
+    }
 
-        // The masked points
-        v1 = _mm512_maskz_mov_epi8(mask, v1);
+    report.add_exam(score);
+    return score;
+  }
+};
+
+// An AVX-512 kernel for mid-size exams (64 to a few thousand questions),
+// which scores kExamsPerPass exams per pass over the key: every block of the
+// correct answers and the points is loaded once for all of them, the partial
+// sums of every exam stay in a register across the blocks and are reduced
+// once per exam, and the answers of the next exams are prefetched while the
+// current ones are scored. The tail block is loaded with byte masks, so it
+// scores unpadded rows (views) as well.
+class SimdAvx512BlockedScorer final : public BaseScorer {
+ public:
+  static constexpr size_t kExamsPerPass = 8;
 
-        // Final sum calculation
-        v1 = _mm512_sad_epu8(v1, _mm512_setzero_si512());
-        uint64_t sum[8];
-        _mm512_storeu_si512(sum, v1);
+  SIMD_TARGET_AVX512
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    const int8_t *rows[kExamsPerPass * 2];
+    size_t i = first;
 
-        for (const auto &k : sum) {
-          // In fact, the results are stored at the lower 16-bit of each 64-bit
-          // group, so we can safely cast here
-          scored_exams_points[i] += static_cast<int32_t>(k);
+    for (; i + kExamsPerPass <= last; i += kExamsPerPass) {
+      // The exams of this pass, then the ones to prefetch
+      const bool prefetch = i + kExamsPerPass * 2 <= last;
+      for (size_t r = 0; r < kExamsPerPass * (1 + prefetch); ++r) {
+        rows[r] = exams[i + r].data();
+      }
+      for (size_t r = 0; r < kExamsPerPass; ++r) {
+        check_exam(exams[i + r].size(), correct_answers);
+      }
+      score_pass<kExamsPerPass>(rows, prefetch, correct_answers.data(),
+                                points.data(), correct_answers.size(),
+                                out + (i - first));
+    }
+    for (; i < last; ++i) {
+      check_exam(exams[i].size(), correct_answers);
+      rows[0] = exams[i].data();
+      score_pass<1>(rows, false, correct_answers.data(), points.data(),
+                    correct_answers.size(), out + (i - first));
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    score_strided(rows, pitch, count, correct_answers.data(), points.data(),
+                  correct_answers.size(), out);
+  }
+
+  SIMD_TARGET_AVX512
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    size_t i = 0;
+    for (; i + kExamsPerPass <= count; i += kExamsPerPass) {
+      score_pass<kExamsPerPass>(rows + i, i + kExamsPerPass * 2 <= count,
+                                correct_answers.data(), points.data(),
+                                correct_answers.size(), out + i);
+    }
+    for (; i < count; ++i) {
+      score_pass<1>(rows + i, false, correct_answers.data(), points.data(),
+                    correct_answers.size(), out + i);
+    }
+  }
+
+  SIMD_TARGET_AVX512
+  void score_view(const ExamBatchView &exams,
+                  const ByteArrayView &correct_answers,
+                  const ByteArrayView &points, int32_t *out) override {
+    score_strided(exams.data(), exams.stride(), exams.exam_count(),
+                  correct_answers.data(), points.data(),
+                  correct_answers.size(), out);
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx512()) {
+      throw std::runtime_error(
+          "SIMD AVX512 blocked checker not supported because the CPU lacks "
+          "AVX512{BW,VL,F,DQ} support.");
+    }
+  }
+
+ private:
+  SIMD_TARGET_AVX512
+  static void score_strided(const int8_t *exams, const size_t &stride,
+                            const size_t &count, const int8_t *key,
+                            const int8_t *points, const size_t &size,
+                            int32_t *out) {
+    const int8_t *rows[kExamsPerPass * 2];
+    size_t i = 0;
+
+    for (; i + kExamsPerPass <= count; i += kExamsPerPass) {
+      const bool prefetch = i + kExamsPerPass * 2 <= count;
+      for (size_t r = 0; r < kExamsPerPass * (1 + prefetch); ++r) {
+        rows[r] = exams + (i + r) * stride;
+      }
+      score_pass<kExamsPerPass>(rows, prefetch, key, points, size, out + i);
+    }
+    for (; i < count; ++i) {
+      rows[0] = exams + i * stride;
+      score_pass<1>(rows, false, key, points, size, out + i);
+    }
+  }
+
+  // Score the `Exams` exams of rows[0, Exams), and with `prefetch`, prefetch
+  // the answers of rows[Exams, 2 * Exams) block by block
+  template <size_t Exams>
+  SIMD_TARGET_AVX512 static void score_pass(const int8_t *const *rows,
+                                            const bool &prefetch,
+                                            const int8_t *key,
+                                            const int8_t *points,
+                                            const size_t &size, int32_t *out) {
+    __m512i sums[Exams];
+    for (size_t r = 0; r < Exams; ++r) {
+      sums[r] = _mm512_setzero_si512();
+    }
+
+    size_t j = 0;
+    for (; j + 64 <= size; j += 64) {
+      const __m512i keys = _mm512_loadu_si512(key + j);
+      const __m512i weights = _mm512_loadu_si512(points + j);
+
+      for (size_t r = 0; r < Exams; ++r) {
+        if (prefetch) {
+          _mm_prefetch(reinterpret_cast<const char *>(rows[Exams + r] + j),
+                       _MM_HINT_T0);
         }
+        const __mmask64 mask =
+            _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(rows[r] + j), keys);
+        sums[r] = _mm512_add_epi64(
+            sums[r], _mm512_sad_epu8(_mm512_maskz_mov_epi8(mask, weights),
+                                     _mm512_setzero_si512()));
       }
     }
 
-    return scored_exams_points;
+    if (j < size) {
+      // The bytes past the end are neither read nor counted
+      const __mmask64 tail = (__mmask64{1} << (size - j)) - 1;
+      const __m512i keys = _mm512_maskz_loadu_epi8(tail, key + j);
+      const __m512i weights = _mm512_maskz_loadu_epi8(tail, points + j);
+
+      for (size_t r = 0; r < Exams; ++r) {
+        const __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+            tail, _mm512_maskz_loadu_epi8(tail, rows[r] + j), keys);
+        sums[r] = _mm512_add_epi64(
+            sums[r], _mm512_sad_epu8(_mm512_maskz_mov_epi8(mask, weights),
+                                     _mm512_setzero_si512()));
+      }
+    }
+
+    for (size_t r = 0; r < Exams; ++r) {
+      out[r] = static_cast<int32_t>(_mm512_reduce_add_epi64(sums[r]));
+    }
   }
 };
-#endif
+
+// Create the fastest scorer that the CPU supports. The CPU is only probed on
+// the first call.
+inline std::shared_ptr<BaseScorer> make_best_scorer() {
+  enum class Kernel { kScalar, kSse41, kAvx2, kAvx512 };
+
+  static const Kernel best = [] {
+    if (Cpu::supports_avx512()) return Kernel::kAvx512;
+    if (Cpu::supports_avx2()) return Kernel::kAvx2;
+    if (Cpu::supports_sse41()) return Kernel::kSse41;
+    return Kernel::kScalar;
+  }();
+
+  switch (best) {
+    case Kernel::kAvx512:
+      return std::make_shared<SimdAvx512BlockedScorer>();
+    case Kernel::kAvx2:
+      return std::make_shared<SimdScorer>();
+    case Kernel::kSse41:
+      return std::make_shared<SimdSse41Scorer>();
+    default:
+      return std::make_shared<BooleanMultiplicationScorer>();
+  }
+}
 }  // namespace Scorer
 #endif
@@ -0,0 +1,127 @@
+#ifndef SCORING_REPORT_HPP
+#define SCORING_REPORT_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "exam.h"
+
+// The scores of a batch, together with the per-question item analysis
+struct ScoringReport {
+  std::vector<int32_t> scores;
+  // How many candidates answered each question correctly
+  std::vector<uint64_t> correct_count;
+  // How many candidates chose 'A', 'B', 'C' and 'D' for each question (blanks
+  // and anything else make up the rest)
+  std::vector<std::array<uint64_t, 4>> option_count;
+  // The point-biserial correlation between answering each question correctly
+  // and the total score, NaN when everyone (or no one) got it right
+  std::vector<double> point_biserial;
+};
+
+// The accumulators that the SIMD scorers update while they score, one exam at
+// a time. Per question, the counters are bytes that the kernels bump with
+// vector subtractions of the compare masks (0xff is -1), and are flushed into
+// 64-bit totals every 255 exams, before they can overflow. The sum of the
+// scores of the candidates who got each question right (needed by the
+// point-biserial correlation) is added while the exam is still in L1.
+class ScoringReportBuilder {
+ private:
+  static constexpr size_t kFlushExams = 255;
+
+  size_t _question_count;
+  size_t _pending = 0;
+  size_t _exam_count = 0;
+  int64_t _score_sum = 0;
+  double _score_square_sum = 0;
+
+  // 0 for the correct answers, 1-4 for 'A'..'D'
+  std::array<ByteArray, 5> _counters;
+  std::array<std::vector<uint64_t>, 5> _totals;
+  std::vector<int64_t> _correct_score_sum;
+
+  void flush() {
+    for (size_t k = 0; k < _counters.size(); ++k) {
+      for (size_t j = 0; j < _question_count; ++j) {
+        _totals[k][j] += static_cast<uint8_t>(_counters[k][j]);
+      }
+      std::fill_n(_counters[k].data(), _counters[k].capacity(), 0);
+    }
+    _pending = 0;
+  }
+
+ public:
+  explicit ScoringReportBuilder(const ByteArray &correct_answers)
+      : _question_count(correct_answers.size()),
+        _correct_score_sum(correct_answers.capacity(), 0) {
+    for (size_t k = 0; k < _counters.size(); ++k) {
+      _counters[k] = ByteArray(correct_answers.size());
+      _totals[k].assign(_question_count, 0);
+    }
+  }
+
+  // Byte counters, readable and writable up to the key's capacity
+  [[nodiscard]] int8_t *correct_counters() const {
+    return _counters[0].data();
+  }
+  [[nodiscard]] int8_t *option_counters(const size_t &option) const {
+    return _counters[option + 1].data();
+  }
+  // Sums of the scores of the candidates who answered correctly, up to the
+  // key's capacity
+  [[nodiscard]] int64_t *correct_score_sums() {
+    return _correct_score_sum.data();
+  }
+
+  // Call once an exam's counters and sums are updated
+  void add_exam(const int32_t &score) {
+    _score_sum += score;
+    _score_square_sum += static_cast<double>(score) * score;
+    ++_exam_count;
+    if (++_pending == kFlushExams) {
+      flush();
+    }
+  }
+
+  ScoringReport finish(std::vector<int32_t> scores) {
+    flush();
+
+    ScoringReport report;
+    report.scores = std::move(scores);
+    report.correct_count = _totals[0];
+    report.option_count.resize(_question_count);
+    report.point_biserial.resize(_question_count);
+
+    const double n = static_cast<double>(_exam_count);
+    const double mean = static_cast<double>(_score_sum) / n;
+    const double deviation =
+        std::sqrt(std::max(0.0, _score_square_sum / n - mean * mean));
+
+    for (size_t j = 0; j < _question_count; ++j) {
+      for (size_t o = 0; o < 4; ++o) {
+        report.option_count[j][o] = _totals[o + 1][j];
+      }
+
+      const double correct = static_cast<double>(_totals[0][j]);
+      if (correct == 0 || correct == n || deviation == 0) {
+        report.point_biserial[j] = std::numeric_limits<double>::quiet_NaN();
+        continue;
+      }
+
+      const double p = correct / n;
+      const double mean_correct =
+          static_cast<double>(_correct_score_sum[j]) / correct;
+      const double mean_wrong =
+          (static_cast<double>(_score_sum - _correct_score_sum[j])) /
+          (n - correct);
+      report.point_biserial[j] =
+          (mean_correct - mean_wrong) / deviation * std::sqrt(p * (1 - p));
+    }
+
+    return report;
+  }
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef SCORING_SESSION_HPP
+#define SCORING_SESSION_HPP
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "scorers.hpp"
+
+namespace Scorer {
+// A buffer that travels through a ScoringSession: the caller fills the first
+// `exam_count` rows of `exams`, the session writes their `scores`. The buffers
+// are allocated once, with the session, and recycled.
+struct ScoringChunk {
+  ExamBatch exams;
+  size_t exam_count = 0;
+  std::vector<int32_t> scores;
+  // The position of the chunk in the submission order
+  uint64_t sequence = 0;
+
+ private:
+  friend class ScoringSession;
+
+  std::exception_ptr _error;
+  // Set for the chunks submitted with score_async
+  std::unique_ptr<std::promise<std::vector<int32_t>>> _promise;
+};
+
+// A three-stage pipeline, so that reading the exams, scoring them and writing
+// the scores overlap instead of taking turns:
+//
+//   caller (reads)  --acquire/submit-->  scoring thread (any kernel)
+//                   --completed-->       completion thread (callback/future)
+//                   --free-->            back to the caller
+//
+// The stages hand chunk pointers to each other through lock-free bounded
+// queues, and the chunks go back to the free queue once their scores were
+// delivered, so nothing is allocated in steady state (except for the futures
+// of score_async). The chunks are scored and delivered in submission order.
+// The scoring stage is a single thread, a ParallelScorer kernel spreads each
+// chunk over the cores.
+//
+// acquire() and submit() are meant to be called from one producer thread.
+class ScoringSession {
+ public:
+  // Called on the completion thread with every scored chunk, in order
+  using Callback = std::function<void(const ScoringChunk &)>;
+
+ private:
+  std::shared_ptr<BaseScorer> _kernel;
+  ByteArray _correct_answers;
+  ByteArray _points;
+  Callback _on_scored;
+
+  std::vector<std::unique_ptr<ScoringChunk>> _chunks;
+  // A null chunk is the end of the stream
+  BoundedQueue<ScoringChunk *> _free;
+  BoundedQueue<ScoringChunk *> _scoring;
+  BoundedQueue<ScoringChunk *> _completed;
+  uint64_t _sequence = 0;
+
+  std::mutex _error_mutex;
+  std::exception_ptr _error;
+
+  std::thread _scoring_thread;
+  std::thread _completion_thread;
+  bool _closed = false;
+
+  void record_error(const std::exception_ptr &error) {
+    std::lock_guard lock(_error_mutex);
+    if (!_error) {
+      _error = error;
+    }
+  }
+
+  void score_chunks() {
+    while (ScoringChunk *chunk = _scoring.pop()) {
+      try {
+        _kernel->score_rows(chunk->exams.data(), chunk->exams.pitch(),
+                            chunk->exam_count, _correct_answers, _points,
+                            chunk->scores.data());
+      } catch (...) {
+        chunk->_error = std::current_exception();
+      }
+      _completed.push(chunk);
+    }
+    _completed.push(nullptr);
+  }
+
+  void complete_chunks() {
+    while (ScoringChunk *chunk = _completed.pop()) {
+      if (chunk->_promise) {
+        if (chunk->_error) {
+          chunk->_promise->set_exception(chunk->_error);
+        } else {
+          chunk->_promise->set_value(std::vector<int32_t>(
+              chunk->scores.begin(),
+              chunk->scores.begin() + chunk->exam_count));
+        }
+        chunk->_promise.reset();
+      } else if (chunk->_error) {
+        record_error(chunk->_error);
+      } else if (_on_scored) {
+        try {
+          _on_scored(*chunk);
+        } catch (...) {
+          record_error(std::current_exception());
+        }
+      }
+
+      chunk->_error = nullptr;
+      chunk->exam_count = 0;
+      _free.push(chunk);
+    }
+  }
+
+  // Give a chunk that can't be scored back to the free queue, else every
+  // such error would leave one chunk less for acquire() until it deadlocks
+  [[noreturn]] void reject(ScoringChunk &chunk, const char *message) {
+    chunk._promise.reset();
+    chunk.exam_count = 0;
+    _free.push(&chunk);
+    throw std::runtime_error(message);
+  }
+
+  void enqueue(ScoringChunk &chunk) {
+    // The scoring stage is gone, a chunk pushed now would never be scored
+    if (_closed) {
+      reject(chunk, "The scoring session is closed.");
+    }
+    if (chunk.exam_count > chunk.exams.exam_count()) {
+      reject(chunk, "A chunk can't hold more exams than its batch.");
+    }
+    chunk.sequence = _sequence++;
+    _scoring.push(&chunk);
+  }
+
+ public:
+  // Score `chunk_exams` exams at a time against `correct_answers` and
+  // `points`, with `depth` chunks in flight (at least 3, one per stage)
+  ScoringSession(std::shared_ptr<BaseScorer> kernel, ByteArray correct_answers,
+                 ByteArray points, Callback on_scored = nullptr,
+                 const size_t &chunk_exams = 1 << 16, size_t depth = 4)
+      : _kernel(std::move(kernel)),
+        _correct_answers(std::move(correct_answers)),
+        _points(std::move(points)),
+        _on_scored(std::move(on_scored)),
+        _free(std::max<size_t>(depth, 3)),
+        _scoring(std::max<size_t>(depth, 3) + 1),
+        _completed(std::max<size_t>(depth, 3) + 1) {
+    _kernel->ensure_cpu_support();
+    if (_correct_answers.size() != _points.size()) {
+      throw std::runtime_error(
+          "The size of correct answers and points must be the same.");
+    }
+    if (chunk_exams == 0) {
+      throw std::runtime_error("A chunk must hold at least one exam.");
+    }
+
+    depth = std::max<size_t>(depth, 3);
+    for (size_t i = 0; i < depth; ++i) {
+      auto chunk = std::make_unique<ScoringChunk>();
+      chunk->exams = ExamBatch(chunk_exams, _correct_answers.size());
+      chunk->scores.resize(chunk_exams);
+      _free.push(chunk.get());
+      _chunks.push_back(std::move(chunk));
+    }
+
+    _scoring_thread = std::thread(&ScoringSession::score_chunks, this);
+    _completion_thread = std::thread(&ScoringSession::complete_chunks, this);
+  }
+
+  ScoringSession(const ScoringSession &) = delete;
+  ScoringSession &operator=(const ScoringSession &) = delete;
+
+  [[nodiscard]] size_t chunk_exams() const {
+    return _chunks.front()->exams.exam_count();
+  }
+
+  // A free chunk to fill, waiting for one to be recycled if they're all in
+  // flight
+  ScoringChunk &acquire() {
+    if (_closed) {
+      throw std::runtime_error("The scoring session is closed.");
+    }
+    return *_free.pop();
+  }
+
+  // Score a filled chunk, its scores go to the callback
+  void submit(ScoringChunk &chunk) { enqueue(chunk); }
+
+  // Score a filled chunk, its scores come back through the future instead of
+  // the callback
+  std::future<std::vector<int32_t>> score_async(ScoringChunk &chunk) {
+    chunk._promise = std::make_unique<std::promise<std::vector<int32_t>>>();
+    auto future = chunk._promise->get_future();
+    enqueue(chunk);
+    return future;
+  }
+
+  // Wait for every submitted chunk to be delivered and stop the stages. The
+  // first error of the kernel or of the callback (for the chunks without a
+  // future) is rethrown here.
+  void close() {
+    if (_closed) {
+      return;
+    }
+    _closed = true;
+
+    _scoring.push(nullptr);
+    _scoring_thread.join();
+    _completion_thread.join();
+
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+  ~ScoringSession() {
+    try {
+      close();
+    } catch (...) {
+      // Destructors can't throw, call close() to see the error
+    }
+  }
+};
+}  // namespace Scorer
+
+#endif
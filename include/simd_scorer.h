@@ -0,0 +1,71 @@
+#ifndef SIMD_SCORER_H_INCLUDED
+#define SIMD_SCORER_H_INCLUDED
+
+/*
+ * The C ABI of the simd_scorer shared library, for callers that aren't C++
+ * (e.g. the Python bindings in python/). Only plain C types cross it: the
+ * exams, the key and the points are borrowed byte buffers, scored in place,
+ * and the scores are written to a buffer of the caller.
+ *
+ * Every function that can fail returns a status, and the message of the last
+ * error of the calling thread is kept for simd_scorer_last_error().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIMD_SCORER_API __attribute__((visibility("default")))
+
+/* Bumped on every incompatible change of this header */
+#define SIMD_SCORER_ABI_VERSION 1
+
+typedef int32_t simd_scorer_status;
+#define SIMD_SCORER_OK 0
+#define SIMD_SCORER_INVALID_ARGUMENT 1
+#define SIMD_SCORER_UNSUPPORTED_CPU 2
+#define SIMD_SCORER_INTERNAL_ERROR 3
+
+typedef struct simd_scorer simd_scorer;
+
+/* The SIMD_SCORER_ABI_VERSION that the library was built with */
+SIMD_SCORER_API int32_t simd_scorer_abi_version(void);
+
+/*
+ * Create a scorer with the kernel named `kernel`: "best" (the fastest one for
+ * the CPU), "parallel" (the best one on every hardware thread), "naive",
+ * "sse41", "avx2" or "avx512". A null name is "best".
+ */
+SIMD_SCORER_API simd_scorer_status simd_scorer_create(const char *kernel,
+                                                      simd_scorer **scorer);
+
+SIMD_SCORER_API void simd_scorer_destroy(simd_scorer *scorer);
+
+/*
+ * Score `exam_count` exams of `question_count` answers each, stored
+ * `exam_stride` bytes apart from `exams` on, against `correct_answers` and
+ * `points` (`question_count` bytes each), and write the scores to
+ * scores[0, exam_count). Nothing is copied and no padding is needed. A scorer
+ * can be used by several threads at once.
+ *
+ * Every point must be in 0..127, the range in which every kernel reads the
+ * same value (the scalar ones sign-extend a byte, the SIMD ones don't): a
+ * larger one fails with SIMD_SCORER_INVALID_ARGUMENT, so the scores never
+ * depend on the kernel.
+ */
+SIMD_SCORER_API simd_scorer_status simd_scorer_score(
+    simd_scorer *scorer, const uint8_t *exams, size_t exam_count,
+    size_t question_count, size_t exam_stride, const uint8_t *correct_answers,
+    const uint8_t *points, int32_t *scores);
+
+/* The message of the last error of the calling thread, or "" */
+SIMD_SCORER_API const char *simd_scorer_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
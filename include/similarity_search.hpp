@@ -0,0 +1,455 @@
+#ifndef SIMILARITY_SEARCH_HPP
+#define SIMILARITY_SEARCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+#include "thread_pool.hpp"
+#include "weighted_scorer.hpp"
+
+namespace Scorer {
+// Two candidates whose answer sheets were compared, by their index in the
+// batch (first < second)
+struct SimilarPair {
+  uint32_t first = 0;
+  uint32_t second = 0;
+  // The questions that both answered the same way, blanks excluded
+  uint32_t matching_answers = 0;
+  // The questions that both answered with the same wrong answer. It's the
+  // stronger sign of copying, candidates who know the answer agree anyway.
+  uint32_t matching_wrong_answers = 0;
+
+  // By matching wrong answers, then matching answers, then by index, so that
+  // the order is total and the results don't depend on the threads
+  [[nodiscard]] bool more_similar_than(const SimilarPair &other) const {
+    return std::make_tuple(other.matching_wrong_answers,
+                           other.matching_answers, first, second) <
+           std::make_tuple(matching_wrong_answers, matching_answers,
+                           other.first, other.second);
+  }
+
+  bool operator==(const SimilarPair &) const = default;
+};
+
+struct SimilarityOptions {
+  // The fewest matching wrong answers for a pair to be kept
+  uint32_t min_matching_wrong_answers = 1;
+  // The most similar pairs kept per exam
+  size_t max_pairs_per_exam = 10;
+};
+
+// The most similar pairs of every exam of a search. Every pair is listed
+// under both of its exams, and may only be kept by one of them when the other
+// has more similar pairs.
+class SimilarPairs {
+ private:
+  size_t _max_per_exam;
+  // _max_per_exam slots per exam, the first _counts[exam] of them used
+  std::vector<SimilarPair> _pairs;
+  std::vector<uint32_t> _counts;
+
+  friend class SimilaritySearch;
+
+  // Keep `pair` among the pairs of `exam` if it's one of the most similar.
+  // Returns whether it was kept.
+  bool insert(const size_t &exam, const SimilarPair &pair) {
+    SimilarPair *slots = _pairs.data() + exam * _max_per_exam;
+    uint32_t &count = _counts[exam];
+    size_t slot = count;
+    if (count < _max_per_exam) {
+      ++count;
+    } else if (pair.more_similar_than(slots[count - 1])) {
+      slot = count - 1;
+    } else {
+      return false;
+    }
+
+    for (; slot > 0 && pair.more_similar_than(slots[slot - 1]); --slot) {
+      slots[slot] = slots[slot - 1];
+    }
+    slots[slot] = pair;
+    return true;
+  }
+
+ public:
+  SimilarPairs(const size_t &exam_count, const size_t &max_per_exam)
+      : _max_per_exam(max_per_exam),
+        _pairs(exam_count * max_per_exam),
+        _counts(exam_count) {}
+
+  [[nodiscard]] size_t exam_count() const { return _counts.size(); }
+  [[nodiscard]] size_t max_per_exam() const { return _max_per_exam; }
+
+  // The pairs of `exam`, the most similar first
+  [[nodiscard]] std::span<const SimilarPair> of(const size_t &exam) const {
+    return {_pairs.data() + exam * _max_per_exam, _counts[exam]};
+  }
+
+  // Every pair kept by any exam once, the most similar first
+  [[nodiscard]] std::vector<SimilarPair> unique() const {
+    std::vector<SimilarPair> pairs;
+    for (size_t exam = 0; exam < exam_count(); ++exam) {
+      for (const auto &pair : of(exam)) {
+        pairs.push_back(pair);
+      }
+    }
+
+    std::sort(pairs.begin(), pairs.end(),
+              [](const SimilarPair &a, const SimilarPair &b) {
+                return a.more_similar_than(b);
+              });
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+  }
+};
+
+// Finds the pairs of candidates whose answer sheets are suspiciously similar,
+// i.e. share many wrong answers, among all the pairs of a batch or only the
+// pairs within the same group (e.g. exam room or variant).
+//
+// Every exam is first reduced to two bitmasks per block of 64 questions: the
+// questions it answered, and the ones it got wrong. A pair then costs one
+// AVX-512 byte compare per block, like SimdAvx512Scorer's, masked by the
+// first exam's wrong answers (an answer equal to a wrong one is wrong too),
+// and a popcount. The matching answers are only counted for the pairs over
+// the threshold. The upper triangle of the pairs is split into tiles: every
+// task compares a tile of rows with the column tiles at and after it, 4 rows
+// (held in registers up to 256 questions) against each column at a time, so
+// every column is loaded once for 4 rows while the tile stays in cache.
+//
+// The pairs over the threshold are offered to both of their exams' lists of
+// most similar pairs. The lists are guarded by striped locks, and a pair that
+// can't beat the least similar pair of a full list is dropped without taking
+// the lock.
+class SimilaritySearch {
+ private:
+  // Rows per tile. A column tile of 128 exams of up to 128 questions fits in
+  // L1, longer exams in L2.
+  static constexpr size_t kTileRows = 128;
+  static constexpr size_t kLockStripes = 1024;
+
+  SimilarityOptions _options;
+  ThreadPool _pool;
+
+  // The exams in group order, and their bitmasks
+  struct Rows {
+    std::vector<const int8_t *> rows;
+    std::vector<uint32_t> exams;
+    size_t blocks = 0;
+    // blocks bitmasks per row
+    std::vector<uint64_t> answered;
+    std::vector<uint64_t> wrong;
+    uint32_t threshold = 0;
+  };
+
+  // Rows [row_first, row_last) against [row_first, group_last)
+  struct Tile {
+    size_t row_first;
+    size_t row_last;
+    size_t group_last;
+  };
+
+  static void check_sizes(const size_t &exam_count,
+                          const std::vector<uint32_t> &groups) {
+    if (!groups.empty() && groups.size() != exam_count) {
+      throw std::runtime_error(
+          "The number of groups and exams must be the same.");
+    }
+    if (exam_count > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Too many exams for a similarity search.");
+    }
+  }
+
+  // The bitmasks of the row at `position`
+  static void mark_answers(Rows &rows, const size_t &position,
+                           const ByteArray &correct_answers) {
+    const int8_t *row = rows.rows[position];
+    for (size_t b = 0; b < rows.blocks; ++b) {
+      uint64_t answered = 0, wrong = 0;
+      for (size_t k = 0; k < 64; ++k) {
+        const size_t j = b * 64 + k;
+        if (j < correct_answers.size() && row[j] != kBlankAnswer &&
+            row[j] != 0) {
+          answered |= uint64_t{1} << k;
+          wrong |= uint64_t{row[j] != correct_answers[j]} << k;
+        }
+      }
+      rows.answered[position * rows.blocks + b] = answered;
+      rows.wrong[position * rows.blocks + b] = wrong;
+    }
+  }
+
+  // The matching answers of the rows at `a` and `b`, for the few pairs over
+  // the threshold (the kernels only count the matching wrong answers)
+  static uint32_t matching_answers(const Rows &rows, const size_t &a,
+                                   const size_t &b) {
+    uint32_t matching = 0;
+    for (size_t j = 0; j < rows.blocks * 64; ++j) {
+      const size_t block = a * rows.blocks + j / 64;
+      matching += rows.rows[a][j] == rows.rows[b][j] &&
+                  (rows.answered[block] >> (j % 64) & 1);
+    }
+    return matching;
+  }
+
+  // Compare the rows [row, row + Count) with the columns [first, last) after
+  // them, and offer the pairs over the threshold. With a nonzero `Blocks`
+  // (the number of blocks of 64 questions), the rows are kept in registers
+  // for all the columns.
+  template <size_t Count, size_t Blocks, typename Offer>
+  SIMD_TARGET_AVX512_POPCNT static void compare_rows_avx512(
+      const Rows &rows, const size_t &row, const size_t &first,
+      const size_t &last, const Offer &offer) {
+    const size_t blocks = Blocks == 0 ? rows.blocks : Blocks;
+    const uint64_t *wrong = rows.wrong.data() + row * blocks;
+    const int8_t *row_answers[Count];
+    __m512i row_blocks[Count][Blocks == 0 ? 1 : Blocks];
+    for (size_t r = 0; r < Count; ++r) {
+      row_answers[r] = rows.rows[row + r];
+      for (size_t b = 0; b < Blocks; ++b) {
+        row_blocks[r][b] = _mm512_loadu_si512(row_answers[r] + b * 64);
+      }
+    }
+
+    for (size_t column = std::max(first, row + 1); column < last; ++column) {
+      const int8_t *column_answers = rows.rows[column];
+      uint64_t matching_wrong[Count] = {};
+      for (size_t b = 0; b < blocks; ++b) {
+        const __m512i answers = _mm512_loadu_si512(column_answers + b * 64);
+        for (size_t r = 0; r < Count; ++r) {
+          // Masked in a general register, a masked compare would load the
+          // mask into a mask register on the same port as the compare
+          const __mmask64 same = _mm512_cmpeq_epi8_mask(
+              Blocks == 0 ? _mm512_loadu_si512(row_answers[r] + b * 64)
+                          : row_blocks[r][b],
+              answers);
+          matching_wrong[r] += _mm_popcnt_u64(same & wrong[r * blocks + b]);
+        }
+      }
+
+      // Almost no pair passes, so the rows are only checked one by one when
+      // one of them does
+      uint64_t most = 0;
+      for (size_t r = 0; r < Count; ++r) {
+        most = std::max(most, matching_wrong[r]);
+      }
+      if (most >= rows.threshold) {
+        for (size_t r = 0; r < Count; ++r) {
+          if (matching_wrong[r] >= rows.threshold && column > row + r) {
+            offer(row + r, column, matching_wrong[r]);
+          }
+        }
+      }
+    }
+  }
+
+  template <typename Offer>
+  static void compare_rows_scalar(const Rows &rows, const size_t &row,
+                                  const size_t &first, const size_t &last,
+                                  const Offer &offer) {
+    const uint64_t *wrong = rows.wrong.data() + row * rows.blocks;
+
+    for (size_t column = std::max(first, row + 1); column < last; ++column) {
+      uint32_t matching_wrong = 0;
+      for (size_t b = 0; b < rows.blocks; ++b) {
+        const int8_t *a = rows.rows[row] + b * 64;
+        const int8_t *c = rows.rows[column] + b * 64;
+        uint64_t same = 0;
+        for (size_t k = 0; k < 64; ++k) {
+          same |= uint64_t{a[k] == c[k]} << k;
+        }
+        matching_wrong += __builtin_popcountll(same & wrong[b]);
+      }
+
+      if (matching_wrong >= rows.threshold) {
+        offer(row, column, matching_wrong);
+      }
+    }
+  }
+
+  // Every column tile of `tile`, 4 rows at a time
+  template <size_t Blocks, typename Offer>
+  static void compare_tile_avx512(const Rows &rows, const Tile &tile,
+                                  const Offer &offer) {
+    for (size_t first = tile.row_first; first < tile.group_last;
+         first += kTileRows) {
+      const size_t last = std::min(first + kTileRows, tile.group_last);
+      size_t row = tile.row_first;
+      for (; row + 4 <= tile.row_last; row += 4) {
+        compare_rows_avx512<4, Blocks>(rows, row, first, last, offer);
+      }
+      for (; row < tile.row_last; ++row) {
+        compare_rows_avx512<1, Blocks>(rows, row, first, last, offer);
+      }
+    }
+  }
+
+  template <typename Offer>
+  static void compare_tile(const Rows &rows, const Tile &tile,
+                           const Offer &offer) {
+    if (Cpu::supports_avx512()) {
+      // Up to 256 questions, the rows fit in registers
+      switch (rows.blocks) {
+        case 1:
+          return compare_tile_avx512<1>(rows, tile, offer);
+        case 2:
+          return compare_tile_avx512<2>(rows, tile, offer);
+        case 3:
+          return compare_tile_avx512<3>(rows, tile, offer);
+        case 4:
+          return compare_tile_avx512<4>(rows, tile, offer);
+        default:
+          return compare_tile_avx512<0>(rows, tile, offer);
+      }
+    }
+
+    for (size_t first = tile.row_first; first < tile.group_last;
+         first += kTileRows) {
+      const size_t last = std::min(first + kTileRows, tile.group_last);
+      for (size_t row = tile.row_first; row < tile.row_last; ++row) {
+        compare_rows_scalar(rows, row, first, last, offer);
+      }
+    }
+  }
+
+  template <typename Row>
+  SimilarPairs search(const size_t &exam_count, const Row &row,
+                      const ByteArray &correct_answers,
+                      const std::vector<uint32_t> &groups) {
+    check_sizes(exam_count, groups);
+
+    // The exams sorted by group, each group a range of positions
+    Rows rows;
+    rows.exams.resize(exam_count);
+    std::iota(rows.exams.begin(), rows.exams.end(), 0);
+    // Exams listed room by room are already in order
+    if (!groups.empty() && !std::is_sorted(groups.begin(), groups.end())) {
+      std::stable_sort(rows.exams.begin(), rows.exams.end(),
+                       [&](const uint32_t &a, const uint32_t &b) {
+                         return groups[a] < groups[b];
+                       });
+    }
+    rows.rows.resize(exam_count);
+    for (size_t p = 0; p < exam_count; ++p) {
+      rows.rows[p] = row(rows.exams[p]);
+    }
+    rows.blocks = (correct_answers.size() + 63) / 64;
+    rows.answered.resize(exam_count * rows.blocks);
+    rows.wrong.resize(exam_count * rows.blocks);
+    rows.threshold = _options.min_matching_wrong_answers;
+
+    std::vector<Tile> tiles;
+    for (size_t first = 0; first < exam_count;) {
+      size_t last = first + 1;
+      while (last < exam_count && !groups.empty() &&
+             groups[rows.exams[last]] == groups[rows.exams[first]]) {
+        ++last;
+      }
+      if (groups.empty()) {
+        last = exam_count;
+      }
+      for (size_t row_first = first; row_first < last;
+           row_first += kTileRows) {
+        tiles.push_back({row_first, std::min(row_first + kTileRows, last),
+                         last});
+      }
+      first = last;
+    }
+
+    _pool.run(tiles.size(), [&](const size_t &t) {
+      for (size_t p = tiles[t].row_first; p < tiles[t].row_last; ++p) {
+        mark_answers(rows, p, correct_answers);
+      }
+    });
+
+    SimilarPairs pairs(exam_count, _options.max_pairs_per_exam);
+    std::vector<std::mutex> locks(kLockStripes);
+    // The (matching wrong, matching) answers of the least similar pair of
+    // every full list, 0 until it's full
+    std::vector<std::atomic<uint64_t>> bars(exam_count);
+
+    const auto keep = [&](const uint32_t &exam, const SimilarPair &pair) {
+      const uint64_t key =
+          uint64_t{pair.matching_wrong_answers} << 32 | pair.matching_answers;
+      if (key < bars[exam].load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      std::lock_guard lock(locks[exam % kLockStripes]);
+      if (pairs.insert(exam, pair) &&
+          pairs._counts[exam] == pairs._max_per_exam) {
+        const SimilarPair &least = pairs.of(exam).back();
+        bars[exam].store(uint64_t{least.matching_wrong_answers} << 32 |
+                             least.matching_answers,
+                         std::memory_order_relaxed);
+      }
+    };
+    const auto offer = [&](const size_t &a, const size_t &b,
+                           const uint32_t &matching_wrong) {
+      const uint32_t first = rows.exams[a], second = rows.exams[b];
+      const SimilarPair pair{std::min(first, second), std::max(first, second),
+                             matching_answers(rows, a, b), matching_wrong};
+      keep(first, pair);
+      keep(second, pair);
+    };
+
+    _pool.run(tiles.size(), [&](const size_t &t) {
+      compare_tile(rows, tiles[t], offer);
+    });
+    return pairs;
+  }
+
+ public:
+  // `thread_count` of 0 uses every hardware thread
+  explicit SimilaritySearch(const SimilarityOptions &options = {},
+                            const size_t &thread_count = 0)
+      : _options(options), _pool(thread_count) {
+    if (_options.max_pairs_per_exam == 0) {
+      throw std::runtime_error("At least one pair per exam must be kept.");
+    }
+  }
+
+  [[nodiscard]] size_t thread_count() const { return _pool.thread_count(); }
+
+  // Compare every pair of exams, or with `groups` (one per exam) only the
+  // pairs of the same group
+  SimilarPairs search(const ExamBatch &exams, const ByteArray &correct_answers,
+                      const std::vector<uint32_t> &groups = {}) {
+    if (!exams.empty() && exams.question_count() != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+    return search(
+        exams.exam_count(),
+        [&](const size_t &i) { return exams.data() + i * exams.pitch(); },
+        correct_answers, groups);
+  }
+
+  SimilarPairs search(const std::vector<ByteArray> &exams,
+                      const ByteArray &correct_answers,
+                      const std::vector<uint32_t> &groups = {}) {
+    for (const auto &exam : exams) {
+      if (exam.size() != correct_answers.size()) {
+        throw std::runtime_error(
+            "The size of exams' questions and correct answers must be the "
+            "same.");
+      }
+    }
+    return search(
+        exams.size(), [&](const size_t &i) { return exams[i].data(); },
+        correct_answers, groups);
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef STREAMING_SCORER_HPP
+#define STREAMING_SCORER_HPP
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "exam_file.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// Scores a memory-mapped ExamFile in chunks with any other scorer (the
+// kernel), reading the rows in place. While a chunk is being scored, the next
+// one is read ahead (MADV_WILLNEED), and the pages of the chunks that are
+// done are released (MADV_DONTNEED), so only about two chunks of the file are
+// resident at any time, however large the file is.
+class StreamingScorer {
+ private:
+  std::shared_ptr<BaseScorer> _kernel;
+  size_t _chunk_bytes;
+
+ public:
+  explicit StreamingScorer(std::shared_ptr<BaseScorer> kernel,
+                           const size_t &chunk_bytes = 64 << 20)
+      : _kernel(std::move(kernel)), _chunk_bytes(chunk_bytes) {}
+
+  std::vector<int32_t> score(const ExamFile &exams,
+                             const ByteArray &correct_answers,
+                             const ByteArray &points) {
+    _kernel->ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    if (correct_answers.size() != points.size()) {
+      throw std::runtime_error(
+          "The size of correct answers and points must be the same.");
+    }
+    if (exams.question_count() != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    const size_t chunk =
+        std::max<size_t>(1, _chunk_bytes / std::max<size_t>(exams.pitch(), 1));
+
+    exams.advise(0, exams.exam_count(), MADV_SEQUENTIAL);
+    exams.advise(0, std::min(chunk, exams.exam_count()), MADV_WILLNEED);
+
+    for (size_t first = 0; first < exams.exam_count(); first += chunk) {
+      const size_t last = std::min(first + chunk, exams.exam_count());
+
+      // Read ahead the next chunk while this one is being scored
+      if (last < exams.exam_count()) {
+        exams.advise(last, std::min(last + chunk, exams.exam_count()),
+                     MADV_WILLNEED);
+      }
+
+      _kernel->score_rows(exams.row(first), exams.pitch(), last - first,
+                          correct_answers, points,
+                          scored_exams_points.data() + first);
+
+      // The file backs these pages, so dropping them is always safe. Only
+      // this chunk's, the earlier ones are already gone.
+      exams.advise(first, last, MADV_DONTNEED);
+    }
+
+    return scored_exams_points;
+  }
+};
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A persistent pool of worker threads. Every call to `run` splits its tasks
+// evenly across the workers' queues, then each worker pops tasks from the back
+// of its own queue and, once it runs dry, steals from the front of the other
+// workers' queues, so an unlucky worker doesn't hold up the whole batch.
+//
+// Pinned workers each stay on one CPU (see pin_to_cpu), so the memory they
+// first touched stays local to them.
+class ThreadPool {
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  std::vector<std::thread> _threads;
+  std::vector<std::unique_ptr<TaskQueue>> _queues;
+
+  // Serializes concurrent calls to `run`
+  std::mutex _run_mutex;
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _done;
+  const std::function<void(size_t)> *_task = nullptr;
+  std::atomic<size_t> _pending = 0;
+  std::exception_ptr _error;
+  size_t _generation = 0;
+  bool _stop = false;
+
+  bool pop(const size_t &worker, size_t &index) {
+    auto &queue = *_queues[worker];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    index = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool steal(const size_t &worker, size_t &index) {
+    for (size_t k = 1; k < _queues.size(); ++k) {
+      auto &queue = *_queues[(worker + k) % _queues.size()];
+      std::lock_guard lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        index = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(const size_t &worker, const bool &pin) {
+    if (pin) {
+      pin_to_cpu(worker);
+    }
+    size_t generation = 0;
+
+    while (true) {
+      {
+        std::unique_lock lock(_mutex);
+        _wake.wait(lock, [&] { return _stop || _generation != generation; });
+        if (_stop) {
+          return;
+        }
+        generation = _generation;
+      }
+
+      size_t index;
+      while (pop(worker, index) || steal(worker, index)) {
+        try {
+          (*_task)(index);
+        } catch (...) {
+          std::lock_guard lock(_mutex);
+          if (!_error) {
+            _error = std::current_exception();
+          }
+        }
+
+        if (_pending.fetch_sub(1) == 1) {
+          std::lock_guard lock(_mutex);
+          _done.notify_all();
+        }
+      }
+    }
+  }
+
+ public:
+  // Pin the calling thread to the `index`-th CPU (wrapping around) that it's
+  // allowed to run on, so that threads given the same index, e.g. worker k of
+  // a pool and the thread that first touched slice k of a buffer, share a CPU.
+  // Returns false if the system doesn't support it.
+  static bool pin_to_cpu(const size_t &index) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      return false;
+    }
+    const auto count = static_cast<size_t>(CPU_COUNT(&allowed));
+    if (count == 0) {
+      return false;
+    }
+
+    size_t skip = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed) && skip-- == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+      }
+    }
+#endif
+    return false;
+  }
+
+  // Start `thread_count` workers (0 means one per hardware thread), worker k
+  // pinned with pin_to_cpu(k) when `pin_threads`
+  explicit ThreadPool(size_t thread_count = 0,
+                      const bool &pin_threads = false) {
+    if (thread_count == 0) {
+      thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < thread_count; ++i) {
+      _queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+      _threads.emplace_back(&ThreadPool::work, this, i, pin_threads);
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  [[nodiscard]] size_t thread_count() const { return _threads.size(); }
+
+  // Call `task(i)` for every i in [0, task_count) and block until all of them
+  // are finished. The first exception thrown by a task is rethrown here.
+  void run(const size_t &task_count, const std::function<void(size_t)> &task) {
+    if (task_count == 0) {
+      return;
+    }
+
+    std::lock_guard run_lock(_run_mutex);
+
+    // Publish the task before filling the queues, since a worker still
+    // stealing from the previous batch may pick the new tasks up right away
+    {
+      std::lock_guard lock(_mutex);
+      _task = &task;
+      _pending = task_count;
+      _error = nullptr;
+    }
+
+    const size_t workers = _queues.size();
+    for (size_t w = 0; w < workers; ++w) {
+      auto &queue = *_queues[w];
+      std::lock_guard lock(queue.mutex);
+      for (size_t i = task_count * w / workers;
+           i < task_count * (w + 1) / workers; ++i) {
+        queue.tasks.push_back(i);
+      }
+    }
+
+    std::unique_lock lock(_mutex);
+    ++_generation;
+    _wake.notify_all();
+    _done.wait(lock, [&] { return _pending == 0; });
+    _task = nullptr;
+
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &thread : _threads) {
+      thread.join();
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef TRANSPOSED_SCORER_HPP
+#define TRANSPOSED_SCORER_HPP
+
+#include <algorithm>
+#include <memory>
+
+#include "cpu.hpp"
+#include "exam.h"
+#include "scorers.hpp"
+
+namespace Scorer {
+// Scores short exams in the question-major layout of TransposedExamBatch.
+// For every question, the correct answer and its points are broadcast once and
+// compared against 64 exams at a time, so no lanes are wasted when an exam has
+// far fewer questions than a vector has bytes.
+//
+// Row-major batches with at most `max_transposed_questions` questions are
+// transposed on the fly, 64 exams at a time into a buffer that stays in L1.
+// Longer exams are handed to the best row-major kernel instead.
+class TransposedSimdScorer final : public BaseScorer {
+ private:
+  std::shared_ptr<BaseScorer> _row_major;
+  size_t _max_transposed_questions;
+
+  // The AVX2 kernel keeps the per-exam sums in 16-bit lanes, and widens them
+  // into 32-bit ones every 256 questions: 256 * 128 still fits in an int16_t
+  static constexpr size_t kFlushQuestions = 256;
+
+  SIMD_TARGET_AVX512
+  static void score_group_avx512(const int8_t *group,
+                                 const ByteArray &correct_answers,
+                                 const ByteArray &points, int32_t *out) {
+    // Exams 0-15, 16-31, 32-47 and 48-63 of the group. With mask registers
+    // the sums can go straight into 32-bit lanes, so nothing has to be widened.
+    __m512i total[4];
+    for (auto &t : total) {
+      t = _mm512_setzero_si512();
+    }
+
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      const __m512i answers = _mm512_load_si512(group + (j << 6));
+      const __mmask64 mask = _mm512_cmpeq_epi8_mask(
+          answers, _mm512_set1_epi8(correct_answers[j]));
+      const __m512i p = _mm512_set1_epi32(points[j]);
+
+      for (size_t k = 0; k < 4; ++k) {
+        total[k] = _mm512_mask_add_epi32(
+            total[k], static_cast<__mmask16>(mask >> (k << 4)), total[k], p);
+      }
+    }
+
+    for (size_t k = 0; k < 4; ++k) {
+      _mm512_storeu_si512(out + (k << 4), total[k]);
+    }
+  }
+
+  SIMD_TARGET_AVX2
+  static void score_group_avx2(const int8_t *group,
+                               const ByteArray &correct_answers,
+                               const ByteArray &points, int32_t *out) {
+    __m256i total[8];
+    for (auto &t : total) {
+      t = _mm256_setzero_si256();
+    }
+
+    for (size_t first = 0; first < correct_answers.size();
+         first += kFlushQuestions) {
+      const size_t last =
+          std::min(first + kFlushQuestions, correct_answers.size());
+      // 16 exams per accumulator
+      __m256i sums[4];
+      for (auto &s : sums) {
+        s = _mm256_setzero_si256();
+      }
+
+      for (size_t j = first; j < last; ++j) {
+        const __m256i key = _mm256_set1_epi8(correct_answers[j]);
+        const __m256i p = _mm256_set1_epi16(points[j]);
+
+        for (size_t h = 0; h < 2; ++h) {
+          const __m256i answers = _mm256_load_si256(
+              reinterpret_cast<const __m256i *>(group + (j << 6) + (h << 5)));
+          // 0xff for the correct answers, sign-extended to 0xffff
+          const __m256i mask = _mm256_cmpeq_epi8(answers, key);
+          const __m256i mask_lo =
+              _mm256_cvtepi8_epi16(_mm256_castsi256_si128(mask));
+          const __m256i mask_hi =
+              _mm256_cvtepi8_epi16(_mm256_extracti128_si256(mask, 1));
+
+          sums[h << 1] =
+              _mm256_add_epi16(sums[h << 1], _mm256_and_si256(mask_lo, p));
+          sums[(h << 1) + 1] = _mm256_add_epi16(sums[(h << 1) + 1],
+                                                _mm256_and_si256(mask_hi, p));
+        }
+      }
+
+      for (size_t k = 0; k < 4; ++k) {
+        total[k << 1] = _mm256_add_epi32(
+            total[k << 1],
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(sums[k])));
+        total[(k << 1) + 1] = _mm256_add_epi32(
+            total[(k << 1) + 1],
+            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(sums[k], 1)));
+      }
+    }
+
+    for (size_t k = 0; k < 8; ++k) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + (k << 3)),
+                          total[k]);
+    }
+  }
+
+  static void score_group(const int8_t *group, const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) {
+    if (Cpu::supports_avx512()) {
+      score_group_avx512(group, correct_answers, points, out);
+    } else {
+      score_group_avx2(group, correct_answers, points, out);
+    }
+  }
+
+  // Transpose and score the exams given by `row(i)` for i in [0, count)
+  template <typename Row>
+  static void score_transposing(const size_t &count, const Row &row,
+                                const ByteArray &correct_answers,
+                                const ByteArray &points, int32_t *out) {
+    TransposedExamBatch group(64, correct_answers.size());
+    const int8_t *rows[64];
+    int32_t scores[64];
+
+    for (size_t first = 0; first < count; first += 64) {
+      const size_t exams = std::min<size_t>(64, count - first);
+      for (size_t k = 0; k < 64; ++k) {
+        rows[k] = k < exams ? row(first + k) : nullptr;
+      }
+
+      transpose_exam_group(rows, correct_answers.size(), group.data());
+      score_group(group.data(), correct_answers, points, scores);
+      std::copy_n(scores, exams, out + first);
+    }
+  }
+
+ public:
+  explicit TransposedSimdScorer(const size_t &max_transposed_questions = 64)
+      : _row_major(make_best_scorer()),
+        _max_transposed_questions(max_transposed_questions) {}
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx2()) {
+      throw std::runtime_error(
+          "Transposed SIMD checker not supported because the CPU lacks AVX2 "
+          "support.");
+    }
+  }
+
+  // Score a batch that is already stored question-major
+  std::vector<int32_t> score(const TransposedExamBatch &exams,
+                             const ByteArray &correct_answers,
+                             const ByteArray &points) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_answers(correct_answers, points);
+    check_exam(exams.question_count(), correct_answers);
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    int32_t scores[64];
+
+    for (size_t g = 0; g < exams.group_count(); ++g) {
+      const size_t first = g << 6;
+      score_group(exams.group(g), correct_answers, points, scores);
+      std::copy_n(scores, std::min<size_t>(64, exams.exam_count() - first),
+                  scored_exams_points.data() + first);
+    }
+
+    return scored_exams_points;
+  }
+
+  using BaseScorer::score;
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    if (correct_answers.size() > _max_transposed_questions) {
+      _row_major->score_range(exams, first, last, correct_answers, points,
+                              out);
+      return;
+    }
+
+    for (size_t i = first; i < last; ++i) {
+      check_exam(exams[i].size(), correct_answers);
+    }
+
+    score_transposing(
+        last - first,
+        [&](const size_t &i) -> const int8_t * {
+          return exams[first + i].data();
+        },
+        correct_answers, points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    if (correct_answers.size() > _max_transposed_questions) {
+      _row_major->score_rows(rows, pitch, count, correct_answers, points, out);
+      return;
+    }
+
+    score_transposing(
+        count,
+        [&](const size_t &i) -> const int8_t * { return rows + i * pitch; },
+        correct_answers, points, out);
+  }
+
+  // Scattered exams are gathered 64 at a time into the same transposed group
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const ByteArray &points, int32_t *out) override {
+    if (correct_answers.size() > _max_transposed_questions) {
+      _row_major->score_row_pointers(rows, count, correct_answers, points,
+                                     out);
+      return;
+    }
+
+    score_transposing(
+        count, [&](const size_t &i) -> const int8_t * { return rows[i]; },
+        correct_answers, points, out);
+  }
+};
+}  // namespace Scorer
+
+#endif
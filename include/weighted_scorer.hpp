@@ -0,0 +1,551 @@
+#ifndef WEIGHTED_SCORER_HPP
+#define WEIGHTED_SCORER_HPP
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "cpu.hpp"
+#include "exam.h"
+
+namespace Scorer {
+// A blank answer is neither rewarded nor penalized. The zero padding of the
+// exams counts as blank too.
+inline constexpr int8_t kBlankAnswer = ' ';
+
+// Scorers for signed points wider than the SAD-based kernels allow, with
+// negative marking: a correct answer adds `points[j]`, a wrong one subtracts
+// `penalties[j]`, and a blank adds nothing. `Point` is int8_t or int16_t.
+template <typename Point>
+class BaseWeightedScorer {
+  static_assert(std::is_same_v<Point, int8_t> || std::is_same_v<Point, int16_t>,
+                "The points must be int8_t or int16_t.");
+
+ public:
+  virtual ~BaseWeightedScorer() = default;
+
+  std::vector<int32_t> score(const ExamBatch &exams,
+                             const ByteArray &correct_answers,
+                             const PointArray<Point> &points,
+                             const PointArray<Point> &penalties) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_answers(correct_answers, points, penalties);
+    check_exam(exams.question_count(), correct_answers);
+
+    std::vector<int32_t> scored_exams_points(exams.exam_count());
+    score_rows(exams.data(), exams.pitch(), exams.exam_count(),
+               correct_answers, points, penalties, scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  std::vector<int32_t> score(const std::vector<ByteArray> &exams,
+                             const ByteArray &correct_answers,
+                             const PointArray<Point> &points,
+                             const PointArray<Point> &penalties) {
+    ensure_cpu_support();
+
+    if (exams.empty()) {
+      return {};
+    }
+
+    check_answers(correct_answers, points, penalties);
+
+    std::vector<const int8_t *> rows;
+    rows.reserve(exams.size());
+    for (const auto &exam : exams) {
+      check_exam(exam.size(), correct_answers);
+      rows.push_back(exam.data());
+    }
+
+    std::vector<int32_t> scored_exams_points(exams.size());
+    score_row_pointers(rows.data(), rows.size(), correct_answers, points,
+                       penalties, scored_exams_points.data());
+
+    return scored_exams_points;
+  }
+
+  // Without negative marking
+  template <typename Exams>
+  std::vector<int32_t> score(const Exams &exams,
+                             const ByteArray &correct_answers,
+                             const PointArray<Point> &points) {
+    return score(exams, correct_answers, points,
+                 PointArray<Point>(points.size()));
+  }
+
+  // Score `count` exams stored `pitch` bytes apart, starting at `rows`, and
+  // write the results to out[0, count). Every row must be readable (and
+  // zero-padded) up to `correct_answers.capacity()` bytes.
+  virtual void score_rows(const int8_t *rows, const size_t &pitch,
+                          const size_t &count,
+                          const ByteArray &correct_answers,
+                          const PointArray<Point> &points,
+                          const PointArray<Point> &penalties,
+                          int32_t *out) = 0;
+
+  // The same, for the `count` exams pointed to by `rows`
+  virtual void score_row_pointers(const int8_t *const *rows,
+                                  const size_t &count,
+                                  const ByteArray &correct_answers,
+                                  const PointArray<Point> &points,
+                                  const PointArray<Point> &penalties,
+                                  int32_t *out) = 0;
+
+  // Throw if the CPU can't run this scorer
+  virtual void ensure_cpu_support() const {}
+
+ protected:
+  static void check_answers(const ByteArray &correct_answers,
+                            const PointArray<Point> &points,
+                            const PointArray<Point> &penalties) {
+    if (correct_answers.size() != points.size() ||
+        correct_answers.size() != penalties.size()) {
+      throw std::runtime_error(
+          "The size of correct answers, points and penalties must be the "
+          "same.");
+    }
+  }
+
+  static void check_exam(const size_t &exam_size,
+                         const ByteArray &correct_answers) {
+    if (exam_size != correct_answers.size()) {
+      throw std::runtime_error(
+          "The size of exams' questions and correct answers must be the "
+          "same.");
+    }
+  }
+
+  // SAD only adds unsigned bytes, so the int8 kernels add `value + 128`
+  // instead (the sign bit flipped), and take 128 back for every added value
+  static PointArray<int8_t> biased(const PointArray<int8_t> &values) {
+    PointArray<int8_t> biased_values(values.size());
+    for (size_t j = 0; j < values.capacity(); ++j) {
+      biased_values[j] = static_cast<int8_t>(values[j] ^ 0x80);
+    }
+    return biased_values;
+  }
+};
+
+template <typename Point>
+class NaiveWeightedScorer final : public BaseWeightedScorer<Point> {
+ public:
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers,
+                  const PointArray<Point> &points,
+                  const PointArray<Point> &penalties, int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows + i * pitch, correct_answers, points, penalties);
+    }
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const PointArray<Point> &points,
+                          const PointArray<Point> &penalties,
+                          int32_t *out) override {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(rows[i], correct_answers, points, penalties);
+    }
+  }
+
+ private:
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const PointArray<Point> &points,
+                            const PointArray<Point> &penalties) {
+    int32_t score = 0;
+
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      if (exam[j] == kBlankAnswer || exam[j] == 0) {
+        continue;
+      }
+
+      if (exam[j] == correct_answers[j]) {
+        score += static_cast<int32_t>(points[j]);
+      } else {
+        score -= static_cast<int32_t>(penalties[j]);
+      }
+    }
+
+    return score;
+  }
+};
+
+template <typename Point>
+class SimdWeightedScorer final : public BaseWeightedScorer<Point> {
+  using Base = BaseWeightedScorer<Point>;
+
+ public:
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers,
+                  const PointArray<Point> &points,
+                  const PointArray<Point> &penalties, int32_t *out) override {
+    score_all(
+        count,
+        [&](const size_t &i) -> const int8_t * { return rows + i * pitch; },
+        correct_answers, points, penalties, out);
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const PointArray<Point> &points,
+                          const PointArray<Point> &penalties,
+                          int32_t *out) override {
+    score_all(
+        count, [&](const size_t &i) -> const int8_t * { return rows[i]; },
+        correct_answers, points, penalties, out);
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx2()) {
+      throw std::runtime_error(
+          "SIMD weighted checker not supported because the CPU lacks AVX2 "
+          "support.");
+    }
+  }
+
+ private:
+  template <typename Row>
+  static void score_all(const size_t &count, const Row &row,
+                        const ByteArray &correct_answers,
+                        const PointArray<Point> &points,
+                        const PointArray<Point> &penalties, int32_t *out) {
+    if constexpr (std::is_same_v<Point, int8_t>) {
+      score_exams(count, row, correct_answers, Base::biased(points),
+                  Base::biased(penalties), out);
+    } else {
+      score_exams(count, row, correct_answers, points, penalties, out);
+    }
+  }
+
+  template <typename Row>
+  SIMD_TARGET_AVX2 static void score_exams(const size_t &count, const Row &row,
+                                           const ByteArray &correct_answers,
+                                           const PointArray<Point> &points,
+                                           const PointArray<Point> &penalties,
+                                           int32_t *out) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(row(i), correct_answers, points, penalties);
+    }
+  }
+
+  // Mark the correct and the wrong answers of a block of 32 questions with
+  // 0xff, blanks being neither
+  SIMD_TARGET_AVX2
+  static void mark_answers(const int8_t *exam, const int8_t *correct_answers,
+                           __m256i &correct, __m256i &wrong) {
+    const __m256i answers =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(exam));
+    const __m256i blank = _mm256_or_si256(
+        _mm256_cmpeq_epi8(answers, _mm256_set1_epi8(kBlankAnswer)),
+        _mm256_cmpeq_epi8(answers, _mm256_setzero_si256()));
+
+    correct = _mm256_andnot_si256(
+        blank, _mm256_cmpeq_epi8(answers,
+                                 _mm256_loadu_si256(
+                                     reinterpret_cast<const __m256i *>(
+                                         correct_answers))));
+    wrong = _mm256_xor_si256(_mm256_or_si256(correct, blank),
+                             _mm256_set1_epi8(-1));
+  }
+
+  SIMD_TARGET_AVX2
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const PointArray<Point> &points,
+                            const PointArray<Point> &penalties) {
+    if constexpr (std::is_same_v<Point, int8_t>) {
+      // `points` and `penalties` are biased, see BaseWeightedScorer::biased
+      __m256i point_sums = _mm256_setzero_si256();
+      __m256i penalty_sums = _mm256_setzero_si256();
+      int32_t bias = 0;
+
+      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
+           ++j, _j = j << 5) {
+        __m256i correct, wrong;
+        mark_answers(exam + _j, correct_answers.data() + _j, correct, wrong);
+
+        point_sums = _mm256_add_epi64(
+            point_sums,
+            _mm256_sad_epu8(
+                _mm256_and_si256(correct,
+                                 _mm256_loadu_si256(
+                                     reinterpret_cast<const __m256i *>(
+                                         points.data() + _j))),
+                _mm256_setzero_si256()));
+        penalty_sums = _mm256_add_epi64(
+            penalty_sums,
+            _mm256_sad_epu8(
+                _mm256_and_si256(wrong,
+                                 _mm256_loadu_si256(
+                                     reinterpret_cast<const __m256i *>(
+                                         penalties.data() + _j))),
+                _mm256_setzero_si256()));
+        bias += __builtin_popcount(_mm256_movemask_epi8(wrong)) -
+                __builtin_popcount(_mm256_movemask_epi8(correct));
+      }
+
+      // Every sum fits in the lower 32 bits of its 64-bit lane
+      const __m256i sums = _mm256_sub_epi64(point_sums, penalty_sums);
+      const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums),
+                                        _mm256_extracti128_si256(sums, 1));
+      return static_cast<int32_t>(_mm_cvtsi128_si64(sum) +
+                                  _mm_extract_epi64(sum, 1)) +
+             (bias << 7);
+    } else {
+      // Sign-extend the marks to 16 bits (0 or -1), mask the points with
+      // them, and let madd add every pair of points into 32 bits
+      const __m256i one = _mm256_set1_epi16(1);
+      __m256i point_sums = _mm256_setzero_si256();
+      __m256i penalty_sums = _mm256_setzero_si256();
+
+      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx2();
+           ++j, _j = j << 5) {
+        __m256i correct, wrong;
+        mark_answers(exam + _j, correct_answers.data() + _j, correct, wrong);
+
+        for (size_t h = 0; h < 2; ++h) {
+          const __m256i correct16 = _mm256_cvtepi8_epi16(
+              h ? _mm256_extracti128_si256(correct, 1)
+                : _mm256_castsi256_si128(correct));
+          const __m256i wrong16 = _mm256_cvtepi8_epi16(
+              h ? _mm256_extracti128_si256(wrong, 1)
+                : _mm256_castsi256_si128(wrong));
+
+          point_sums = _mm256_add_epi32(
+              point_sums,
+              _mm256_madd_epi16(
+                  _mm256_and_si256(correct16,
+                                   _mm256_loadu_si256(
+                                       reinterpret_cast<const __m256i *>(
+                                           points.data() + _j + (h << 4)))),
+                  one));
+          penalty_sums = _mm256_add_epi32(
+              penalty_sums,
+              _mm256_madd_epi16(
+                  _mm256_and_si256(wrong16,
+                                   _mm256_loadu_si256(
+                                       reinterpret_cast<const __m256i *>(
+                                           penalties.data() + _j + (h << 4)))),
+                  one));
+        }
+      }
+
+      const __m256i sums = _mm256_sub_epi32(point_sums, penalty_sums);
+      __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sums),
+                                  _mm256_extracti128_si256(sums, 1));
+      sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+      sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+      return _mm_cvtsi128_si32(sum);
+    }
+  }
+};
+
+template <typename Point>
+class SimdAvx512WeightedScorer final : public BaseWeightedScorer<Point> {
+  using Base = BaseWeightedScorer<Point>;
+
+ public:
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers,
+                  const PointArray<Point> &points,
+                  const PointArray<Point> &penalties, int32_t *out) override {
+    score_all(
+        count,
+        [&](const size_t &i) -> const int8_t * { return rows + i * pitch; },
+        correct_answers, points, penalties, out);
+  }
+
+  void score_row_pointers(const int8_t *const *rows, const size_t &count,
+                          const ByteArray &correct_answers,
+                          const PointArray<Point> &points,
+                          const PointArray<Point> &penalties,
+                          int32_t *out) override {
+    score_all(
+        count, [&](const size_t &i) -> const int8_t * { return rows[i]; },
+        correct_answers, points, penalties, out);
+  }
+
+  void ensure_cpu_support() const override {
+    if (!Cpu::supports_avx512()) {
+      throw std::runtime_error(
+          "SIMD AVX512 weighted checker not supported because the CPU lacks "
+          "AVX512{BW,VL,F,DQ} support.");
+    }
+  }
+
+ private:
+  template <typename Row>
+  static void score_all(const size_t &count, const Row &row,
+                        const ByteArray &correct_answers,
+                        const PointArray<Point> &points,
+                        const PointArray<Point> &penalties, int32_t *out) {
+    if constexpr (std::is_same_v<Point, int8_t>) {
+      score_exams(count, row, correct_answers, Base::biased(points),
+                  Base::biased(penalties), out);
+    } else if (Cpu::supports_avx512_vnni()) {
+      score_exams_vnni(count, row, correct_answers, points, penalties, out);
+    } else {
+      score_exams(count, row, correct_answers, points, penalties, out);
+    }
+  }
+
+  template <typename Row>
+  SIMD_TARGET_AVX512 static void score_exams(const size_t &count,
+                                             const Row &row,
+                                             const ByteArray &correct_answers,
+                                             const PointArray<Point> &points,
+                                             const PointArray<Point> &penalties,
+                                             int32_t *out) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam(row(i), correct_answers, points, penalties);
+    }
+  }
+
+  template <typename Row>
+  SIMD_TARGET_AVX512_VNNI static void score_exams_vnni(
+      const size_t &count, const Row &row, const ByteArray &correct_answers,
+      const PointArray<Point> &points, const PointArray<Point> &penalties,
+      int32_t *out) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = score_exam_vnni(row(i), correct_answers, points, penalties);
+    }
+  }
+
+  // Mark the correct and the wrong answers of a block of 64 questions, blanks
+  // being neither
+  SIMD_TARGET_AVX512
+  static void mark_answers(const int8_t *exam, const int8_t *correct_answers,
+                           __mmask64 &correct, __mmask64 &wrong) {
+    const __m512i answers = _mm512_loadu_si512(exam);
+    const __mmask64 blank =
+        _mm512_cmpeq_epi8_mask(answers, _mm512_set1_epi8(kBlankAnswer)) |
+        _mm512_testn_epi8_mask(answers, answers);
+
+    correct =
+        _mm512_cmpeq_epi8_mask(answers, _mm512_loadu_si512(correct_answers)) &
+        ~blank;
+    wrong = ~(correct | blank);
+  }
+
+  SIMD_TARGET_AVX512
+  static int32_t score_exam(const int8_t *exam,
+                            const ByteArray &correct_answers,
+                            const PointArray<Point> &points,
+                            const PointArray<Point> &penalties) {
+    if constexpr (std::is_same_v<Point, int8_t>) {
+      // `points` and `penalties` are biased, see BaseWeightedScorer::biased
+      __m512i point_sums = _mm512_setzero_si512();
+      __m512i penalty_sums = _mm512_setzero_si512();
+      int32_t bias = 0;
+
+      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+           ++j, _j = j << 6) {
+        __mmask64 correct, wrong;
+        mark_answers(exam + _j, correct_answers.data() + _j, correct, wrong);
+
+        point_sums = _mm512_add_epi64(
+            point_sums,
+            _mm512_sad_epu8(_mm512_maskz_mov_epi8(
+                                correct, _mm512_loadu_si512(points.data() + _j)),
+                            _mm512_setzero_si512()));
+        penalty_sums = _mm512_add_epi64(
+            penalty_sums,
+            _mm512_sad_epu8(
+                _mm512_maskz_mov_epi8(wrong,
+                                      _mm512_loadu_si512(penalties.data() + _j)),
+                _mm512_setzero_si512()));
+        bias += static_cast<int32_t>(__builtin_popcountll(wrong)) -
+                static_cast<int32_t>(__builtin_popcountll(correct));
+      }
+
+      return static_cast<int32_t>(_mm512_reduce_add_epi64(
+                 _mm512_sub_epi64(point_sums, penalty_sums))) +
+             (bias << 7);
+    } else {
+      // Mask 32 points at a time, and let madd add every pair of them into
+      // 32 bits
+      const __m512i one = _mm512_set1_epi16(1);
+      __m512i point_sums = _mm512_setzero_si512();
+      __m512i penalty_sums = _mm512_setzero_si512();
+
+      for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+           ++j, _j = j << 6) {
+        __mmask64 correct, wrong;
+        mark_answers(exam + _j, correct_answers.data() + _j, correct, wrong);
+
+        for (size_t h = 0; h < 2; ++h) {
+          const size_t k = _j + (h << 5);
+          point_sums = _mm512_add_epi32(
+              point_sums,
+              _mm512_madd_epi16(
+                  _mm512_maskz_mov_epi16(static_cast<__mmask32>(correct >> (h << 5)),
+                                         _mm512_loadu_si512(points.data() + k)),
+                  one));
+          penalty_sums = _mm512_add_epi32(
+              penalty_sums,
+              _mm512_madd_epi16(
+                  _mm512_maskz_mov_epi16(static_cast<__mmask32>(wrong >> (h << 5)),
+                                         _mm512_loadu_si512(penalties.data() + k)),
+                  one));
+        }
+      }
+
+      return _mm512_reduce_add_epi32(_mm512_sub_epi32(point_sums, penalty_sums));
+    }
+  }
+
+  // The int16 kernel, with the masking and the multiply-accumulate fused into
+  // one VNNI instruction per 32 questions
+  SIMD_TARGET_AVX512_VNNI
+  static int32_t score_exam_vnni(const int8_t *exam,
+                                 const ByteArray &correct_answers,
+                                 const PointArray<Point> &points,
+                                 const PointArray<Point> &penalties) {
+    const __m512i one = _mm512_set1_epi16(1);
+    __m512i point_sums = _mm512_setzero_si512();
+    __m512i penalty_sums = _mm512_setzero_si512();
+
+    for (size_t j = 0, _j = 0; j < correct_answers.block_count_avx512();
+         ++j, _j = j << 6) {
+      __mmask64 correct, wrong;
+      mark_answers(exam + _j, correct_answers.data() + _j, correct, wrong);
+
+      for (size_t h = 0; h < 2; ++h) {
+        const size_t k = _j + (h << 5);
+        // The masked-out words of `one` are zeroed, so they add nothing
+        point_sums = _mm512_dpwssd_epi32(
+            point_sums, _mm512_loadu_si512(points.data() + k),
+            _mm512_maskz_mov_epi16(static_cast<__mmask32>(correct >> (h << 5)),
+                                   one));
+        penalty_sums = _mm512_dpwssd_epi32(
+            penalty_sums, _mm512_loadu_si512(penalties.data() + k),
+            _mm512_maskz_mov_epi16(static_cast<__mmask32>(wrong >> (h << 5)),
+                                   one));
+      }
+    }
+
+    return _mm512_reduce_add_epi32(_mm512_sub_epi32(point_sums, penalty_sums));
+  }
+};
+
+// Create the fastest weighted scorer that the CPU supports
+template <typename Point>
+std::shared_ptr<BaseWeightedScorer<Point>> make_best_weighted_scorer() {
+  if (Cpu::supports_avx512()) {
+    return std::make_shared<SimdAvx512WeightedScorer<Point>>();
+  }
+  if (Cpu::supports_avx2()) {
+    return std::make_shared<SimdWeightedScorer<Point>>();
+  }
+  return std::make_shared<NaiveWeightedScorer<Point>>();
+}
+}  // namespace Scorer
+
+#endif
@@ -0,0 +1,119 @@
+"""Time the Python bindings against the same calls made from C++.
+
+    python3 python/benchmark_bindings.py [--main-benchmark build/main_benchmark]
+
+For every shape of BM_CAbiScore, this prints the time per call of
+simd_scorer.Scorer.score from Python, with and without a preallocated output
+array, next to BM_CAbiScore's time for the same C call from C++ (when the
+benchmark executable is given), and the difference, i.e. the overhead of the
+bindings.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+import numpy as np
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+import simd_scorer  # noqa: E402
+
+SHAPES = [
+    (exams, questions)
+    for questions in (10, 100, 1000)
+    for exams in (1, 1000, 100_000)
+]
+
+
+def time_per_call(function, min_time=0.2):
+    """The best time per call (in us) of batches lasting `min_time` seconds"""
+    calls = 1
+    while True:
+        start = time.perf_counter()
+        for _ in range(calls):
+            function()
+        elapsed = time.perf_counter() - start
+        if elapsed >= min_time:
+            break
+        calls *= 10 if elapsed < min_time / 10 else 2
+
+    best = elapsed
+    for _ in range(2):
+        start = time.perf_counter()
+        for _ in range(calls):
+            function()
+        best = min(best, time.perf_counter() - start)
+    return best / calls * 1e6
+
+
+def cpp_times(main_benchmark):
+    output = subprocess.run(
+        [
+            main_benchmark,
+            "--benchmark_filter=BM_CAbiScore",
+            "--benchmark_format=json",
+        ],
+        check=True,
+        capture_output=True,
+        text=True,
+    ).stdout
+
+    times = {}
+    for run in json.loads(output)["benchmarks"]:
+        arguments = dict(
+            part.split(":") for part in run["name"].split("/")[1:]
+        )
+        shape = (int(arguments["exams"]), int(arguments["questions"]))
+        # BM_CAbiScore reports microseconds
+        times[shape] = run["real_time"]
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument(
+        "--main-benchmark",
+        help="the main_benchmark executable, to compare with BM_CAbiScore",
+    )
+    args = parser.parse_args()
+
+    cpp = cpp_times(args.main_benchmark) if args.main_benchmark else {}
+    random = np.random.default_rng(1)
+    scorer = simd_scorer.Scorer()
+
+    print(
+        f"{'exams':>8} {'questions':>9} {'python us':>10} {'with out':>10} "
+        f"{'c++ us':>10} {'overhead us':>12}"
+    )
+    for exam_count, question_count in SHAPES:
+        exams = random.integers(
+            ord("A"), ord("D") + 1, (exam_count, question_count), np.uint8
+        )
+        correct_answers = random.integers(
+            ord("A"), ord("D") + 1, question_count, np.uint8
+        )
+        points = random.integers(1, 11, question_count, np.uint8)
+        out = np.empty(exam_count, dtype=np.int32)
+
+        python = time_per_call(
+            lambda: scorer.score(exams, correct_answers, points)
+        )
+        python_out = time_per_call(
+            lambda: scorer.score(exams, correct_answers, points, out)
+        )
+
+        line = (
+            f"{exam_count:>8} {question_count:>9} {python:>10.2f} "
+            f"{python_out:>10.2f}"
+        )
+        if (exam_count, question_count) in cpp:
+            native = cpp[(exam_count, question_count)]
+            line += f" {native:>10.2f} {python_out - native:>12.2f}"
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,69 @@
+"""NumPy bindings of the simd_scorer shared library (see include/simd_scorer.h).
+
+    import numpy as np
+    import simd_scorer
+
+    exams = np.frombuffer(data, dtype=np.uint8).reshape(-1, question_count)
+    scores = simd_scorer.score(exams, correct_answers, points)
+
+The exams (a 2-D array of bytes, e.g. uint8, or any object with the buffer
+protocol), the key and the points (1-D) are read by the library in place,
+without copying, as long as the answers of each exam are contiguous (the rows
+may be strided, e.g. a slice of the columns of a wider array). The scores are
+written straight into the int32 array that is returned. The GIL is released
+while the exams are scored, so other Python threads keep running. Every point
+must be in 0..127, else a ValueError is raised.
+
+The _simd_scorer extension module is built with the library (the
+simd_scorer_python target) into <build>/python. It is imported from the
+path, then from the build directory of the repository.
+"""
+
+import sys
+from pathlib import Path
+
+import numpy as np
+
+try:
+    import _simd_scorer
+except ImportError:
+    sys.path.append(str(Path(__file__).resolve().parent.parent / "build" / "python"))
+    import _simd_scorer
+
+ABI_VERSION = 1
+
+if _simd_scorer.ABI_VERSION != ABI_VERSION:
+    raise ImportError(
+        f"libsimd_scorer ABI version {_simd_scorer.ABI_VERSION}, the bindings "
+        f"expect {ABI_VERSION}"
+    )
+
+
+class Scorer:
+    """A scorer of the library, with the kernel `kernel`: "best", "parallel",
+    "naive", "sse41", "avx2" or "avx512" (see simd_scorer_create)"""
+
+    def __init__(self, kernel="best"):
+        self._scorer = _simd_scorer.create(kernel)
+
+    def score(self, exams, correct_answers, points, out=None):
+        """The scores of `exams` (exams x questions) as an int32 array, written
+        to `out` if given"""
+        if out is None:
+            out = np.empty(len(exams), dtype=np.int32)
+        elif out.dtype != np.int32:
+            raise ValueError("out must be an int32 array")
+
+        _simd_scorer.score(self._scorer, exams, correct_answers, points, out)
+        return out
+
+
+_default = None
+
+
+def score(exams, correct_answers, points, out=None):
+    """Score with a shared "best" scorer"""
+    global _default
+    if _default is None:
+        _default = Scorer()
+    return _default.score(exams, correct_answers, points, out)
@@ -0,0 +1,158 @@
+// The _simd_scorer extension module, a thin layer over the C ABI of the
+// simd_scorer library (include/simd_scorer.h) that python/simd_scorer.py
+// wraps. The exams, the key, the points and the scores are taken through the
+// buffer protocol, so they are read and written in place, and the GIL is
+// released while the exams are scored.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "simd_scorer.h"
+
+static const char *kCapsuleName = "simd_scorer";
+
+static PyObject *scoring_error(const simd_scorer_status &status) {
+  PyErr_Format(status == SIMD_SCORER_INTERNAL_ERROR ? PyExc_RuntimeError
+                                                    : PyExc_ValueError,
+               "%s", simd_scorer_last_error());
+  return nullptr;
+}
+
+static void destroy_scorer(PyObject *capsule) {
+  simd_scorer_destroy(static_cast<simd_scorer *>(
+      PyCapsule_GetPointer(capsule, kCapsuleName)));
+}
+
+// create(kernel) -> a capsule owning a scorer
+static PyObject *create(PyObject *, PyObject *args) {
+  const char *kernel = nullptr;
+  if (!PyArg_ParseTuple(args, "|z", &kernel)) {
+    return nullptr;
+  }
+
+  simd_scorer *scorer = nullptr;
+  const simd_scorer_status status = simd_scorer_create(kernel, &scorer);
+  if (status != SIMD_SCORER_OK) {
+    return scoring_error(status);
+  }
+  return PyCapsule_New(scorer, kCapsuleName, destroy_scorer);
+}
+
+// Releases the buffers it holds on every path
+class Buffers {
+ private:
+  Py_buffer _views[4] = {};
+  int _count = 0;
+
+ public:
+  // The buffer of `object` with `flags`, or null with a Python error set
+  Py_buffer *get(PyObject *object, const int &flags) {
+    if (PyObject_GetBuffer(object, &_views[_count], flags) != 0) {
+      return nullptr;
+    }
+    return &_views[_count++];
+  }
+
+  ~Buffers() {
+    for (int i = 0; i < _count; ++i) {
+      PyBuffer_Release(&_views[i]);
+    }
+  }
+};
+
+// Whether `view` holds `dimensions`-D bytes, each row contiguous
+static bool is_byte_array(const Py_buffer &view, const int &dimensions,
+                          const char *name) {
+  if (view.itemsize != 1 || view.ndim != dimensions) {
+    PyErr_Format(PyExc_ValueError, "%s must be a %d-D array of bytes", name,
+                 dimensions);
+    return false;
+  }
+  if (view.shape[dimensions - 1] > 1 && view.strides[dimensions - 1] != 1) {
+    PyErr_Format(PyExc_ValueError, "the answers of %s must be contiguous",
+                 name);
+    return false;
+  }
+  if (dimensions == 2 && view.strides[0] < 0) {
+    PyErr_Format(PyExc_ValueError, "%s must be in increasing addresses", name);
+    return false;
+  }
+  return true;
+}
+
+// score(scorer, exams, correct_answers, points, out)
+static PyObject *score(PyObject *, PyObject *args) {
+  PyObject *capsule, *exams_object, *key_object, *points_object, *out_object;
+  if (!PyArg_ParseTuple(args, "OOOOO", &capsule, &exams_object, &key_object,
+                        &points_object, &out_object)) {
+    return nullptr;
+  }
+  auto *scorer =
+      static_cast<simd_scorer *>(PyCapsule_GetPointer(capsule, kCapsuleName));
+  if (!scorer) {
+    return nullptr;
+  }
+
+  Buffers buffers;
+  const Py_buffer *exams = buffers.get(exams_object, PyBUF_STRIDES);
+  const Py_buffer *key =
+      exams ? buffers.get(key_object, PyBUF_STRIDES) : nullptr;
+  const Py_buffer *points =
+      key ? buffers.get(points_object, PyBUF_STRIDES) : nullptr;
+  const Py_buffer *out =
+      points ? buffers.get(out_object, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS)
+             : nullptr;
+  if (!out || !is_byte_array(*exams, 2, "exams") ||
+      !is_byte_array(*key, 1, "correct_answers") ||
+      !is_byte_array(*points, 1, "points")) {
+    return nullptr;
+  }
+
+  const auto exam_count = static_cast<size_t>(exams->shape[0]);
+  const auto question_count = static_cast<size_t>(exams->shape[1]);
+  if (static_cast<size_t>(key->shape[0]) != question_count ||
+      static_cast<size_t>(points->shape[0]) != question_count) {
+    PyErr_SetString(PyExc_ValueError,
+                    "the exams, the key and the points have different sizes");
+    return nullptr;
+  }
+  if (static_cast<size_t>(out->len) != exam_count * sizeof(int32_t)) {
+    PyErr_SetString(PyExc_ValueError, "out must hold one int32 per exam");
+    return nullptr;
+  }
+
+  simd_scorer_status status;
+  Py_BEGIN_ALLOW_THREADS;
+  status = simd_scorer_score(
+      scorer, static_cast<const uint8_t *>(exams->buf), exam_count,
+      question_count, static_cast<size_t>(exams->strides[0]),
+      static_cast<const uint8_t *>(key->buf),
+      static_cast<const uint8_t *>(points->buf),
+      static_cast<int32_t *>(out->buf));
+  Py_END_ALLOW_THREADS;
+
+  if (status != SIMD_SCORER_OK) {
+    return scoring_error(status);
+  }
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef methods[] = {
+    {"create", create, METH_VARARGS, "Create a scorer of the library"},
+    {"score", score, METH_VARARGS, "Score exams into a buffer of int32"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "_simd_scorer", nullptr, -1, methods,
+};
+
+PyMODINIT_FUNC PyInit__simd_scorer() {
+  PyObject *created = PyModule_Create(&module);
+  if (created &&
+      PyModule_AddIntConstant(created, "ABI_VERSION",
+                              simd_scorer_abi_version()) != 0) {
+    Py_DECREF(created);
+    return nullptr;
+  }
+  return created;
+}
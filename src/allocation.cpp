@@ -0,0 +1,211 @@
+#include "allocation.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+static constexpr size_t kHugePageSize = size_t{2} << 20;
+
+static size_t round_up(const size_t &value, const size_t &multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+static void *allocate_heap(const size_t &bytes, const bool &zero_fill) {
+  // std::aligned_alloc requires the size to be a multiple of the alignment
+  void *data = std::aligned_alloc(64, round_up(bytes, 64));
+  if (!data) {
+    throw std::runtime_error("Failed to allocate " + std::to_string(bytes) +
+                             " bytes");
+  }
+  if (zero_fill) {
+    std::memset(data, 0, bytes);
+  }
+  return data;
+}
+
+#ifdef __linux__
+// The online memory nodes, from e.g. "0-1,3"
+static std::vector<unsigned long> online_nodes() {
+  std::vector<unsigned long> mask(1, 0);
+  std::ifstream file("/sys/devices/system/node/online");
+  std::string ranges;
+  if (!(file >> ranges)) {
+    return {};
+  }
+
+  size_t position = 0;
+  while (position < ranges.size()) {
+    size_t end = ranges.find(',', position);
+    if (end == std::string::npos) {
+      end = ranges.size();
+    }
+    const std::string range = ranges.substr(position, end - position);
+    const size_t dash = range.find('-');
+    const unsigned long first = std::stoul(range.substr(0, dash));
+    const unsigned long last =
+        dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+
+    for (unsigned long node = first; node <= last; ++node) {
+      const size_t word = node / (8 * sizeof(unsigned long));
+      if (word >= mask.size()) {
+        mask.resize(word + 1, 0);
+      }
+      mask[word] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+    position = end + 1;
+  }
+  return mask;
+}
+
+// Interleave the pages of [data, data + bytes) over the online nodes
+static bool interleave(void *data, const size_t &bytes) {
+  const auto mask = online_nodes();
+  if (mask.empty()) {
+    return false;
+  }
+  return ::syscall(SYS_mbind, data, bytes, MPOL_INTERLEAVE, mask.data(),
+                   mask.size() * 8 * sizeof(unsigned long) + 1, 0) == 0;
+}
+
+// Write one byte per page from `thread_count` threads, each over one
+// contiguous slice, so that the pages are allocated on their nodes. Thread k
+// is pinned like worker k of a pinned ThreadPool, else the scheduler could
+// move it, or the worker, to another node. Returns whether every thread was
+// pinned.
+static bool touch_in_parallel(int8_t *data, const size_t &bytes,
+                              size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  const size_t slice = round_up((bytes + thread_count - 1) / thread_count,
+                                page_size);
+
+  std::atomic<bool> pinned = true;
+  std::vector<std::thread> threads;
+  for (size_t first = 0; first < bytes; first += slice) {
+    threads.emplace_back([=, &pinned] {
+      if (!ThreadPool::pin_to_cpu(first / slice)) {
+        pinned = false;
+      }
+      const size_t last = std::min(first + slice, bytes);
+      for (size_t offset = first; offset < last; offset += page_size) {
+        // The pages are zero, this only makes the kernel allocate them
+        reinterpret_cast<volatile int8_t *>(data)[offset] = 0;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return pinned;
+}
+
+// An anonymous mapping of at least `bytes` bytes, aligned to a huge page when
+// `huge_pages` so that transparent huge pages can back all of it
+static Allocation map_anonymous(const size_t &bytes, const bool &huge_pages) {
+  Allocation allocation;
+  allocation.bytes = bytes;
+
+  if (huge_pages) {
+    const size_t length = round_up(bytes, kHugePageSize);
+    void *data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      allocation.data = data;
+      allocation.mapped_bytes = length;
+      allocation.hugetlb = true;
+      return allocation;
+    }
+
+    // The hugetlbfs pool is empty (or not configured): map 2 MiB more, trim
+    // both ends to a 2 MiB boundary, and ask for transparent huge pages
+    void *mapping = ::mmap(nullptr, length + kHugePageSize,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      return allocation;
+    }
+    const auto start = reinterpret_cast<uintptr_t>(mapping);
+    const uintptr_t aligned = round_up(start, kHugePageSize);
+    if (aligned != start) {
+      ::munmap(mapping, aligned - start);
+    }
+    if (const size_t tail = start + kHugePageSize - aligned; tail != 0) {
+      ::munmap(reinterpret_cast<void *>(aligned + length), tail);
+    }
+
+    allocation.data = reinterpret_cast<void *>(aligned);
+    allocation.mapped_bytes = length;
+    allocation.transparent_huge_pages =
+        ::madvise(allocation.data, length, MADV_HUGEPAGE) == 0;
+    return allocation;
+  }
+
+  void *data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data != MAP_FAILED) {
+    allocation.data = data;
+    allocation.mapped_bytes = bytes;
+  }
+  return allocation;
+}
+#endif
+
+Allocation allocate_buffer(const size_t &bytes,
+                           const AllocationOptions &options) {
+  Allocation allocation;
+  allocation.bytes = bytes;
+  if (bytes == 0) {
+    return allocation;
+  }
+
+#ifdef __linux__
+  // Mapped memory is zeroed page by page, when it's first touched, so it
+  // never needs a zero-fill pass
+  if (options.huge_pages || options.numa != NumaPlacement::kDefault) {
+    allocation = map_anonymous(bytes, options.huge_pages);
+  }
+
+  if (allocation.data) {
+    auto *data = static_cast<int8_t *>(allocation.data);
+    // mbind must come before the first touch to place the pages
+    if (options.numa == NumaPlacement::kInterleave) {
+      allocation.numa_placed = interleave(data, allocation.mapped_bytes);
+    } else if (options.numa == NumaPlacement::kParallelFirstTouch) {
+      allocation.numa_placed = touch_in_parallel(
+          data, allocation.mapped_bytes, options.first_touch_threads);
+    }
+    return allocation;
+  }
+#endif
+
+  allocation.data = allocate_heap(bytes, options.zero_fill);
+  return allocation;
+}
+
+void free_buffer(void *data, const size_t &mapped_bytes) {
+#ifdef __linux__
+  if (mapped_bytes != 0) {
+    ::munmap(data, mapped_bytes);
+    return;
+  }
+#endif
+  std::free(data);
+}
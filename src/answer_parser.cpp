@@ -0,0 +1,207 @@
+#include "answer_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cpu.hpp"
+
+namespace {
+// Calls `on_invalid(question, byte)` for the invalid bytes of a line
+template <typename OnInvalid>
+void copy_line_scalar(const char *line, const size_t &count, int8_t *row,
+                      const OnInvalid &on_invalid) {
+  for (size_t j = 0; j < count; ++j) {
+    const char c = line[j];
+    if ((c >= 'A' && c <= 'D') || c == ' ') {
+      row[j] = static_cast<int8_t>(c);
+    } else {
+      row[j] = ' ';
+      on_invalid(j, c);
+    }
+  }
+}
+
+template <typename OnInvalid>
+SIMD_TARGET_AVX2 void copy_line_avx2(const char *line, const size_t &count,
+                                     const bool &can_overread, int8_t *row,
+                                     const OnInvalid &on_invalid) {
+  const __m256i a = _mm256_set1_epi8('A');
+  const __m256i three = _mm256_set1_epi8(3);
+  const __m256i blank = _mm256_set1_epi8(' ');
+  const __m256i lane = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                        12, 13, 14, 15, 16, 17, 18, 19, 20, 21,
+                                        22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+
+  size_t j = 0;
+  // The last block may read past the line (but not past the text), the extra
+  // bytes are masked off, and the rows' padding absorbs the store
+  const size_t blocks_end = can_overread ? count : count & ~size_t{31};
+  for (; j < blocks_end; j += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + j));
+
+    // c - 'A' <= 3 (unsigned) for 'A'..'D'
+    const __m256i code = _mm256_sub_epi8(v, a);
+    const __m256i valid =
+        _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(code, three), code),
+                        _mm256_cmpeq_epi8(v, blank));
+    const __m256i in_line = _mm256_cmpgt_epi8(
+        _mm256_set1_epi8(static_cast<char>(std::min<size_t>(count - j, 32))),
+        lane);
+
+    uint32_t invalid = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_andnot_si256(valid, in_line)));
+
+    // Invalid bytes become blanks, bytes past the line become padding
+    v = _mm256_and_si256(_mm256_blendv_epi8(v, blank, _mm256_andnot_si256(
+                                                          valid, in_line)),
+                         in_line);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + j), v);
+
+    while (invalid) {
+      const size_t k = __builtin_ctz(invalid);
+      on_invalid(j + k, line[j + k]);
+      invalid &= invalid - 1;
+    }
+  }
+
+  if (j < count) {
+    copy_line_scalar(line + j, count - j, row + j,
+                     [&](const size_t &k, const char &c) {
+                       on_invalid(j + k, c);
+                     });
+  }
+}
+
+SIMD_TARGET_AVX2 size_t count_lines_avx2(const char *text,
+                                         const size_t &length) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t lines = 0;
+  size_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+    lines += __builtin_popcount(
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline))));
+  }
+  for (; i < length; ++i) {
+    lines += text[i] == '\n';
+  }
+
+  return lines;
+}
+
+size_t count_lines(const char *text, const size_t &length) {
+  size_t lines;
+  if (Cpu::supports_avx2()) {
+    lines = count_lines_avx2(text, length);
+  } else {
+    lines = std::count(text, text + length, '\n');
+  }
+
+  // An unterminated last line
+  return lines + (length > 0 && text[length - 1] != '\n');
+}
+}  // namespace
+
+size_t parse_answer_sheets(const char *text, const size_t &length,
+                           ExamBatch &exams,
+                           std::vector<AnswerSheetError> *errors) {
+  const size_t question_count = exams.question_count();
+  const bool avx2 = Cpu::supports_avx2();
+
+  size_t exam = 0;
+  const auto report = [&](const size_t &question, const char &byte) {
+    const AnswerSheetError error{exam, question, byte};
+    if (!errors) {
+      throw AnswerSheetParseError(error);
+    }
+    errors->push_back(error);
+  };
+
+  const auto copy_line = [&](const size_t &begin, const size_t &count,
+                             int8_t *row, const auto &on_invalid) {
+    if (avx2) {
+      const bool can_overread =
+          begin + ((count + 31) & ~size_t{31}) <= length;
+      copy_line_avx2(text + begin, count, can_overread, row, on_invalid);
+    } else {
+      copy_line_scalar(text + begin, count, row, on_invalid);
+    }
+  };
+
+  // The invalid bytes of a line copied before its end was confirmed
+  std::vector<AnswerSheetError> pending;
+
+  for (size_t begin = 0; begin < length; ++exam) {
+    if (exam == exams.exam_count()) {
+      throw std::runtime_error(
+          "The answer sheets have more lines than the batch has exams.");
+    }
+    int8_t *row = exams.row(exam).data();
+
+    // Lines normally have exactly `question_count` answers, so the line is
+    // copied as soon as a newline is where it is expected. The copy flags any
+    // earlier newline, which ends the line first: then it's searched for.
+    const size_t expected = begin + question_count;
+    size_t end = expected;
+    bool at_expected = true;
+    if (expected + 1 < length && text[expected] == '\r' &&
+        text[expected + 1] == '\n') {
+      end = expected + 1;
+    } else if (expected > length ||
+               (expected < length && text[expected] != '\n')) {
+      at_expected = false;
+    }
+
+    if (at_expected) {
+      bool newline_inside = false;
+      pending.clear();
+      copy_line(begin, question_count, row,
+                [&](const size_t &question, const char &byte) {
+                  if (byte == '\n') {
+                    newline_inside = true;
+                  } else {
+                    pending.push_back({exam, question, byte});
+                  }
+                });
+      if (!newline_inside) {
+        for (const auto &error : pending) {
+          report(error.question, error.byte);
+        }
+        begin = end < length ? end + 1 : length;
+        continue;
+      }
+    }
+
+    const void *newline = std::memchr(text + begin, '\n', length - begin);
+    end = newline ? static_cast<const char *>(newline) - text : length;
+    const size_t next = end < length ? end + 1 : length;
+
+    // Drop the '\r' of "\r\n"
+    const size_t line_end =
+        end > begin && text[end - 1] == '\r' ? end - 1 : end;
+    const size_t line_length = line_end - begin;
+    copy_line(begin, std::min(line_length, question_count), row, report);
+
+    if (line_length < question_count) {
+      report(line_length, line_end < length ? text[line_end] : '\n');
+      std::fill(row + line_length, row + question_count, ' ');
+    } else if (line_length > question_count) {
+      report(question_count, text[begin + question_count]);
+    }
+
+    begin = next;
+  }
+
+  return exam;
+}
+
+ExamBatch parse_answer_sheets(const char *text, const size_t &length,
+                              const size_t &question_count,
+                              std::vector<AnswerSheetError> *errors) {
+  ExamBatch exams(count_lines(text, length), question_count);
+  parse_answer_sheets(text, length, exams, errors);
+  return exams;
+}
@@ -1,87 +1,1241 @@
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "adaptive_scorer.hpp"
+#include "allocation.h"
+#include "answer_parser.h"
+#include "cpu.hpp"
 #include "exam.h"
+#include "exam_file.h"
+#include "fixed_size_scorer.hpp"
+#include "multi_select_scorer.hpp"
+#include "multi_version_scorer.hpp"
+#include "packed_scorer.hpp"
+#include "parallel_scorer.hpp"
+#include "perf_counters.h"
+#include "score_distribution.hpp"
+#include "scoring_session.hpp"
+#include "similarity_search.hpp"
+#include "simd_scorer.h"
+#include "rescorer.hpp"
 #include "scorers.hpp"
+#include "streaming_scorer.hpp"
+#include "transposed_scorer.hpp"
+#include "weighted_scorer.hpp"
+
+// The datasets of the benchmarks are generated once per shape, with fixed
+// seeds, and shared by every benchmark and iteration that uses the same
+// shape. Only the last one is kept, so that the largest ones don't pile up in
+// memory.
+namespace Fixtures {
+// The largest dataset that the size sweeps generate
+constexpr size_t kMaxDatasetBytes = size_t{3} << 30;
+
+class Cache {
+ private:
+  std::string _key;
+  std::shared_ptr<void> _value;
+
+ public:
+  template <typename T, typename Generator>
+  const T& get(const std::string& key, const Generator& generate) {
+    if (!_value || _key != key) {
+      // Free the previous dataset before generating the next one
+      _value.reset();
+      _value = std::make_shared<T>(generate());
+      _key = key;
+    }
+    return *static_cast<const T*>(_value.get());
+  }
+};
+
+inline Cache cache;
+
+inline std::string key(const char* kind, const int64_t& exam_count,
+                       const int64_t& question_count) {
+  return std::string(kind) + "/" + std::to_string(exam_count) + "/" +
+         std::to_string(question_count);
+}
+
+inline const ExamBatch& exam_batch(const int64_t& exam_count,
+                                   const int64_t& question_count) {
+  return cache.get<ExamBatch>(key("batch", exam_count, question_count), [&] {
+    return generate_exam_batch(exam_count, ByteArray(question_count), 1);
+  });
+}
+
+inline const std::vector<ByteArray>& exams(const int64_t& exam_count,
+                                           const int64_t& question_count) {
+  return cache.get<std::vector<ByteArray>>(
+      key("vector", exam_count, question_count), [&] {
+        return generate_exams(exam_count, ByteArray(question_count), 1);
+      });
+}
+
+template <typename Exams>
+const Exams& get(const int64_t& exam_count, const int64_t& question_count) {
+  if constexpr (std::is_same_v<Exams, ExamBatch>) {
+    return exam_batch(exam_count, question_count);
+  } else {
+    return exams(exam_count, question_count);
+  }
+}
+
+inline ByteArray correct_answers(const int64_t& question_count) {
+  return generate_correct_answers(question_count, 2);
+}
+
+inline ByteArray points(const int64_t& question_count) {
+  return generate_points(question_count);
+}
+
+// Flush the exams out of every cache level, to score them from memory
+inline void evict(const int8_t* data, const size_t& bytes) {
+  for (size_t offset = 0; offset < bytes; offset += 64) {
+    _mm_clflush(data + offset);
+  }
+  _mm_mfence();
+}
+
+inline void evict(const ExamBatch& exams) {
+  evict(exams.data(), exams.exam_count() * exams.pitch());
+}
+
+inline void evict(const std::vector<ByteArray>& exams) {
+  for (const auto& exam : exams) {
+    evict(exam.data(), exam.capacity());
+  }
+}
+}  // namespace Fixtures
+
+// Report the throughput in exams/s (items) and answers' GB/s (bytes)
+static void set_throughput(benchmark::State& state, const int64_t& exam_count,
+                           const int64_t& question_count) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          exam_count);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          exam_count * question_count);
+}
+
+static void set_throughput(benchmark::State& state) {
+  set_throughput(state, state.range(0), state.range(1));
+}
+
+// Set by --perf_counters: the scorer benchmarks then report the hardware
+// counters of their score() calls too
+static bool perf_counters_enabled = false;
+
+// The counters to pass to the PerfScope around the score() calls, if enabled
+static std::unique_ptr<PerfCounters> make_perf_counters() {
+  return perf_counters_enabled ? std::make_unique<PerfCounters>() : nullptr;
+}
+
+// Report the counts per exam, e.g. cycles/exam, with the instructions per
+// cycle. The events that perf_event_open refused are left out.
+static void set_perf_counters(benchmark::State& state,
+                              const PerfCounters* counters,
+                              const int64_t& exam_count) {
+  if (!counters || state.iterations() == 0) {
+    return;
+  }
+
+  const auto& counts = counters->counts();
+  const double exams = static_cast<double>(state.iterations()) * exam_count;
+  for (size_t e = 0; e < kPerfEventCount; ++e) {
+    const auto event = static_cast<PerfEvent>(e);
+    if (counts.has(event)) {
+      state.counters[std::string(perf_event_name(event)) + "/exam"] =
+          static_cast<double>(counts[event]) / exams;
+    }
+  }
+  if (counts.has(PerfEvent::kCycles) && counts.has(PerfEvent::kInstructions) &&
+      counts[PerfEvent::kCycles] != 0) {
+    state.counters["ipc"] =
+        static_cast<double>(counts[PerfEvent::kInstructions]) /
+        static_cast<double>(counts[PerfEvent::kCycles]);
+  }
+}
+
+// The exams x questions sweep, around the 64-byte blocks and with awkward
+// sizes, without the datasets larger than `max_bytes`. With `cache_modes`,
+// every size is run cold (the exams flushed from the caches before every
+// iteration) and warm (whatever fits stays cached between iterations).
+static void apply_sizes(benchmark::internal::Benchmark* benchmark,
+                        const bool& cache_modes,
+                        const size_t& max_bytes = Fixtures::kMaxDatasetBytes) {
+  for (const int64_t exam_count : {100'000, 5'000'000, 10'000'000}) {
+    for (const int64_t question_count : {1, 10, 63, 65, 100, 200, 1000, 4096}) {
+      const size_t pitch = (question_count + 63) / 64 * 64;
+      if (static_cast<size_t>(exam_count) * pitch > max_bytes) {
+        continue;
+      }
+
+      if (cache_modes) {
+        benchmark->Args({exam_count, question_count, 0});
+        benchmark->Args({exam_count, question_count, 1});
+      } else {
+        benchmark->Args({exam_count, question_count});
+      }
+    }
+  }
+
+  if (cache_modes) {
+    benchmark->ArgNames({"exams", "questions", "warm"});
+  } else {
+    benchmark->ArgNames({"exams", "questions"});
+  }
+}
+
+static void scorer_sizes(benchmark::internal::Benchmark* benchmark) {
+  apply_sizes(benchmark, true);
+}
+
+static void sizes(benchmark::internal::Benchmark* benchmark) {
+  apply_sizes(benchmark, false);
+}
+
+// Score the cached exams of the benchmark's shape with `Kernel`, cold or warm
+template <typename Kernel, typename Exams>
+static void run_scorer(benchmark::State& state) {
+  auto scorer = std::make_shared<Kernel>();
+  try {
+    scorer->ensure_cpu_support();
+  } catch (const std::runtime_error& error) {
+    state.SkipWithError(error.what());
+    return;
+  }
+
+  const auto& exams = Fixtures::get<Exams>(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  const bool warm = state.range(2);
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    if (!warm) {
+      state.PauseTiming();
+      Fixtures::evict(exams);
+      state.ResumeTiming();
+    }
+
+    const PerfScope counted(perf.get());
+    auto result = scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
 
 static void BM_NaiveScorer(benchmark::State& state) {
+  run_scorer<Scorer::NaiveScorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_NaiveScorer)->Apply(scorer_sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_BooleanMultiplicationScorer(benchmark::State& state) {
+  run_scorer<Scorer::BooleanMultiplicationScorer, std::vector<ByteArray>>(
+      state);
+}
+
+BENCHMARK(BM_BooleanMultiplicationScorer)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdSse41Scorer(benchmark::State& state) {
+  run_scorer<Scorer::SimdSse41Scorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_SimdSse41Scorer)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdScorer(benchmark::State& state) {
+  run_scorer<Scorer::SimdScorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_SimdScorer)->Apply(scorer_sizes)->Unit(benchmark::kMillisecond);
+
+static void BM_SimdScorerExamBatch(benchmark::State& state) {
+  run_scorer<Scorer::SimdScorer, ExamBatch>(state);
+}
+
+BENCHMARK(BM_SimdScorerExamBatch)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdAvx512Scorer(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512Scorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_SimdAvx512Scorer)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdAvx512ScorerExamBatch(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512Scorer, ExamBatch>(state);
+}
+
+BENCHMARK(BM_SimdAvx512ScorerExamBatch)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// Compare with BM_SimdAvx512Scorer(ExamBatch), one exam per pass
+static void BM_SimdAvx512BlockedScorer(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512BlockedScorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_SimdAvx512BlockedScorer)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdAvx512BlockedScorerExamBatch(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512BlockedScorer, ExamBatch>(state);
+}
+
+BENCHMARK(BM_SimdAvx512BlockedScorerExamBatch)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// The question counts of Scorer::FixedQuestionCounts, cold and warm
+static void fixed_sizes(benchmark::internal::Benchmark* benchmark) {
+  for (const int64_t exam_count : {100'000, 5'000'000}) {
+    for (const int64_t question_count : {10, 40, 50, 100, 200}) {
+      benchmark->Args({exam_count, question_count, 0});
+      benchmark->Args({exam_count, question_count, 1});
+    }
+  }
+  benchmark->ArgNames({"exams", "questions", "warm"});
+}
+
+// The specialized kernels against the generic ones at the same sizes
+static void BM_FixedSizeScorer(benchmark::State& state) {
+  run_scorer<Scorer::FixedSizeScorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_FixedSizeScorer)
+    ->Apply(fixed_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_FixedSizeScorerExamBatch(benchmark::State& state) {
+  run_scorer<Scorer::FixedSizeScorer, ExamBatch>(state);
+}
+
+BENCHMARK(BM_FixedSizeScorerExamBatch)
+    ->Apply(fixed_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_GenericScorerAtFixedSizes(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512BlockedScorer, std::vector<ByteArray>>(state);
+}
+
+BENCHMARK(BM_GenericScorerAtFixedSizes)
+    ->Apply(fixed_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_GenericScorerAtFixedSizesExamBatch(benchmark::State& state) {
+  run_scorer<Scorer::SimdAvx512BlockedScorer, ExamBatch>(state);
+}
+
+BENCHMARK(BM_GenericScorerAtFixedSizesExamBatch)
+    ->Apply(fixed_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SimdAvx512ScorerWithReport(benchmark::State& state) {
+  if (!Cpu::supports_avx512()) {
+    state.SkipWithError("The CPU lacks AVX512 support");
+    return;
+  }
+
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  auto simd_avx512_scorer = std::make_shared<Scorer::SimdAvx512Scorer>();
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result =
+        simd_avx512_scorer->score_with_report(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_SimdAvx512ScorerWithReport)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// The allocation options compared by the allocation benchmarks, by index
+static AllocationOptions allocation_options(const int64_t& index,
+                                            const char*& name) {
+  static constexpr const char* names[] = {
+      "default", "no_zero_fill", "huge_pages", "interleave", "first_touch"};
+  name = names[index];
+
+  AllocationOptions options;
+  options.zero_fill = index != 1;
+  options.huge_pages = index == 2;
+  options.numa = index == 3   ? NumaPlacement::kInterleave
+                 : index == 4 ? NumaPlacement::kParallelFirstTouch
+                              : NumaPlacement::kDefault;
+  return options;
+}
+
+static void allocation_sizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgsProduct({{1'000'000, 5'000'000}, {200}, {0, 1, 2, 3, 4}})
+      ->ArgNames({"exams", "questions", "alloc"});
+}
+
+// Allocate a batch and write every answer, as a loader does: the zero-fill
+// pass and the first-touch page faults are part of the time
+static void BM_AllocateExamBatch(benchmark::State& state) {
+  const char* name;
+  const auto options = allocation_options(state.range(2), name);
+  state.SetLabel(name);
+
   for (auto _ : state) {
-    state.PauseTiming();
-    auto exams = generate_exams(state.range(0), state.range(1));
-    auto correct_answers = generate_correct_answers(state.range(1));
-    auto points = generate_points(state.range(1));
-    auto naive_scorer = std::make_shared<Scorer::NaiveScorer>();
+    ExamBatch exams(state.range(0), state.range(1), options);
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      std::memset(exams.row(i).data(), 'A', exams.question_count());
+    }
+    benchmark::DoNotOptimize(exams.data());
     benchmark::ClobberMemory();
-    state.ResumeTiming();
+  }
 
-    auto result = naive_scorer->score(exams, correct_answers, points);
+  set_throughput(state);
+}
+
+BENCHMARK(BM_AllocateExamBatch)
+    ->Apply(allocation_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// Score a batch allocated with each option, warm, where the page size shows
+// up in the dTLB misses
+static void BM_ScoreAllocatedExamBatch(benchmark::State& state) {
+  const char* name;
+  const auto options = allocation_options(state.range(2), name);
+  state.SetLabel(name);
+
+  const auto scorer = Scorer::make_best_scorer();
+  ExamBatch exams(state.range(0), state.range(1), options);
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    std::memset(exams.row(i).data(), 'A' + i % 4, exams.question_count());
+  }
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = scorer->score(exams, correct_answers, points);
     benchmark::DoNotOptimize(result);
   }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
 }
 
-BENCHMARK(BM_NaiveScorer)
-    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+BENCHMARK(BM_ScoreAllocatedExamBatch)
+    ->Apply(allocation_sizes)
     ->Unit(benchmark::kMillisecond);
 
-static void BM_BooleanMultiplicationScorer(benchmark::State& state) {
+// The adaptive scorer, calibrated for the shape before the timing starts,
+// against the kernel make_best_scorer() picks for every shape
+static void BM_AdaptiveScorer(benchmark::State& state) {
+  Scorer::AdaptiveScorer scorer;
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  const bool warm = state.range(2);
+  // Calibrate, and report the winner
+  scorer.kernel(exams.exam_count(), exams.question_count());
+  state.SetLabel(
+      scorer.kernel_name(exams.exam_count(), exams.question_count()));
+
   for (auto _ : state) {
-    state.PauseTiming();
-    auto exams = generate_exams(state.range(0), state.range(1));
-    auto correct_answers = generate_correct_answers(state.range(1));
-    auto points = generate_points(state.range(1));
-    auto boolean_multiplication_scorer =
-        std::make_shared<Scorer::BooleanMultiplicationScorer>();
-    benchmark::ClobberMemory();
-    state.ResumeTiming();
+    if (!warm) {
+      state.PauseTiming();
+      Fixtures::evict(exams);
+      state.ResumeTiming();
+    }
+
+    auto result = scorer.score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+}
+
+BENCHMARK(BM_AdaptiveScorer)
+    ->Apply(scorer_sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// The cost of the bucket lookup on small batches, where it's the largest
+// share of a call: `adaptive` 1 for the adaptive scorer, 0 for the kernel
+// make_best_scorer() picks
+static void BM_AdaptiveDispatch(benchmark::State& state) {
+  std::shared_ptr<Scorer::BaseScorer> scorer = Scorer::make_best_scorer();
+  if (state.range(2)) {
+    auto adaptive = std::make_shared<Scorer::AdaptiveScorer>();
+    adaptive->kernel(state.range(0), state.range(1));
+    scorer = adaptive;
+  }
+
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  std::vector<int32_t> scores(exams.exam_count());
+
+  for (auto _ : state) {
+    scorer->score_rows(exams.data(), exams.pitch(), exams.exam_count(),
+                       correct_answers, points, scores.data());
+    benchmark::DoNotOptimize(scores.data());
+  }
+
+  set_throughput(state);
+}
+
+BENCHMARK(BM_AdaptiveDispatch)
+    ->ArgsProduct({{1, 8, 64}, {10, 100}, {0, 1}})
+    ->ArgNames({"exams", "questions", "adaptive"})
+    ->Unit(benchmark::kNanosecond);
+
+// The calibration of every bucket from scratch, i.e. the startup cost without
+// a cache file
+static void BM_AdaptiveCalibration(benchmark::State& state) {
+  for (auto _ : state) {
+    Scorer::AdaptiveScorer scorer;
+    scorer.calibrate_all();
+    benchmark::DoNotOptimize(scorer);
+  }
+}
+
+BENCHMARK(BM_AdaptiveCalibration)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// The similarity search over `sheets` exams of 100 questions, all pairs
+// (room 0) or only the pairs in the same room of `room` consecutive sheets
+static void BM_SimilaritySearch(benchmark::State& state) {
+  const int64_t sheets = state.range(0), room = state.range(1);
+  const int64_t question_count = 100;
+  const auto correct_answers = Fixtures::correct_answers(question_count);
+  const auto& exams = Fixtures::cache.get<ExamBatch>(
+      Fixtures::key("similarity", sheets, question_count),
+      [&] { return generate_exam_batch(sheets, correct_answers, 3); });
+
+  std::vector<uint32_t> groups;
+  if (room != 0) {
+    groups.resize(sheets);
+    for (int64_t i = 0; i < sheets; ++i) {
+      groups[i] = i / room;
+    }
+  }
+
+  // Random sheets share about a fifth of their answers as the same wrong
+  // answer, so only copied ones pass
+  Scorer::SimilarityOptions options;
+  options.min_matching_wrong_answers = 50;
+  Scorer::SimilaritySearch search(options);
+
+  for (auto _ : state) {
+    auto pairs = search.search(exams, correct_answers, groups);
+    benchmark::DoNotOptimize(pairs);
+  }
+
+  const int64_t group = room == 0 ? sheets : room;
+  const double pairs = static_cast<double>(sheets / group) * group *
+                       (group - 1) / 2;
+  state.counters["pairs_per_second"] = benchmark::Counter(
+      pairs * static_cast<double>(state.iterations()),
+      benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_SimilaritySearch)
+    ->Args({10'000, 0})
+    ->Args({10'000, 1000})
+    ->Args({100'000, 0})
+    ->Args({100'000, 1000})
+    ->Args({1'000'000, 1000})
+    ->ArgNames({"sheets", "room"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// The best kernel through the C ABI of the shared library, i.e. what the
+// Python bindings call (see python/benchmark_bindings.py)
+static void BM_CAbiScore(benchmark::State& state) {
+  simd_scorer* scorer = nullptr;
+  if (simd_scorer_create("best", &scorer) != SIMD_SCORER_OK) {
+    state.SkipWithError(simd_scorer_last_error());
+    return;
+  }
+
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  std::vector<int32_t> scores(exams.exam_count());
+
+  for (auto _ : state) {
+    simd_scorer_score(
+        scorer, reinterpret_cast<const uint8_t*>(exams.data()),
+        exams.exam_count(), exams.question_count(), exams.pitch(),
+        reinterpret_cast<const uint8_t*>(correct_answers.data()),
+        reinterpret_cast<const uint8_t*>(points.data()), scores.data());
+    benchmark::DoNotOptimize(scores.data());
+  }
+
+  simd_scorer_destroy(scorer);
+  set_throughput(state);
+}
 
+BENCHMARK(BM_CAbiScore)
+    ->ArgsProduct({{1, 1000, 100'000}, {10, 100, 1000}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMicrosecond);
+
+// The cached exams copied tightly packed (no padding) to an odd address, and
+// scored in place through views
+static void BM_ScoreView(benchmark::State& state) {
+  const auto scorer = Scorer::make_best_scorer();
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+
+  const size_t question_count = exams.question_count();
+  std::vector<int8_t> buffer(exams.exam_count() * question_count + 1);
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    std::memcpy(buffer.data() + 1 + i * question_count, exams.row(i).data(),
+                question_count);
+  }
+  const ExamBatchView view(buffer.data() + 1, exams.exam_count(),
+                           question_count, question_count);
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = scorer->score(view, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+// The packed copy and the padded batch are both alive
+BENCHMARK(BM_ScoreView)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      apply_sizes(benchmark, false, Fixtures::kMaxDatasetBytes / 2);
+    })
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_TransposedSimdScorer(benchmark::State& state) {
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  auto transposed_scorer = std::make_shared<Scorer::TransposedSimdScorer>();
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = transposed_scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_TransposedSimdScorer)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+
+// The same, with exams that are already stored question-major. Both copies
+// are alive while transposing, hence the smaller datasets.
+static void BM_TransposedSimdScorerPretransposed(benchmark::State& state) {
+  const auto exams =
+      transpose_exams(Fixtures::exam_batch(state.range(0), state.range(1)));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  auto transposed_scorer = std::make_shared<Scorer::TransposedSimdScorer>();
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = transposed_scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_TransposedSimdScorerPretransposed)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      apply_sizes(benchmark, false, Fixtures::kMaxDatasetBytes / 2);
+    })
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_PackedSimdScorer(benchmark::State& state) {
+  const auto exams =
+      pack_answers(Fixtures::exam_batch(state.range(0), state.range(1)));
+  const auto correct_answers =
+      pack_answers(Fixtures::correct_answers(state.range(1)));
+  const auto points = Fixtures::points(state.range(1));
+  auto packed_scorer = std::make_shared<Scorer::PackedSimdScorer>();
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = packed_scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_PackedSimdScorer)->Apply(sizes)->Unit(benchmark::kMillisecond);
+
+template <typename Point, typename WeightedScorer>
+static void BM_WeightedScorer(benchmark::State& state) {
+  if (!Cpu::supports_avx512() &&
+      std::is_same_v<WeightedScorer,
+                     Scorer::SimdAvx512WeightedScorer<Point>>) {
+    state.SkipWithError("The CPU lacks AVX512 support");
+    return;
+  }
+  auto weighted_scorer = std::make_shared<WeightedScorer>();
+
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const PointArray<Point> points(state.range(1), 1000 % 127);
+  const PointArray<Point> penalties(state.range(1), -250 % 127);
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
     auto result =
-        boolean_multiplication_scorer->score(exams, correct_answers, points);
+        weighted_scorer->score(exams, correct_answers, points, penalties);
     benchmark::DoNotOptimize(result);
   }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
 }
 
-BENCHMARK(BM_BooleanMultiplicationScorer)
-    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+BENCHMARK(BM_WeightedScorer<int8_t, Scorer::SimdWeightedScorer<int8_t>>)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WeightedScorer<int16_t, Scorer::SimdWeightedScorer<int16_t>>)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(
+    BM_WeightedScorer<int8_t, Scorer::SimdAvx512WeightedScorer<int8_t>>)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(
+    BM_WeightedScorer<int16_t, Scorer::SimdAvx512WeightedScorer<int16_t>>)
+    ->Apply(sizes)
     ->Unit(benchmark::kMillisecond);
 
-static void BM_SimdScorer(benchmark::State& state) {
+// Every third question is a "choose all that apply" one, alternately with
+// partial credit and with a penalty, so the kernels handle mixed keys. Compare
+// with BM_SimdAvx512ScorerExamBatch.
+template <typename MultiSelectScorer>
+static void BM_MultiSelectScorer(benchmark::State& state) {
+  auto multi_select_scorer = std::make_shared<MultiSelectScorer>();
+  try {
+    multi_select_scorer->ensure_cpu_support();
+  } catch (const std::runtime_error& error) {
+    state.SkipWithError(error.what());
+    return;
+  }
+
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  auto correct_answers = Fixtures::correct_answers(state.range(1));
+  std::vector<Scorer::QuestionRule> rules(state.range(1),
+                                          Scorer::QuestionRule::kExact);
+  for (size_t j = 0; j < rules.size(); j += 3) {
+    rules[j] = j % 2 ? Scorer::QuestionRule::kPartial
+                     : Scorer::QuestionRule::kPartialWithPenalty;
+    correct_answers[j] = Scorer::select_options("AC");
+  }
+  const Scorer::MultiSelectKey key(correct_answers,
+                                   Fixtures::points(state.range(1)), rules);
+
+  const auto perf = make_perf_counters();
   for (auto _ : state) {
-    state.PauseTiming();
-    auto exams = generate_exams(state.range(0), state.range(1));
-    auto correct_answers = generate_correct_answers(state.range(1));
-    auto points = generate_points(state.range(1));
-    auto simd_scorer = std::make_shared<Scorer::SimdScorer>();
-    benchmark::ClobberMemory();
-    state.ResumeTiming();
+    const PerfScope counted(perf.get());
+    auto result = multi_select_scorer->score(exams, key);
+    benchmark::DoNotOptimize(result);
+  }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_MultiSelectScorer<Scorer::SimdMultiSelectScorer>)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MultiSelectScorer<Scorer::SimdAvx512MultiSelectScorer>)
+    ->Apply(sizes)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_MultiVersionScorer(benchmark::State& state) {
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  Scorer::AnswerKeyTable keys(state.range(1));
+  for (int64_t v = 0; v < state.range(2); ++v) {
+    keys.add(generate_correct_answers(state.range(1), v),
+             Fixtures::points(state.range(1)));
+  }
+  // Shuffled variants, like a real exam room
+  std::vector<uint32_t> variants(exams.exam_count());
+  for (size_t i = 0; i < variants.size(); ++i) {
+    variants[i] = static_cast<uint32_t>(i * 2654435761U % keys.size());
+  }
+  auto multi_version_scorer = std::make_shared<Scorer::MultiVersionScorer>(
+      Scorer::make_best_scorer(), state.range(3));
 
-    auto result = simd_scorer->score(exams, correct_answers, points);
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = multi_version_scorer->score(exams, variants, keys);
     benchmark::DoNotOptimize(result);
   }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_MultiVersionScorer)
+    ->ArgsProduct({{100'000, 5'000'000}, {10, 100, 200}, {4, 16, 64}, {0, 1}})
+    ->ArgNames({"exams", "questions", "variants", "grouped"})
+    ->Unit(benchmark::kMillisecond);
+
+// A new key with `changed` questions corrected, spread over the exam
+static std::pair<ByteArray, ByteArray> corrected_key(
+    const ByteArray& correct_answers, const ByteArray& points,
+    const int64_t& changed) {
+  auto new_correct_answers = correct_answers;
+  auto new_points = points;
+  for (int64_t c = 0; c < changed; ++c) {
+    const size_t j = c * correct_answers.size() / changed;
+    new_correct_answers[j] = new_correct_answers[j] == 'A' ? 'B' : 'A';
+    new_points[j] = static_cast<int8_t>(new_points[j] ^ 1);
+  }
+  return {new_correct_answers, new_points};
 }
 
-BENCHMARK(BM_SimdScorer)
+template <typename Exams>
+static void run_rescorer(benchmark::State& state, const Exams& exams) {
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  const auto [new_correct_answers, new_points] =
+      corrected_key(correct_answers, points, state.range(2));
+  Scorer::Rescorer rescorer;
+  auto scores = std::vector<int32_t>(state.range(0));
+
+  for (auto _ : state) {
+    rescorer.rescore(exams, scores, correct_answers, points,
+                     new_correct_answers, new_points);
+    benchmark::DoNotOptimize(scores.data());
+  }
+
+  set_throughput(state);
+}
+
+// Compare with BM_SimdAvx512ScorerExamBatch, scoring again from scratch
+static void BM_Rescore(benchmark::State& state) {
+  run_rescorer(state, Fixtures::exam_batch(state.range(0), state.range(1)));
+}
+
+BENCHMARK(BM_Rescore)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {100, 200}, {1, 4, 16}})
+    ->ArgNames({"exams", "questions", "changed"})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_RescoreTransposed(benchmark::State& state) {
+  run_rescorer(state, transpose_exams(Fixtures::exam_batch(state.range(0),
+                                                          state.range(1))));
+}
+
+BENCHMARK(BM_RescoreTransposed)
+    ->ArgsProduct({{100'000, 5'000'000}, {100, 200}, {1, 4, 16}})
+    ->ArgNames({"exams", "questions", "changed"})
+    ->Unit(benchmark::kMillisecond);
+
+// The scores of the cached exams, and their bounds
+static std::pair<std::vector<int32_t>, std::pair<int32_t, int32_t>>
+generate_scores(const int64_t& exam_count, const int64_t& question_count) {
+  const auto points = Fixtures::points(question_count);
+  return {Scorer::make_best_scorer()->score(
+              Fixtures::exam_batch(exam_count, question_count),
+              Fixtures::correct_answers(question_count), points),
+          Scorer::score_bounds(points)};
+}
+
+// The baseline: rank the candidates by sorting them
+static void BM_StdSortScores(benchmark::State& state) {
+  const auto [scores, bounds] = generate_scores(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    std::vector<uint32_t> order(scores.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const uint32_t& a, const uint32_t& b) {
+                       return scores[a] > scores[b];
+                     });
+    benchmark::DoNotOptimize(order);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK(BM_StdSortScores)
     ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
     ->Unit(benchmark::kMillisecond);
 
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
-static void BM_SimdAvx512Scorer(benchmark::State& state) {
+static void BM_ScoreDistributionRanks(benchmark::State& state) {
+  const auto [scores, bounds] = generate_scores(state.range(0), state.range(1));
+  ThreadPool pool(state.range(2));
+
   for (auto _ : state) {
-    state.PauseTiming();
-    auto exams = generate_exams(state.range(0), state.range(1));
-    auto correct_answers = generate_correct_answers(state.range(1));
-    auto points = generate_points(state.range(1));
-    auto simd_avx512_scorer = std::make_shared<Scorer::SimdAvx512Scorer>();
-    benchmark::ClobberMemory();
-    state.ResumeTiming();
+    const Scorer::ScoreDistribution distribution(scores, bounds.first,
+                                                 bounds.second, &pool);
+    auto ranks = distribution.ranks(scores, &pool);
+    auto median = distribution.percentile(50);
+    benchmark::DoNotOptimize(ranks);
+    benchmark::DoNotOptimize(median);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK(BM_ScoreDistributionRanks)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000},
+                   {10, 100, 200},
+                   benchmark::CreateDenseRange(
+                       1, std::max(1U, std::thread::hardware_concurrency()),
+                       1)})
+    ->ArgNames({"exams", "questions", "threads"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ScoreDistributionTopK(benchmark::State& state) {
+  const auto [scores, bounds] = generate_scores(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    const Scorer::ScoreDistribution distribution(scores, bounds.first,
+                                                 bounds.second);
+    auto top = distribution.top_k(scores, 1000);
+    benchmark::DoNotOptimize(top);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK(BM_ScoreDistributionTopK)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ScoreDistributionStableOrder(benchmark::State& state) {
+  const auto [scores, bounds] = generate_scores(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    const Scorer::ScoreDistribution distribution(scores, bounds.first,
+                                                 bounds.second);
+    auto order = distribution.stable_order(scores);
+    benchmark::DoNotOptimize(order);
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+
+BENCHMARK(BM_ScoreDistributionStableOrder)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMillisecond);
 
-    auto result = simd_avx512_scorer->score(exams, correct_answers, points);
+static void BM_ParallelSimdScorer(benchmark::State& state) {
+  const auto& exams = Fixtures::exam_batch(state.range(0), state.range(1));
+  const auto correct_answers = Fixtures::correct_answers(state.range(1));
+  const auto points = Fixtures::points(state.range(1));
+  auto parallel_scorer = std::make_shared<Scorer::ParallelScorer>(
+      std::make_shared<Scorer::SimdScorer>(), state.range(2));
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const PerfScope counted(perf.get());
+    auto result = parallel_scorer->score(exams, correct_answers, points);
     benchmark::DoNotOptimize(result);
   }
+
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
 }
 
-BENCHMARK(BM_SimdAvx512Scorer)
+// Sweep 1..N threads to see the scaling curve
+BENCHMARK(BM_ParallelSimdScorer)
+    ->ArgsProduct({{5'000'000, 10'000'000},
+                   {10, 100, 200},
+                   benchmark::CreateDenseRange(
+                       1, std::max(1U, std::thread::hardware_concurrency()),
+                       1)})
+    ->ArgNames({"exams", "questions", "threads"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Write a batch of exams to a temporary exam file, in slices so that the
+// whole batch never has to fit in memory
+static std::string write_benchmark_exam_file(const int64_t& number_of_exams,
+                                             const int64_t& number_of_questions) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "simd_research_bench.exams")
+          .string();
+  ExamFileWriter writer(path, number_of_questions);
+  for (int64_t i = 0; i < number_of_exams; i += 100'000) {
+    writer.append(generate_exam_batch(
+        std::min<int64_t>(100'000, number_of_exams - i), number_of_questions));
+  }
+  writer.close();
+
+  return path;
+}
+
+static void BM_StreamingScorerFile(benchmark::State& state) {
+  const auto path = write_benchmark_exam_file(state.range(0), state.range(1));
+  auto correct_answers = generate_correct_answers(state.range(1));
+  auto points = generate_points(state.range(1));
+  auto streaming_scorer =
+      std::make_shared<Scorer::StreamingScorer>(Scorer::make_best_scorer());
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const ExamFile exams(path);
+    const PerfScope counted(perf.get());
+    auto result = streaming_scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  std::filesystem::remove(path);
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_StreamingScorerFile)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMillisecond);
+
+// The same file, loaded into ByteArrays before scoring
+static void BM_LoadThenScoreFile(benchmark::State& state) {
+  const auto path = write_benchmark_exam_file(state.range(0), state.range(1));
+  auto correct_answers = generate_correct_answers(state.range(1));
+  auto points = generate_points(state.range(1));
+  auto scorer = Scorer::make_best_scorer();
+
+  const auto perf = make_perf_counters();
+  for (auto _ : state) {
+    const ExamFile file(path);
+    auto exams = read_exams(file);
+    const PerfScope counted(perf.get());
+    auto result = scorer->score(exams, correct_answers, points);
+    benchmark::DoNotOptimize(result);
+  }
+
+  std::filesystem::remove(path);
+  set_throughput(state);
+  set_perf_counters(state, perf.get(), state.range(0));
+}
+
+BENCHMARK(BM_LoadThenScoreFile)
     ->ArgsProduct({{100'000, 5'000'000, 10'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMillisecond);
+
+// File to file: read a chunk of the exam file, score it, write its scores as
+// text, one stage after the other
+static void BM_ScoreFileSequential(benchmark::State& state) {
+  const auto path = write_benchmark_exam_file(state.range(0), state.range(1));
+  const auto output_path = path + ".scores";
+  auto correct_answers = generate_correct_answers(state.range(1));
+  auto points = generate_points(state.range(1));
+  auto scorer = Scorer::make_best_scorer();
+  const size_t chunk_exams = 1 << 16;
+
+  for (auto _ : state) {
+    const ExamFile exams(path);
+    FILE* output = std::fopen(output_path.c_str(), "w");
+    ExamBatch chunk(chunk_exams, exams.question_count());
+    std::vector<int32_t> scores(chunk_exams);
+
+    for (size_t first = 0; first < exams.exam_count(); first += chunk_exams) {
+      const size_t count = std::min(chunk_exams, exams.exam_count() - first);
+      std::memcpy(chunk.data(), exams.row(first), count * exams.pitch());
+      scorer->score_rows(chunk.data(), chunk.pitch(), count, correct_answers,
+                         points, scores.data());
+      for (size_t i = 0; i < count; ++i) {
+        std::fprintf(output, "%d\n", scores[i]);
+      }
+    }
+    std::fclose(output);
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(output_path);
+  set_throughput(state);
+}
+
+BENCHMARK(BM_ScoreFileSequential)
+    ->ArgsProduct({{100'000, 5'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// The same stages, overlapped by a ScoringSession
+static void BM_ScoreFileSession(benchmark::State& state) {
+  const auto path = write_benchmark_exam_file(state.range(0), state.range(1));
+  const auto output_path = path + ".scores";
+  auto correct_answers = generate_correct_answers(state.range(1));
+  auto points = generate_points(state.range(1));
+  auto scorer = Scorer::make_best_scorer();
+
+  for (auto _ : state) {
+    const ExamFile exams(path);
+    FILE* output = std::fopen(output_path.c_str(), "w");
+    Scorer::ScoringSession session(
+        scorer, correct_answers, points,
+        [&](const Scorer::ScoringChunk& chunk) {
+          for (size_t i = 0; i < chunk.exam_count; ++i) {
+            std::fprintf(output, "%d\n", chunk.scores[i]);
+          }
+        });
+
+    for (size_t first = 0; first < exams.exam_count();
+         first += session.chunk_exams()) {
+      auto& chunk = session.acquire();
+      chunk.exam_count =
+          std::min(session.chunk_exams(), exams.exam_count() - first);
+      std::memcpy(chunk.exams.data(), exams.row(first),
+                  chunk.exam_count * exams.pitch());
+      session.submit(chunk);
+    }
+    session.close();
+    std::fclose(output);
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(output_path);
+  set_throughput(state);
+}
+
+BENCHMARK(BM_ScoreFileSession)
+    ->ArgsProduct({{100'000, 5'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->UseRealTime()
     ->Unit(benchmark::kMillisecond);
-#endif
 
-BENCHMARK_MAIN();
\ No newline at end of file
+static void BM_ParseAnswerSheets(benchmark::State& state) {
+  const auto exams = generate_exam_batch(state.range(0), state.range(1));
+  std::string text;
+  text.reserve(exams.exam_count() * (exams.question_count() + 1));
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    text.append(exams.row(i).begin(), exams.row(i).end());
+    text += '\n';
+  }
+
+  // Parse into the same batch, to leave the allocation out
+  ExamBatch result(exams.exam_count(), exams.question_count());
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        parse_answer_sheets(text.data(), text.size(), result));
+    benchmark::ClobberMemory();
+  }
+
+  // The bytes are those of the text, newlines included
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(text.size()));
+}
+
+BENCHMARK(BM_ParseAnswerSheets)
+    ->ArgsProduct({{100'000, 5'000'000}, {10, 100, 200}})
+    ->ArgNames({"exams", "questions"})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_GenerateExamBatch(benchmark::State& state) {
+  const auto correct_answers = generate_correct_answers(state.range(1), 1);
+  ExamGeneratorOptions options;
+  options.thread_count = state.range(2);
+  if (state.range(3)) {
+    // A cohort of candidates with different abilities
+    options.correct_rate = 0.65;
+    options.ability_spread = 0.3;
+    options.blank_rate = 0.05;
+    options.option_weights = {1, 1.2, 1.4, 0.8};
+  }
+
+  for (auto _ : state) {
+    auto exams = generate_exam_batch(state.range(0), correct_answers, 1, options);
+    benchmark::DoNotOptimize(exams.data());
+  }
+
+  set_throughput(state);
+}
+
+BENCHMARK(BM_GenerateExamBatch)
+    ->ArgsProduct({{100'000, 5'000'000, 10'000'000},
+                   {10, 100, 200},
+                   benchmark::CreateDenseRange(
+                       1, std::max(1U, std::thread::hardware_concurrency()),
+                       1),
+                   {0, 1}})
+    ->ArgNames({"exams", "questions", "threads", "realistic"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+  // Take our own flag out before the library sees the others
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--perf_counters") {
+      perf_counters_enabled = true;
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  if (perf_counters_enabled && !PerfCounters().available()) {
+    std::fprintf(stderr,
+                 "No perf events available (see perf_event_paranoid), the "
+                 "hardware counters will be left out.\n");
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
\ No newline at end of file
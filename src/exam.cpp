@@ -1,38 +1,417 @@
 #include "exam.h"
 
+#include <algorithm>
+#include <cmath>
+#include <optional>
 #include <random>
 
-#include "pcg_random.hpp"
+#include "cpu.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// xoshiro256++ (https://prng.di.unimi.it/) in 8 independent lanes, so that
+// the AVX2 version steps 8 generators in 2 registers
+struct RandomStream {
+  static constexpr size_t kLanes = 8;
+  alignas(32) uint64_t s[4][kLanes];
+
+  static uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // The stream `stream` of `seed`, independent of all the others
+  RandomStream(const uint64_t &seed, const uint64_t &stream) {
+    uint64_t x = seed;
+    x = splitmix64(x) ^ (stream * 0xd1b54a32d192ed03ULL);
+    for (auto &state : s) {
+      for (auto &lane : state) {
+        lane = splitmix64(x);
+      }
+    }
+  }
+
+  // Fill words[0, count), `count` being a multiple of kLanes
+  void fill(uint64_t *words, const size_t &count) {
+    for (size_t w = 0; w < count; w += kLanes) {
+      for (size_t l = 0; l < kLanes; ++l) {
+        const uint64_t sum = s[0][l] + s[3][l];
+        words[w + l] = ((sum << 23) | (sum >> 41)) + s[0][l];
+
+        const uint64_t t = s[1][l] << 17;
+        s[2][l] ^= s[0][l];
+        s[3][l] ^= s[1][l];
+        s[1][l] ^= s[2][l];
+        s[0][l] ^= s[3][l];
+        s[2][l] ^= t;
+        s[3][l] = (s[3][l] << 45) | (s[3][l] >> 19);
+      }
+    }
+  }
+
+  // The same, lanes 0-3 in the first register and 4-7 in the second
+  SIMD_TARGET_AVX2
+  void fill_avx2(uint64_t *words, const size_t &count) {
+    __m256i v[4][2];
+    for (size_t k = 0; k < 4; ++k) {
+      for (size_t h = 0; h < 2; ++h) {
+        v[k][h] = _mm256_load_si256(reinterpret_cast<const __m256i *>(
+            s[k] + (h << 2)));
+      }
+    }
+
+    for (size_t w = 0; w < count; w += kLanes) {
+      for (size_t h = 0; h < 2; ++h) {
+        const __m256i sum = _mm256_add_epi64(v[0][h], v[3][h]);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(words + w + (h << 2)),
+            _mm256_add_epi64(_mm256_or_si256(_mm256_slli_epi64(sum, 23),
+                                             _mm256_srli_epi64(sum, 41)),
+                             v[0][h]));
+
+        const __m256i t = _mm256_slli_epi64(v[1][h], 17);
+        v[2][h] = _mm256_xor_si256(v[2][h], v[0][h]);
+        v[3][h] = _mm256_xor_si256(v[3][h], v[1][h]);
+        v[1][h] = _mm256_xor_si256(v[1][h], v[2][h]);
+        v[0][h] = _mm256_xor_si256(v[0][h], v[3][h]);
+        v[2][h] = _mm256_xor_si256(v[2][h], t);
+        v[3][h] = _mm256_or_si256(_mm256_slli_epi64(v[3][h], 45),
+                                  _mm256_srli_epi64(v[3][h], 19));
+      }
+    }
+
+    for (size_t k = 0; k < 4; ++k) {
+      for (size_t h = 0; h < 2; ++h) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(s[k] + (h << 2)),
+                           v[k][h]);
+      }
+    }
+  }
+};
+
+// Every block of exams has its own stream, so the blocks can be generated by
+// any thread, in any order
+constexpr size_t kBlockExams = 256;
+// The stream of the answer key, out of the exams' blocks range
+constexpr uint64_t kKeyStream = ~0ULL;
+
+size_t round_up(const size_t &value, const size_t &multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Uniform answers, 2 random bits each: the 16 random bytes of a block of 64
+// questions give the answers 0-15 from their 2 lowest bits, 16-31 from the 2
+// next ones, and so on
+void expand_uniform_answers(const uint8_t *random, const size_t &capacity,
+                            int8_t *answers) {
+  for (size_t b = 0; b < capacity; b += 64) {
+    const __m128i r =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(random + (b >> 2)));
+    for (int k = 0; k < 4; ++k) {
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(answers + b + (k << 4)),
+          _mm_add_epi8(
+              _mm_and_si128(_mm_srl_epi16(r, _mm_cvtsi32_si128(k << 1)),
+                            _mm_set1_epi8(3)),
+              _mm_set1_epi8('A')));
+    }
+  }
+}
+
+// The per-question tables of the answers generator, padded to the exams'
+// capacity. With a random byte r, a candidate whose threshold is `correct`
+// answers correctly if r < correct, leaves the question blank if
+// r < correct + blank, and otherwise picks distractor k with a second random
+// byte r2 < wrong_threshold[k][j] (k = 2 if none). The thresholds are out of
+// 256, so they need 16 bits.
+struct AnswerTables {
+  const int8_t *correct_answers;
+  std::vector<int16_t> wrong_threshold[2];
+  std::vector<int8_t> distractor[3];
+  int blank;
+  double correct_rate;
+  double ability_spread;
+
+  AnswerTables(const ByteArray &correct_answers,
+               const ExamGeneratorOptions &options)
+      : correct_answers(correct_answers.data()),
+        blank(static_cast<int>(
+            std::lround(std::clamp(options.blank_rate, 0.0, 1.0) * 256))),
+        correct_rate(options.correct_rate),
+        ability_spread(options.ability_spread) {
+    const size_t n = correct_answers.capacity();
+    for (auto &threshold : wrong_threshold) threshold.resize(n);
+    for (auto &option : distractor) option.resize(n);
+
+    for (size_t j = 0; j < correct_answers.size(); ++j) {
+      const int key = correct_answers[j] - 'A';
+      double total = 0;
+      for (int o = 0; o < 4; ++o) {
+        if (o != key) total += std::max(options.option_weights[o], 0.0);
+      }
+
+      // When only the correct answer is popular, the distractors are equally
+      // (un)popular
+      double cumulative = 0;
+      for (int o = 0, k = 0; o < 4; ++o) {
+        if (o == key) continue;
+        distractor[k][j] = static_cast<int8_t>('A' + o);
+        cumulative +=
+            total > 0 ? std::max(options.option_weights[o], 0.0) / total
+                      : 1.0 / 3;
+        if (k < 2) {
+          wrong_threshold[k][j] =
+              static_cast<int16_t>(std::lround(cumulative * 256));
+        }
+        ++k;
+      }
+    }
+  }
+
+  // The threshold of a candidate drawn with the random word `random`
+  [[nodiscard]] int correct_threshold(const uint64_t &random) const {
+    const double ability = static_cast<double>(random >> 11) * 0x1.0p-53 * 2 - 1;
+    return static_cast<int>(std::lround(
+        std::clamp(correct_rate + ability_spread * ability, 0.0, 1.0) * 256));
+  }
+};
+
+void select_answers(const AnswerTables &tables, const uint8_t *r1,
+                    const uint8_t *r2, const int &correct, const int &blank,
+                    const size_t &question_count, int8_t *answers) {
+  for (size_t j = 0; j < question_count; ++j) {
+    const int8_t wrong = r2[j] < tables.wrong_threshold[0][j]
+                             ? tables.distractor[0][j]
+                         : r2[j] < tables.wrong_threshold[1][j]
+                             ? tables.distractor[1][j]
+                             : tables.distractor[2][j];
+    answers[j] = r1[j] < correct ? tables.correct_answers[j]
+                 : r1[j] < blank ? static_cast<int8_t>(' ')
+                                 : wrong;
+  }
+}
+
+// Mark the 32 random bytes of `r` that are less than their 16-bit thresholds.
+// The bytes are widened to be compared, and the marks packed back.
+SIMD_TARGET_AVX2
+__m256i less_than(const __m256i &r, const __m256i &lo_threshold,
+                  const __m256i &hi_threshold) {
+  const __m256i lo = _mm256_cmpgt_epi16(
+      lo_threshold, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(r)));
+  const __m256i hi = _mm256_cmpgt_epi16(
+      hi_threshold, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(r, 1)));
+  return _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+}
+
+SIMD_TARGET_AVX2
+__m256i load_256(const void *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+// The same selects, 32 answers at a time
+SIMD_TARGET_AVX2
+void select_answers_avx2(const AnswerTables &tables, const uint8_t *r1,
+                         const uint8_t *r2, const int &correct,
+                         const int &blank, const size_t &capacity,
+                         int8_t *answers) {
+  const __m256i correct16 = _mm256_set1_epi16(static_cast<int16_t>(correct));
+  const __m256i blank16 =
+      _mm256_set1_epi16(static_cast<int16_t>(std::min(blank, 256)));
+
+  for (size_t j = 0; j < capacity; j += 32) {
+    const __m256i v1 = load_256(r1 + j);
+    const __m256i v2 = load_256(r2 + j);
+
+    const int16_t *threshold0 = tables.wrong_threshold[0].data() + j;
+    const int16_t *threshold1 = tables.wrong_threshold[1].data() + j;
+
+    __m256i answer = _mm256_blendv_epi8(
+        load_256(tables.distractor[2].data() + j),
+        load_256(tables.distractor[1].data() + j),
+        less_than(v2, load_256(threshold1), load_256(threshold1 + 16)));
+    answer = _mm256_blendv_epi8(
+        answer, load_256(tables.distractor[0].data() + j),
+        less_than(v2, load_256(threshold0), load_256(threshold0 + 16)));
+    answer = _mm256_blendv_epi8(answer, _mm256_set1_epi8(' '),
+                                less_than(v1, blank16, blank16));
+    answer = _mm256_blendv_epi8(answer, load_256(tables.correct_answers + j),
+                                less_than(v1, correct16, correct16));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(answers + j), answer);
+  }
+}
+
+// Generate exams [first, last) with the stream `stream`, `row(i)` being where
+// exam i goes (its whole padded capacity)
+template <typename Row>
+void generate_block(const size_t &first, const size_t &last, const Row &row,
+                    const size_t &question_count, const size_t &capacity,
+                    const uint64_t &seed, const uint64_t &stream,
+                    const AnswerTables *tables, const bool &avx2) {
+  RandomStream rng(seed, stream);
+  // Uniform answers need 2 random bits each, the others 2 random bytes, and
+  // a word for the candidate's ability
+  std::vector<uint64_t> words(round_up(
+      tables ? (capacity >> 2) + 1 : capacity >> 5, RandomStream::kLanes));
+  const auto *bytes = reinterpret_cast<const uint8_t *>(words.data());
+
+  for (size_t i = first; i < last; ++i) {
+    int8_t *answers = row(i);
+    if (avx2) {
+      rng.fill_avx2(words.data(), words.size());
+    } else {
+      rng.fill(words.data(), words.size());
+    }
+
+    if (!tables) {
+      expand_uniform_answers(bytes, capacity, answers);
+    } else {
+      const int correct = tables->correct_threshold(words[0]);
+      const uint8_t *r1 = bytes + sizeof(uint64_t);
+      if (avx2) {
+        select_answers_avx2(*tables, r1, r1 + capacity, correct,
+                            correct + tables->blank, capacity, answers);
+      } else {
+        select_answers(*tables, r1, r1 + capacity, correct,
+                       correct + tables->blank, question_count, answers);
+      }
+    }
+
+    std::fill(answers + question_count, answers + capacity, 0);
+  }
+}
+
+// Generate `count` exams in blocks of kBlockExams, spread over the threads
+template <typename Row>
+void generate_rows(const size_t &count, const Row &row,
+                   const size_t &question_count, const size_t &capacity,
+                   const uint64_t &seed, const AnswerTables *tables,
+                   const size_t &thread_count) {
+  const bool avx2 = Cpu::supports_avx2();
+  const size_t blocks = (count + kBlockExams - 1) / kBlockExams;
+  const auto generate = [&](const size_t &b) {
+    const size_t first = b * kBlockExams;
+    generate_block(first, std::min(count, first + kBlockExams), row,
+                   question_count, capacity, seed, b, tables, avx2);
+  };
+
+  if (thread_count == 1 || blocks <= 1) {
+    for (size_t b = 0; b < blocks; ++b) {
+      generate(b);
+    }
+    return;
+  }
+
+  ThreadPool pool(thread_count);
+  pool.run(blocks, generate);
+}
+
+uint64_t random_seed() {
+  std::random_device device;
+  return (static_cast<uint64_t>(device()) << 32) | device();
+}
+
+// Uniform answers are much faster to generate, and need no answer key
+bool is_uniform(const ExamGeneratorOptions &options) {
+  return options.correct_rate == 0.25 && options.ability_spread == 0 &&
+         options.blank_rate == 0 &&
+         std::all_of(options.option_weights.begin(),
+                     options.option_weights.end(),
+                     [&](const double &weight) {
+                       return weight == options.option_weights[0];
+                     });
+}
+
+void check_correct_answers(const ByteArray &correct_answers) {
+  for (const auto &answer : correct_answers) {
+    if (answer < 'A' || answer > 'D') {
+      throw std::runtime_error("The correct answers must be in 'A'..'D'.");
+    }
+  }
+}
+}  // namespace
 
 // Generate exams of MCQs with the answer in ['A', 'B', 'C', 'D']
 std::vector<ByteArray> generate_exams(const int32_t &number_of_exams,
                                       const int32_t &number_of_questions) {
-  pcg_extras::seed_seq_from<std::random_device> seed_source;
-  pcg32 rng(seed_source);
+  return generate_exams(number_of_exams, ByteArray(number_of_questions),
+                        random_seed());
+}
 
+std::vector<ByteArray> generate_exams(const int32_t &number_of_exams,
+                                      const ByteArray &correct_answers,
+                                      const uint64_t &seed,
+                                      const ExamGeneratorOptions &options) {
   // The list of exams
-  std::vector exams(number_of_exams, ByteArray(number_of_questions));
+  std::vector exams(number_of_exams, ByteArray(correct_answers.size()));
+  if (exams.empty() || correct_answers.size() == 0) {
+    return exams;
+  }
 
-  for (auto &exam : exams) {
-    for (auto &answer : exam) {
-      answer = static_cast<char>(rng(4) + 'A');
-    }
+  std::optional<AnswerTables> tables;
+  if (!is_uniform(options)) {
+    check_correct_answers(correct_answers);
+    tables.emplace(correct_answers, options);
+  }
+
+  generate_rows(
+      exams.size(),
+      [&](const size_t &i) -> int8_t * { return exams[i].data(); },
+      correct_answers.size(), correct_answers.capacity(), seed,
+      tables ? &*tables : nullptr, options.thread_count);
+
+  return exams;
+}
+
+// Same as generate_exams, but stores every exam inside a single ExamBatch
+ExamBatch generate_exam_batch(const int32_t &number_of_exams,
+                              const int32_t &number_of_questions) {
+  return generate_exam_batch(number_of_exams, ByteArray(number_of_questions),
+                             random_seed());
+}
+
+ExamBatch generate_exam_batch(const int32_t &number_of_exams,
+                              const ByteArray &correct_answers,
+                              const uint64_t &seed,
+                              const ExamGeneratorOptions &options) {
+  ExamBatch exams(number_of_exams, correct_answers.size());
+  if (exams.empty() || correct_answers.size() == 0) {
+    return exams;
+  }
+
+  std::optional<AnswerTables> tables;
+  if (!is_uniform(options)) {
+    check_correct_answers(correct_answers);
+    tables.emplace(correct_answers, options);
   }
 
+  generate_rows(
+      exams.exam_count(),
+      [&](const size_t &i) -> int8_t * { return exams.row(i).data(); },
+      exams.question_count(), exams.pitch(), seed,
+      tables ? &*tables : nullptr, options.thread_count);
+
   return exams;
 }
 
 // Generate an exam with a list of random correct answers
 ByteArray generate_correct_answers(const int32_t &number_of_questions) {
-  pcg_extras::seed_seq_from<std::random_device> seed_source;
-  pcg32 rng(seed_source);
+  return generate_correct_answers(number_of_questions, random_seed());
+}
 
+ByteArray generate_correct_answers(const int32_t &number_of_questions,
+                                   const uint64_t &seed) {
   ByteArray exam(number_of_questions);
-
-  for (auto &answer : exam) {
-    answer = static_cast<char>(rng(4) + 'A');
+  if (exam.size() == 0) {
+    return exam;
   }
 
+  generate_block(
+      0, 1, [&](const size_t &) -> int8_t * { return exam.data(); },
+      exam.size(), exam.capacity(), seed, kKeyStream, nullptr, false);
+
   return exam;
 }
 
@@ -41,3 +420,223 @@ ByteArray generate_points(const int32_t &number_of_questions) {
   ByteArray points(number_of_questions, 2);
   return points;
 }
+
+// Transpose a 16x16 tile of bytes: rows[i][offset + j] ends up in
+// out[j * out_stride + i]. Every round of byte unpacks rotates the 8 bits of
+// (register, byte) indices left by one, so 4 rounds swap the two indices.
+static void transpose_16x16(const int8_t *const rows[16], const size_t &offset,
+                            const size_t &rows_to_store, int8_t *out,
+                            const size_t &out_stride) {
+  __m128i r[16];
+  __m128i t[16];
+
+  for (size_t i = 0; i < 16; ++i) {
+    r[i] = rows[i] ? _mm_loadu_si128(
+                         reinterpret_cast<const __m128i *>(rows[i] + offset))
+                   : _mm_setzero_si128();
+  }
+
+  for (int round = 0; round < 4; ++round) {
+    for (size_t k = 0; k < 8; ++k) {
+      t[2 * k] = _mm_unpacklo_epi8(r[k], r[k + 8]);
+      t[2 * k + 1] = _mm_unpackhi_epi8(r[k], r[k + 8]);
+    }
+    std::copy(t, t + 16, r);
+  }
+
+  for (size_t j = 0; j < rows_to_store; ++j) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j * out_stride), r[j]);
+  }
+}
+
+void transpose_exam_group(const int8_t *const rows[64],
+                          const size_t &question_count, int8_t *group) {
+  for (size_t offset = 0; offset < question_count; offset += 16) {
+    const size_t questions = std::min<size_t>(16, question_count - offset);
+    for (size_t tile = 0; tile < 4; ++tile) {
+      transpose_16x16(rows + (tile << 4), offset, questions,
+                      group + (offset << 6) + (tile << 4), 64);
+    }
+  }
+}
+
+// Convert a row-major ExamBatch into the question-major layout
+TransposedExamBatch transpose_exams(const ExamBatch &exams) {
+  TransposedExamBatch transposed(exams.exam_count(), exams.question_count());
+
+  const int8_t *rows[64];
+  for (size_t g = 0; g < transposed.group_count(); ++g) {
+    for (size_t k = 0; k < 64; ++k) {
+      const size_t i = (g << 6) + k;
+      rows[k] = i < exams.exam_count() ? exams.row(i).data() : nullptr;
+    }
+    transpose_exam_group(rows, exams.question_count(), transposed.group(g));
+  }
+
+  return transposed;
+}
+
+// 32 codes (0-3) -> one 64-bit word. The codes of adjacent answers are merged
+// by multiply-adds: pairs into 4-bit values, then pairs of those into bytes,
+// and the 8 resulting bytes (one per 32-bit lane) are gathered.
+SIMD_TARGET_AVX2
+static uint64_t pack_codes_avx2(__m256i v) {
+  const __m256i gather = _mm256_setr_epi8(
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  //
+      0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+  v = _mm256_maddubs_epi16(v, _mm256_set1_epi16(0x0401));
+  v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00100001));
+  v = _mm256_shuffle_epi8(v, gather);
+  v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm256_castsi256_si128(v)));
+}
+
+// The 2-bit code of an answer, and 3 in `valid` if it's in 'A'..'D'
+static uint64_t pack_code(const int8_t &answer, uint64_t &valid) {
+  const auto code = static_cast<uint8_t>(answer - 'A');
+  valid = code < 4 ? 3 : 0;
+  return code & 3;
+}
+
+SIMD_TARGET_AVX2
+static bool pack_answers_avx2(const int8_t *answers, const size_t &count,
+                              uint64_t *words, uint64_t *valid) {
+  bool all_valid = true;
+
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    const __m256i codes = _mm256_sub_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(answers + i)),
+        _mm256_set1_epi8('A'));
+    // 0xff for the codes in 0-3 (unsigned)
+    const __m256i in_range = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(codes, _mm256_set1_epi8(3)), codes);
+    all_valid &= _mm256_movemask_epi8(in_range) == -1;
+
+    words[i >> 5] =
+        pack_codes_avx2(_mm256_and_si256(codes, _mm256_set1_epi8(3)));
+    if (valid) {
+      valid[i >> 5] =
+          pack_codes_avx2(_mm256_and_si256(in_range, _mm256_set1_epi8(3)));
+    }
+  }
+
+  if (i < count) {
+    uint64_t word = 0, valid_word = 0;
+    for (size_t k = 0; i + k < count; ++k) {
+      uint64_t answer_valid;
+      word |= pack_code(answers[i + k], answer_valid) << (k << 1);
+      valid_word |= answer_valid << (k << 1);
+    }
+    words[i >> 5] = word;
+    if (valid) {
+      valid[i >> 5] = valid_word;
+    }
+    all_valid &= valid_word == (1ULL << ((count - i) << 1)) - 1;
+  }
+
+  return all_valid;
+}
+
+// One 64-bit word -> 32 answers. Every byte picks the byte of the word that
+// holds its code, then tests the two bits of its code.
+SIMD_TARGET_AVX2
+static void unpack_answers_avx2(const uint64_t *words, const size_t &count,
+                                int8_t *answers) {
+  const __m256i spread = _mm256_setr_epi8(
+      0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,  //
+      4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+  const __m256i bit0 = _mm256_set1_epi32(0x40100401);
+  const __m256i bit1 = _mm256_add_epi8(bit0, bit0);
+
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    const __m256i v = _mm256_shuffle_epi8(
+        _mm256_set1_epi64x(static_cast<int64_t>(words[i >> 5])), spread);
+    const __m256i lo = _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_and_si256(v, bit0), bit0),
+        _mm256_set1_epi8(1));
+    const __m256i hi = _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_and_si256(v, bit1), bit1),
+        _mm256_set1_epi8(2));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(answers + i),
+        _mm256_add_epi8(_mm256_or_si256(lo, hi), _mm256_set1_epi8('A')));
+  }
+
+  for (; i < count; ++i) {
+    answers[i] = static_cast<int8_t>(
+        'A' + ((words[i >> 5] >> ((i & 31) << 1)) & 3));
+  }
+}
+
+bool pack_answers(const int8_t *answers, const size_t &count, uint64_t *words,
+                  uint64_t *valid) {
+  if (Cpu::supports_avx2()) {
+    return pack_answers_avx2(answers, count, words, valid);
+  }
+
+  for (size_t w = 0; w < ((count + 31) >> 5); ++w) {
+    words[w] = 0;
+    if (valid) {
+      valid[w] = 0;
+    }
+  }
+
+  bool all_valid = true;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t answer_valid;
+    words[i >> 5] |= pack_code(answers[i], answer_valid) << ((i & 31) << 1);
+    if (valid) {
+      valid[i >> 5] |= answer_valid << ((i & 31) << 1);
+    }
+    all_valid &= answer_valid != 0;
+  }
+  return all_valid;
+}
+
+void unpack_answers(const uint64_t *words, const size_t &count,
+                    int8_t *answers) {
+  if (Cpu::supports_avx2()) {
+    unpack_answers_avx2(words, count, answers);
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    answers[i] = static_cast<int8_t>(
+        'A' + ((words[i >> 5] >> ((i & 31) << 1)) & 3));
+  }
+}
+
+PackedAnswers pack_answers(const ExamBatch &exams) {
+  PackedAnswers packed(exams.exam_count(), exams.question_count());
+
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    if (!pack_answers(exams.row(i).data(), exams.question_count(),
+                      packed.row(i))) {
+      throw std::runtime_error("Only answers in 'A'..'D' can be packed.");
+    }
+  }
+
+  return packed;
+}
+
+PackedAnswers pack_answers(const ByteArray &answers) {
+  PackedAnswers packed(1, answers.size());
+  if (!pack_answers(answers.data(), answers.size(), packed.row(0))) {
+    throw std::runtime_error("Only answers in 'A'..'D' can be packed.");
+  }
+  return packed;
+}
+
+ExamBatch unpack_answers(const PackedAnswers &exams) {
+  ExamBatch unpacked(exams.exam_count(), exams.question_count());
+
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    unpack_answers(exams.row(i), exams.question_count(),
+                   unpacked.row(i).data());
+  }
+
+  return unpacked;
+}
@@ -0,0 +1,223 @@
+#include "exam_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+static size_t row_pitch(const size_t &question_count) {
+  return ((question_count >> 6) + ((question_count & 63) != 0)) << 6;
+}
+
+ExamFileWriter::ExamFileWriter(const std::string &path,
+                               const size_t &question_count)
+    : _file(std::fopen(path.c_str(), "wb")),
+      _question_count(question_count),
+      _exam_count(0),
+      _pitch(row_pitch(question_count)) {
+  if (!_file) {
+    throw std::runtime_error("Failed to open exam file " + path +
+                             " for writing");
+  }
+  // A placeholder until the exam count is known
+  write_header();
+}
+
+void ExamFileWriter::write_header() {
+  ExamFileHeader header{};
+  std::copy(std::begin(kExamFileMagic), std::end(kExamFileMagic),
+            header.magic);
+  header.version = kExamFileVersion;
+  header.header_size = sizeof(ExamFileHeader);
+  header.question_count = _question_count;
+  header.exam_count = _exam_count;
+  header.pitch = _pitch;
+
+  if (std::fseek(_file, 0, SEEK_SET) != 0 ||
+      std::fwrite(&header, sizeof(header), 1, _file) != 1 ||
+      std::fseek(_file, 0, SEEK_END) != 0) {
+    throw std::runtime_error("Failed to write the exam file header");
+  }
+}
+
+void ExamFileWriter::append(const int8_t *answers) {
+  static constexpr int8_t padding[64] = {};
+
+  if (std::fwrite(answers, 1, _question_count, _file) != _question_count ||
+      std::fwrite(padding, 1, _pitch - _question_count, _file) !=
+          _pitch - _question_count) {
+    throw std::runtime_error("Failed to write an exam to the exam file");
+  }
+  ++_exam_count;
+}
+
+void ExamFileWriter::append(const ExamBatch &exams) {
+  if (exams.question_count() != _question_count) {
+    throw std::runtime_error(
+        "The size of exams' questions and the exam file's questions must be "
+        "the same.");
+  }
+
+  // ExamBatch rows are already padded the same way as the file's rows
+  if (!exams.empty() &&
+      std::fwrite(exams.data(), exams.pitch(), exams.exam_count(), _file) !=
+          exams.exam_count()) {
+    throw std::runtime_error("Failed to write exams to the exam file");
+  }
+  _exam_count += exams.exam_count();
+}
+
+void ExamFileWriter::close() {
+  if (!_file) {
+    return;
+  }
+
+  write_header();
+  const bool failed = std::fclose(_file) != 0;
+  _file = nullptr;
+  if (failed) {
+    throw std::runtime_error("Failed to close the exam file");
+  }
+}
+
+ExamFileWriter::~ExamFileWriter() {
+  try {
+    close();
+  } catch (...) {
+    // Destructors can't throw, call close() to see the error
+  }
+}
+
+ExamFile::ExamFile(const std::string &path)
+    : _mapping(nullptr),
+      _mapping_size(0),
+      _question_count(0),
+      _exam_count(0),
+      _pitch(0) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open exam file " + path);
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(ExamFileHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Exam file " + path + " is too small");
+  }
+
+  _mapping_size = st.st_size;
+  void *mapping =
+      ::mmap(nullptr, _mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Failed to map exam file " + path);
+  }
+  _mapping = static_cast<int8_t *>(mapping);
+
+  const auto *header = reinterpret_cast<const ExamFileHeader *>(_mapping);
+  const char *error = nullptr;
+  if (!std::equal(std::begin(kExamFileMagic), std::end(kExamFileMagic),
+                  header->magic)) {
+    error = " is not an exam file";
+  } else if (header->version != kExamFileVersion) {
+    error = " has an unsupported version";
+  } else if (header->header_size != sizeof(ExamFileHeader) ||
+             header->pitch != row_pitch(header->question_count) ||
+             (_mapping_size - sizeof(ExamFileHeader)) / std::max<uint64_t>(
+                                                           header->pitch, 1) <
+                 header->exam_count) {
+    error = " is corrupted";
+  }
+
+  if (error) {
+    ::munmap(_mapping, _mapping_size);
+    throw std::runtime_error("Exam file " + path + error);
+  }
+
+  _question_count = header->question_count;
+  _exam_count = header->exam_count;
+  _pitch = header->pitch;
+}
+
+ExamFile::ExamFile(ExamFile &&other) noexcept
+    : _mapping(other._mapping),
+      _mapping_size(other._mapping_size),
+      _question_count(other._question_count),
+      _exam_count(other._exam_count),
+      _pitch(other._pitch) {
+  other._mapping = nullptr;
+  other._mapping_size = 0;
+  other._question_count = 0;
+  other._exam_count = 0;
+  other._pitch = 0;
+}
+
+ExamFile &ExamFile::operator=(ExamFile &&other) noexcept {
+  if (this != &other) {
+    if (_mapping) {
+      ::munmap(_mapping, _mapping_size);
+    }
+    _mapping = other._mapping;
+    _mapping_size = other._mapping_size;
+    _question_count = other._question_count;
+    _exam_count = other._exam_count;
+    _pitch = other._pitch;
+    other._mapping = nullptr;
+    other._mapping_size = 0;
+    other._question_count = 0;
+    other._exam_count = 0;
+    other._pitch = 0;
+  }
+  return *this;
+}
+
+void ExamFile::advise(const size_t &first, const size_t &last,
+                      const int &advice) const {
+  // madvise wants a page-aligned address, so the range is widened to the
+  // pages that are entirely inside it (MADV_DONTNEED must never drop a page
+  // that still holds rows outside of it)
+  static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+
+  const size_t begin = sizeof(ExamFileHeader) + first * _pitch;
+  const size_t end = sizeof(ExamFileHeader) + last * _pitch;
+  const size_t aligned_begin =
+      advice == MADV_DONTNEED ? (begin + page_size - 1) / page_size * page_size
+                              : begin / page_size * page_size;
+  const size_t aligned_end = advice == MADV_DONTNEED
+                                 ? end / page_size * page_size
+                                 : std::min(end, _mapping_size);
+
+  if (aligned_end > aligned_begin) {
+    // It is only a hint, so failures are ignored
+    ::madvise(_mapping + aligned_begin, aligned_end - aligned_begin, advice);
+  }
+}
+
+ExamFile::~ExamFile() {
+  if (_mapping) {
+    ::munmap(_mapping, _mapping_size);
+  }
+}
+
+void write_exam_file(const std::string &path, const ExamBatch &exams) {
+  ExamFileWriter writer(path, exams.question_count());
+  writer.append(exams);
+  writer.close();
+}
+
+std::vector<ByteArray> read_exams(const ExamFile &file) {
+  std::vector<ByteArray> exams;
+  exams.reserve(file.exam_count());
+
+  for (size_t i = 0; i < file.exam_count(); ++i) {
+    exams.emplace_back(file.question_count());
+    std::memcpy(exams.back().data(), file.row(i), file.question_count());
+  }
+
+  return exams;
+}
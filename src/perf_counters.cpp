@@ -0,0 +1,141 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+const char *perf_event_name(const PerfEvent &event) {
+  static constexpr const char *names[kPerfEventCount] = {
+      "cycles",     "instructions", "l1d_misses",
+      "llc_misses", "dtlb_misses",  "branch_misses",
+  };
+  return names[static_cast<size_t>(event)];
+}
+
+#ifdef __linux__
+// Set the perf_event_attr type and config of `event`
+static void describe(const PerfEvent &event, perf_event_attr &attr) {
+  constexpr auto cache_read_misses = [](const uint64_t &cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  };
+
+  attr.type = PERF_TYPE_HARDWARE;
+  switch (event) {
+    case PerfEvent::kCycles:
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PerfEvent::kInstructions:
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PerfEvent::kL1dMisses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache_read_misses(PERF_COUNT_HW_CACHE_L1D);
+      break;
+    case PerfEvent::kLlcMisses:
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PerfEvent::kDtlbMisses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache_read_misses(PERF_COUNT_HW_CACHE_DTLB);
+      break;
+    case PerfEvent::kBranchMisses:
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+  }
+}
+
+static int open_event(const PerfEvent &event) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  describe(event, attr);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return static_cast<int>(
+      ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+PerfCounters::PerfCounters() {
+  _fds.fill(-1);
+#ifdef __linux__
+  for (size_t e = 0; e < kPerfEventCount; ++e) {
+    _fds[e] = open_event(static_cast<PerfEvent>(e));
+    _counts.available[e] = _fds[e] >= 0;
+  }
+#endif
+}
+
+bool PerfCounters::available() const {
+  for (const auto &fd : _fds) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  if (_running) {
+    return;
+  }
+  for (const auto &fd : _fds) {
+    if (fd >= 0) {
+      ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  _running = true;
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+  if (!_running) {
+    return;
+  }
+  for (const auto &fd : _fds) {
+    if (fd >= 0) {
+      ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+  _running = false;
+
+  for (size_t e = 0; e < kPerfEventCount; ++e) {
+    // The value, the time enabled and the time running
+    uint64_t values[3];
+    if (_fds[e] < 0 || ::read(_fds[e], values, sizeof(values)) !=
+                           static_cast<ssize_t>(sizeof(values))) {
+      continue;
+    }
+    if (values[2] != 0 && values[2] < values[1]) {
+      // The event was multiplexed, extrapolate to the whole time enabled
+      values[0] = static_cast<uint64_t>(static_cast<double>(values[0]) *
+                                        static_cast<double>(values[1]) /
+                                        static_cast<double>(values[2]));
+    }
+    _counts.values[e] += values[0];
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const auto &fd : _fds) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+#endif
+}
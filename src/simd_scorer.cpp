@@ -0,0 +1,118 @@
+#include "simd_scorer.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "parallel_scorer.hpp"
+#include "scorers.hpp"
+
+struct simd_scorer {
+  std::shared_ptr<Scorer::BaseScorer> kernel;
+};
+
+static thread_local std::string last_error;
+
+static simd_scorer_status fail(const simd_scorer_status &status,
+                               const char *message) {
+  last_error = message;
+  return status;
+}
+
+static std::shared_ptr<Scorer::BaseScorer> make_kernel(const char *name) {
+  if (!name || std::strcmp(name, "best") == 0) {
+    return Scorer::make_best_scorer();
+  }
+  if (std::strcmp(name, "parallel") == 0) {
+    return std::make_shared<Scorer::ParallelScorer>(Scorer::make_best_scorer());
+  }
+  if (std::strcmp(name, "naive") == 0) {
+    return std::make_shared<Scorer::NaiveScorer>();
+  }
+  if (std::strcmp(name, "sse41") == 0) {
+    return std::make_shared<Scorer::SimdSse41Scorer>();
+  }
+  if (std::strcmp(name, "avx2") == 0) {
+    return std::make_shared<Scorer::SimdScorer>();
+  }
+  if (std::strcmp(name, "avx512") == 0) {
+    return std::make_shared<Scorer::SimdAvx512BlockedScorer>();
+  }
+  return nullptr;
+}
+
+int32_t simd_scorer_abi_version(void) { return SIMD_SCORER_ABI_VERSION; }
+
+simd_scorer_status simd_scorer_create(const char *kernel,
+                                      simd_scorer **scorer) {
+  if (!scorer) {
+    return fail(SIMD_SCORER_INVALID_ARGUMENT, "The scorer pointer is null.");
+  }
+  *scorer = nullptr;
+
+  try {
+    auto created = make_kernel(kernel);
+    if (!created) {
+      return fail(SIMD_SCORER_INVALID_ARGUMENT,
+                  ("Unknown kernel " + std::string(kernel)).c_str());
+    }
+
+    try {
+      created->ensure_cpu_support();
+    } catch (const std::runtime_error &error) {
+      return fail(SIMD_SCORER_UNSUPPORTED_CPU, error.what());
+    }
+
+    *scorer = new simd_scorer{std::move(created)};
+  } catch (const std::exception &error) {
+    return fail(SIMD_SCORER_INTERNAL_ERROR, error.what());
+  }
+
+  last_error.clear();
+  return SIMD_SCORER_OK;
+}
+
+void simd_scorer_destroy(simd_scorer *scorer) { delete scorer; }
+
+simd_scorer_status simd_scorer_score(simd_scorer *scorer, const uint8_t *exams,
+                                     size_t exam_count, size_t question_count,
+                                     size_t exam_stride,
+                                     const uint8_t *correct_answers,
+                                     const uint8_t *points, int32_t *scores) {
+  if (!scorer || !correct_answers || !points ||
+      (exam_count != 0 && (!exams || !scores))) {
+    return fail(SIMD_SCORER_INVALID_ARGUMENT, "A buffer pointer is null.");
+  }
+  if (exam_count > 1 && exam_stride < question_count) {
+    return fail(SIMD_SCORER_INVALID_ARGUMENT,
+                "The exams overlap: the stride is less than the question "
+                "count.");
+  }
+  for (size_t j = 0; j < question_count; ++j) {
+    if (points[j] > 127) {
+      return fail(SIMD_SCORER_INVALID_ARGUMENT,
+                  "A point is above 127, the kernels would disagree on it.");
+    }
+  }
+
+  try {
+    const ExamBatchView view(reinterpret_cast<const int8_t *>(exams),
+                             exam_count, question_count, exam_stride);
+    const ByteArrayView key(reinterpret_cast<const int8_t *>(correct_answers),
+                            question_count);
+    const ByteArrayView weights(reinterpret_cast<const int8_t *>(points),
+                                question_count);
+    if (exam_count != 0) {
+      scorer->kernel->score_view(view, key, weights, scores);
+    }
+  } catch (const std::exception &error) {
+    return fail(SIMD_SCORER_INTERNAL_ERROR, error.what());
+  }
+
+  last_error.clear();
+  return SIMD_SCORER_OK;
+}
+
+const char *simd_scorer_last_error(void) { return last_error.c_str(); }
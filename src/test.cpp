@@ -1,12 +1,41 @@
 #include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <random>
+
+#include "adaptive_scorer.hpp"
+#include "answer_parser.h"
 #include "exam.h"
+#include "exam_file.h"
+#include "fixed_size_scorer.hpp"
+#include "instrumented_scorer.hpp"
+#include "multi_select_scorer.hpp"
+#include "multi_version_scorer.hpp"
+#include "packed_scorer.hpp"
+#include "parallel_scorer.hpp"
+#include "perf_counters.h"
+#include "score_distribution.hpp"
+#include "scoring_session.hpp"
+#include "similarity_search.hpp"
+#include "simd_scorer.h"
+#include "rescorer.hpp"
 #include "scorers.hpp"
+#include "streaming_scorer.hpp"
+#include "transposed_scorer.hpp"
+#include "weighted_scorer.hpp"
 
 class ScorerTestFixture : public testing::Test {
  protected:
   std::shared_ptr<Scorer::BaseScorer> naive_scorer;
   std::shared_ptr<Scorer::BaseScorer> boolean_multiplication_scorer;
+  std::shared_ptr<Scorer::BaseScorer> simd_sse41_scorer;
   std::shared_ptr<Scorer::BaseScorer> simd_scorer;
   std::shared_ptr<Scorer::BaseScorer> simd_avx512_scorer;
 
@@ -16,16 +45,15 @@ class ScorerTestFixture : public testing::Test {
   std::vector<ByteArray> exams;
   ByteArray correct_answers;
   ByteArray points;
+  ExamBatch exam_batch;
 
   void SetUp() override {
     naive_scorer = std::make_shared<Scorer::NaiveScorer>();
     boolean_multiplication_scorer =
         std::make_shared<Scorer::BooleanMultiplicationScorer>();
     simd_scorer = std::make_shared<Scorer::SimdScorer>();
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
+    simd_sse41_scorer = std::make_shared<Scorer::SimdSse41Scorer>();
     simd_avx512_scorer = std::make_shared<Scorer::SimdAvx512Scorer>();
-#endif
 
     exams_size_mismatch = std::vector(1, ByteArray(2, 'B'));
     correct_answers_size_mismatch = {'A'};
@@ -54,6 +82,11 @@ class ScorerTestFixture : public testing::Test {
         'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
     };
     points = ByteArray(64, 2);
+
+    exam_batch = ExamBatch(exams.size(), correct_answers.size());
+    for (size_t i = 0; i < exams.size(); ++i) {
+      std::copy(exams[i].begin(), exams[i].end(), exam_batch.row(i).begin());
+    }
   }
 };
 
@@ -70,13 +103,15 @@ TEST_F(ScorerTestFixture, HandleVectorSizeMismatch) {
       simd_scorer->score(exams_size_mismatch, correct_answers_size_mismatch,
                          points_size_mismatch),
       std::runtime_error);
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
+  EXPECT_THROW(simd_sse41_scorer->score(exams_size_mismatch,
+                                        correct_answers_size_mismatch,
+                                        points_size_mismatch),
+               std::runtime_error);
+  // Also thrown when the CPU lacks AVX512
   EXPECT_THROW(simd_avx512_scorer->score(exams_size_mismatch,
                                          correct_answers_size_mismatch,
                                          points_size_mismatch),
                std::runtime_error);
-#endif
 }
 
 TEST_F(ScorerTestFixture, ScorerWorks) {
@@ -86,9 +121,1536 @@ TEST_F(ScorerTestFixture, ScorerWorks) {
   EXPECT_EQ(
       boolean_multiplication_scorer->score(exams, correct_answers, points),
       simd_scorer->score(exams, correct_answers, points));
-#if defined(__AVX512BW__) && defined(__AVX512VL__) && defined(__AVX512F__) && \
-    defined(__AVX512DQ__)
   EXPECT_EQ(simd_scorer->score(exams, correct_answers, points),
-            simd_avx512_scorer->score(exams, correct_answers, points));
+            simd_sse41_scorer->score(exams, correct_answers, points));
+  if (Cpu::supports_avx512()) {
+    EXPECT_EQ(simd_scorer->score(exams, correct_answers, points),
+              simd_avx512_scorer->score(exams, correct_answers, points));
+  }
+}
+
+TEST_F(ScorerTestFixture, ExamBatchScorerWorks) {
+  const auto expected = naive_scorer->score(exams, correct_answers, points);
+
+  EXPECT_EQ(naive_scorer->score(exam_batch, correct_answers, points), expected);
+  EXPECT_EQ(
+      boolean_multiplication_scorer->score(exam_batch, correct_answers, points),
+      expected);
+  EXPECT_EQ(simd_sse41_scorer->score(exam_batch, correct_answers, points),
+            expected);
+  EXPECT_EQ(simd_scorer->score(exam_batch, correct_answers, points), expected);
+  if (Cpu::supports_avx512()) {
+    EXPECT_EQ(simd_avx512_scorer->score(exam_batch, correct_answers, points),
+              expected);
+  }
+
+  EXPECT_THROW(
+      simd_scorer->score(exam_batch, correct_answers_size_mismatch,
+                         correct_answers_size_mismatch),
+      std::runtime_error);
+}
+
+TEST(ExamBatchTest, RowsArePaddedAndAligned) {
+  const ExamBatch batch(3, 65, 'C');
+
+  EXPECT_EQ(batch.exam_count(), 3);
+  EXPECT_EQ(batch.question_count(), 65);
+  EXPECT_EQ(batch.pitch(), 128);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(batch.data()) % 64, 0);
+
+  for (size_t i = 0; i < batch.exam_count(); ++i) {
+    const auto row = batch.row(i);
+    EXPECT_EQ(row.data(), batch.data() + i * batch.pitch());
+    EXPECT_TRUE(std::all_of(row.begin(), row.end(),
+                            [](const int8_t &c) { return c == 'C'; }));
+    EXPECT_TRUE(std::all_of(row.end(), row.data() + batch.pitch(),
+                            [](const int8_t &c) { return c == 0; }));
+  }
+}
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+  ThreadPool pool(3);
+  std::vector<std::atomic<int32_t>> runs(1000);
+
+  pool.run(runs.size(), [&](const size_t &i) { ++runs[i]; });
+  pool.run(runs.size(), [&](const size_t &i) { ++runs[i]; });
+
+  for (const auto &r : runs) {
+    EXPECT_EQ(r, 2);
+  }
+  EXPECT_THROW(pool.run(10, [](const size_t &) { throw std::runtime_error(""); }),
+               std::runtime_error);
+}
+
+// Score the rows of `batch` through score_row_pointers, in reverse order so
+// that they aren't evenly spaced, and return the scores in the batch's order
+static std::vector<int32_t> score_reversed_rows(
+    Scorer::BaseScorer &scorer, const ExamBatch &batch,
+    const ByteArray &correct_answers, const ByteArray &points) {
+  std::vector<const int8_t *> rows(batch.exam_count());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    rows[i] = batch.row(rows.size() - 1 - i).data();
+  }
+
+  std::vector<int32_t> scores(rows.size());
+  scorer.score_row_pointers(rows.data(), rows.size(), correct_answers, points,
+                            scores.data());
+  std::reverse(scores.begin(), scores.end());
+  return scores;
+}
+
+TEST(ParallelScorerTest, MatchesSerialScorer) {
+  const auto exams = generate_exams(1001, 77);
+  const auto exam_batch = generate_exam_batch(1001, 77);
+  const auto correct_answers = generate_correct_answers(77);
+  const auto points = generate_points(77);
+
+  const auto kernel = std::make_shared<Scorer::SimdScorer>();
+  const auto expected = kernel->score(exams, correct_answers, points);
+  const auto expected_batch = kernel->score(exam_batch, correct_answers, points);
+
+  for (const size_t threads : {1, 3}) {
+    for (const size_t chunk : {0, 1, 7, 5000}) {
+      Scorer::ParallelScorer parallel_scorer(kernel, threads, chunk);
+      EXPECT_EQ(parallel_scorer.score(exams, correct_answers, points),
+                expected);
+      EXPECT_EQ(parallel_scorer.score(exam_batch, correct_answers, points),
+                expected_batch);
+      EXPECT_EQ(score_reversed_rows(parallel_scorer, exam_batch,
+                                    correct_answers, points),
+                expected_batch);
+    }
+  }
+
+  // Pinned workers (more than this machine may have CPUs) score the same
+  Scorer::ParallelScorer pinned_scorer(kernel, 3, 0, true);
+  EXPECT_EQ(pinned_scorer.score(exam_batch, correct_answers, points),
+            expected_batch);
+
+  // Errors raised by the kernel inside the pool reach the caller
+  Scorer::ParallelScorer parallel_scorer(kernel, 2);
+  EXPECT_THROW(parallel_scorer.score(exams, generate_correct_answers(76),
+                                     generate_points(76)),
+               std::runtime_error);
+}
+
+// Records the number of exams of every score_rows call, e.g. the chunks of a
+// ParallelScorer
+class ChunkRecordingScorer final : public Scorer::BaseScorer {
+ public:
+  std::mutex mutex;
+  std::vector<size_t> counts;
+
+  void score_range(const std::vector<ByteArray> &exams, const size_t &first,
+                   const size_t &last, const ByteArray &correct_answers,
+                   const ByteArray &points, int32_t *out) override {
+    Scorer::NaiveScorer().score_range(exams, first, last, correct_answers,
+                                      points, out);
+  }
+
+  void score_rows(const int8_t *rows, const size_t &pitch, const size_t &count,
+                  const ByteArray &correct_answers, const ByteArray &points,
+                  int32_t *out) override {
+    {
+      std::lock_guard lock(mutex);
+      counts.push_back(count);
+    }
+    Scorer::NaiveScorer().score_rows(rows, pitch, count, correct_answers,
+                                     points, out);
+  }
+};
+
+TEST(ParallelScorerTest, ChunksNeverShareAnOutputCacheLine) {
+  const auto exam_batch = generate_exam_batch(1001, 77);
+  const auto correct_answers = generate_correct_answers(77);
+  const auto points = generate_points(77);
+
+  // Given chunk sizes are rounded up to 16 exams (64 bytes of scores) too
+  for (const size_t chunk : {0, 1, 10, 16, 40}) {
+    const auto kernel = std::make_shared<ChunkRecordingScorer>();
+    Scorer::ParallelScorer parallel_scorer(kernel, 3, chunk);
+    parallel_scorer.score(exam_batch, correct_answers, points);
+
+    std::sort(kernel->counts.begin(), kernel->counts.end());
+    EXPECT_EQ(std::accumulate(kernel->counts.begin(), kernel->counts.end(),
+                              size_t{0}),
+              1001);
+    // Only the last chunk may be partial
+    for (size_t c = 1; c < kernel->counts.size(); ++c) {
+      EXPECT_EQ(kernel->counts[c] % 16, 0) << chunk;
+    }
+  }
+}
+
+TEST(ScorerTest, MakeBestScorerMatchesNaiveScorer) {
+  const auto exams = generate_exams(100, 130);
+  const auto correct_answers = generate_correct_answers(130);
+  const auto points = generate_points(130);
+
+  EXPECT_EQ(Scorer::make_best_scorer()->score(exams, correct_answers, points),
+            Scorer::NaiveScorer().score(exams, correct_answers, points));
+}
+
+TEST(TransposedExamBatchTest, TransposeMatchesRowMajor) {
+  for (const size_t questions : {1, 10, 16, 17, 64, 100}) {
+    const auto batch = generate_exam_batch(130, questions);
+    const auto transposed = transpose_exams(batch);
+
+    ASSERT_EQ(transposed.group_count(), 3);
+    for (size_t i = 0; i < 192; ++i) {
+      for (size_t j = 0; j < questions; ++j) {
+        EXPECT_EQ(transposed.at(i, j), i < 130 ? batch.row(i)[j] : 0);
+      }
+    }
+  }
+}
+
+TEST(TransposedSimdScorerTest, MatchesNaiveScorer) {
+  if (!Cpu::supports_avx2()) {
+    GTEST_SKIP() << "The CPU lacks AVX2 support";
+  }
+
+  Scorer::NaiveScorer naive_scorer;
+  // Transpose every batch, even the long ones that overflow 16-bit sums
+  Scorer::TransposedSimdScorer transposed_scorer(1000);
+
+  for (const size_t questions : {1, 10, 33, 64, 300}) {
+    const auto exams = generate_exams(150, questions);
+    const auto exam_batch = generate_exam_batch(150, questions);
+    const auto correct_answers = generate_correct_answers(questions);
+    const auto points = ByteArray(questions, 127);
+
+    EXPECT_EQ(transposed_scorer.score(exams, correct_answers, points),
+              naive_scorer.score(exams, correct_answers, points));
+    EXPECT_EQ(transposed_scorer.score(exam_batch, correct_answers, points),
+              naive_scorer.score(exam_batch, correct_answers, points));
+    EXPECT_EQ(transposed_scorer.score(transpose_exams(exam_batch),
+                                      correct_answers, points),
+              naive_scorer.score(exam_batch, correct_answers, points));
+    EXPECT_EQ(score_reversed_rows(transposed_scorer, exam_batch,
+                                  correct_answers, points),
+              naive_scorer.score(exam_batch, correct_answers, points));
+  }
+
+  // Long exams go through the row-major kernel
+  const auto exam_batch = generate_exam_batch(10, 100);
+  const auto correct_answers = generate_correct_answers(100);
+  const auto points = generate_points(100);
+  EXPECT_EQ(Scorer::TransposedSimdScorer().score(exam_batch, correct_answers,
+                                                 points),
+            naive_scorer.score(exam_batch, correct_answers, points));
+}
+
+TEST(PackedAnswersTest, PackRoundTrips) {
+  for (const size_t questions : {1, 31, 32, 33, 100, 257}) {
+    const auto batch = generate_exam_batch(5, questions);
+    const auto packed = pack_answers(batch);
+    const auto unpacked = unpack_answers(packed);
+
+    EXPECT_EQ(packed.words_per_exam() % 8, 0);
+    for (size_t i = 0; i < batch.exam_count(); ++i) {
+      for (size_t j = 0; j < questions; ++j) {
+        EXPECT_EQ(packed.at(i, j), batch.row(i)[j]);
+      }
+      EXPECT_TRUE(std::equal(batch.row(i).begin(), batch.row(i).end(),
+                             unpacked.row(i).begin()));
+    }
+  }
+}
+
+TEST(PackedSimdScorerTest, MatchesNaiveScorer) {
+  Scorer::NaiveScorer naive_scorer;
+  Scorer::PackedSimdScorer packed_scorer;
+
+  for (const size_t questions : {1, 10, 64, 100, 257}) {
+    const auto exams = generate_exams(50, questions);
+    const auto exam_batch = generate_exam_batch(50, questions);
+    const auto correct_answers = generate_correct_answers(questions);
+
+    // Mixed and negative points, so every bit plane is used
+    ByteArray points(questions);
+    for (size_t j = 0; j < questions; ++j) {
+      points[j] = static_cast<int8_t>(j * 37 - 128);
+    }
+
+    const auto expected =
+        naive_scorer.score(exam_batch, correct_answers, points);
+    EXPECT_EQ(packed_scorer.score(pack_answers(exam_batch),
+                                  pack_answers(correct_answers), points),
+              expected);
+    EXPECT_EQ(packed_scorer.score(exam_batch, correct_answers, points),
+              expected);
+    EXPECT_EQ(score_reversed_rows(packed_scorer, exam_batch, correct_answers,
+                                  points),
+              expected);
+    EXPECT_EQ(packed_scorer.score(exams, correct_answers, points),
+              naive_scorer.score(exams, correct_answers, points));
+  }
+}
+
+TEST(PackedSimdScorerTest, BlanksNeverMatch) {
+  Scorer::NaiveScorer naive_scorer;
+  Scorer::PackedSimdScorer packed_scorer;
+
+  // A blank packed as an arbitrary code would match a 'D' of the key
+  auto correct_answers = generate_correct_answers(100);
+  for (size_t j = 0; j < correct_answers.size(); j += 3) {
+    correct_answers[j] = 'D';
+  }
+  const auto points = generate_points(100);
+  auto exam_batch = generate_exam_batch(50, 100);
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    for (size_t j = i % 5; j < 100; j += 5) {
+      exam_batch.row(i)[j] = j % 2 == 0 ? ' ' : 'E';
+    }
+  }
+  std::vector<ByteArray> exams(exam_batch.exam_count(), ByteArray(100));
+  for (size_t i = 0; i < exams.size(); ++i) {
+    std::copy(exam_batch.row(i).begin(), exam_batch.row(i).end(),
+              exams[i].begin());
+  }
+
+  const auto expected = naive_scorer.score(exam_batch, correct_answers, points);
+  EXPECT_EQ(packed_scorer.score(exam_batch, correct_answers, points),
+            expected);
+  EXPECT_EQ(packed_scorer.score(exams, correct_answers, points), expected);
+  EXPECT_EQ(score_reversed_rows(packed_scorer, exam_batch, correct_answers,
+                                points),
+            expected);
+
+  // Packed answers have no code for them
+  EXPECT_THROW(pack_answers(exam_batch), std::runtime_error);
+  EXPECT_THROW(pack_answers(exams[0]), std::runtime_error);
+}
+
+TEST(ExamFileTest, WriteThenMapRoundTrips) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "simd_research_test.exams")
+          .string();
+  const auto exam_batch = generate_exam_batch(300, 70);
+  write_exam_file(path, exam_batch);
+
+  {
+    const ExamFile file(path);
+    EXPECT_EQ(file.exam_count(), 300);
+    EXPECT_EQ(file.question_count(), 70);
+    EXPECT_EQ(file.pitch(), exam_batch.pitch());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(file.rows()) % 64, 0);
+    EXPECT_EQ(std::memcmp(file.rows(), exam_batch.data(),
+                          exam_batch.exam_count() * exam_batch.pitch()),
+              0);
+
+    const auto correct_answers = generate_correct_answers(70);
+    const auto points = generate_points(70);
+    const auto expected =
+        Scorer::NaiveScorer().score(exam_batch, correct_answers, points);
+
+    // Chunks of 1, 7 and every exam
+    for (const size_t chunk_bytes : {1, 7 * 128, 1 << 20}) {
+      Scorer::StreamingScorer streaming_scorer(Scorer::make_best_scorer(),
+                                               chunk_bytes);
+      EXPECT_EQ(streaming_scorer.score(file, correct_answers, points),
+                expected);
+    }
+    EXPECT_EQ(Scorer::NaiveScorer().score(read_exams(file), correct_answers,
+                                          points),
+              expected);
+  }
+
+  // Not an exam file
+  std::FILE *garbage = std::fopen(path.c_str(), "wb");
+  std::fputs("definitely not an exam file, but long enough for a header....",
+             garbage);
+  std::fclose(garbage);
+  EXPECT_THROW(ExamFile{path}, std::runtime_error);
+
+  std::filesystem::remove(path);
+  EXPECT_THROW(ExamFile{path}, std::runtime_error);
+}
+
+TEST(AnswerParserTest, ParsesValidSheets) {
+  const auto exam_batch = generate_exam_batch(20, 45);
+  std::string text;
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    text.append(exam_batch.row(i).begin(), exam_batch.row(i).end());
+    text += i % 2 ? "\r\n" : "\n";
+  }
+  // Blanks, and an unterminated last line
+  text += std::string(44, ' ') + "D";
+
+  const auto exams = parse_answer_sheets(text.data(), text.size(), 45);
+
+  ASSERT_EQ(exams.exam_count(), 21);
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    EXPECT_EQ(std::memcmp(exams.row(i).data(), exam_batch.row(i).data(),
+                          exam_batch.pitch()),
+              0);
+  }
+  EXPECT_EQ(exams.row(20)[0], ' ');
+  EXPECT_EQ(exams.row(20)[44], 'D');
+  EXPECT_EQ(exams.row(20).data()[45], 0);
+
+  // Into an existing batch, which must have enough rows
+  ExamBatch reused(21, 45);
+  EXPECT_EQ(parse_answer_sheets(text.data(), text.size(), reused), 21);
+  EXPECT_EQ(std::memcmp(reused.data(), exams.data(), 21 * exams.pitch()), 0);
+  ExamBatch too_small(20, 45);
+  EXPECT_THROW(parse_answer_sheets(text.data(), text.size(), too_small),
+               std::runtime_error);
+}
+
+TEST(AnswerParserTest, ReportsInvalidBytes) {
+  const std::string text =
+      "ABCDABCDABCDABCDABCDABCDABCDABCDABCDAB\n"
+      "ABCDABCDABCDABCDABCDABCDABCDABCDABxDAB\n"
+      "ABCDAB\n"
+      "ABCDABCDABCDABCDABCDABCDABCDABCDABCDABC\n"
+      "aBCDABCDABCDABCDABCDABCDABCDABCDABCDA?\n";
+
+  try {
+    parse_answer_sheets(text.data(), text.size(), 38);
+    FAIL() << "Expected an AnswerSheetParseError";
+  } catch (const AnswerSheetParseError &e) {
+    EXPECT_EQ(e.error().exam, 1);
+    EXPECT_EQ(e.error().question, 34);
+    EXPECT_EQ(e.error().byte, 'x');
+  }
+
+  std::vector<AnswerSheetError> errors;
+  const auto exams = parse_answer_sheets(text.data(), text.size(), 38, &errors);
+
+  ASSERT_EQ(exams.exam_count(), 5);
+  ASSERT_EQ(errors.size(), 5);
+  const std::vector<std::tuple<size_t, size_t, char>> expected = {
+      {1, 34, 'x'}, {2, 6, '\n'}, {3, 38, 'C'}, {4, 0, 'a'}, {4, 37, '?'}};
+  for (size_t k = 0; k < expected.size(); ++k) {
+    EXPECT_EQ(std::make_tuple(errors[k].exam, errors[k].question,
+                              errors[k].byte),
+              expected[k]);
+  }
+  EXPECT_EQ(exams.row(1)[34], ' ');
+  EXPECT_EQ(exams.row(2)[6], ' ');
+  EXPECT_EQ(exams.row(4)[37], ' ');
+}
+
+TEST(AnswerParserTest, EndsShortLinesAtTheirOwnNewline) {
+  // The newline after "B" is where the first line's newline is expected
+  std::vector<AnswerSheetError> errors;
+  const std::string short_lines = "A\nB\nCDA\n";
+  auto exams = parse_answer_sheets(short_lines.data(), short_lines.size(), 3,
+                                   &errors);
+
+  ASSERT_EQ(exams.exam_count(), 3);
+  EXPECT_EQ(std::string(exams.row(0).begin(), exams.row(0).end()), "A  ");
+  EXPECT_EQ(std::string(exams.row(1).begin(), exams.row(1).end()), "B  ");
+  EXPECT_EQ(std::string(exams.row(2).begin(), exams.row(2).end()), "CDA");
+  ASSERT_EQ(errors.size(), 2);
+  EXPECT_EQ(std::make_tuple(errors[0].exam, errors[0].question, errors[0].byte),
+            std::make_tuple(size_t{0}, size_t{1}, '\n'));
+  EXPECT_EQ(std::make_tuple(errors[1].exam, errors[1].question, errors[1].byte),
+            std::make_tuple(size_t{1}, size_t{1}, '\n'));
+
+  // Short and long lines of 40 answers, with a newline at the expected end of
+  // every short line
+  const std::string full(40, 'B');
+  const std::string text = std::string(10, 'A') + "\n" + std::string(28, 'C') +
+                           "\r\n" + full + "\n" + std::string(20, 'D') + "\n" +
+                           std::string(19, 'A') + "\n" + full + "A\n" + full;
+  errors.clear();
+  exams = parse_answer_sheets(text.data(), text.size(), 40, &errors);
+
+  ASSERT_EQ(exams.exam_count(), 7);
+  const std::vector<std::string> rows = {
+      std::string(10, 'A') + std::string(30, ' '),
+      std::string(28, 'C') + std::string(12, ' '),
+      full,
+      std::string(20, 'D') + std::string(20, ' '),
+      std::string(19, 'A') + std::string(21, ' '),
+      full,
+      full};
+  for (size_t i = 0; i < rows.size(); ++i) {
+    EXPECT_EQ(std::string(exams.row(i).begin(), exams.row(i).end()), rows[i])
+        << i;
+  }
+  const std::vector<std::tuple<size_t, size_t, char>> expected = {
+      {0, 10, '\n'}, {1, 28, '\r'}, {3, 20, '\n'}, {4, 19, '\n'},
+      {5, 40, 'A'}};
+  ASSERT_EQ(errors.size(), expected.size());
+  for (size_t k = 0; k < expected.size(); ++k) {
+    EXPECT_EQ(std::make_tuple(errors[k].exam, errors[k].question,
+                              errors[k].byte),
+              expected[k]);
+  }
+}
+
+TEST(ScoringReportTest, MatchesSecondScan) {
+  const size_t questions = 70;
+  const auto exam_batch = generate_exam_batch(600, questions);
+  const auto correct_answers = generate_correct_answers(questions);
+  const auto points = generate_points(questions);
+  const auto scores =
+      Scorer::NaiveScorer().score(exam_batch, correct_answers, points);
+
+  // The item analysis, the slow way
+  std::vector<uint64_t> correct_count(questions);
+  std::vector<std::array<uint64_t, 4>> option_count(questions);
+  std::vector<double> correct_score_sum(questions);
+  double sum = 0, square_sum = 0;
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    sum += scores[i];
+    square_sum += static_cast<double>(scores[i]) * scores[i];
+    for (size_t j = 0; j < questions; ++j) {
+      ++option_count[j][exam_batch.row(i)[j] - 'A'];
+      if (exam_batch.row(i)[j] == correct_answers[j]) {
+        ++correct_count[j];
+        correct_score_sum[j] += scores[i];
+      }
+    }
+  }
+
+  Scorer::SimdScorer simd_scorer;
+  Scorer::SimdAvx512Scorer simd_avx512_scorer;
+
+  const auto check = [&](const ScoringReport &report) {
+    EXPECT_EQ(report.scores, scores);
+    EXPECT_EQ(report.correct_count, correct_count);
+    EXPECT_EQ(report.option_count, option_count);
+
+    const double n = static_cast<double>(scores.size());
+    const double deviation = std::sqrt(square_sum / n - sum * sum / n / n);
+    for (size_t j = 0; j < questions; ++j) {
+      const double c = static_cast<double>(correct_count[j]);
+      const double expected =
+          (correct_score_sum[j] / c - (sum - correct_score_sum[j]) / (n - c)) /
+          deviation * std::sqrt(c / n * (1 - c / n));
+      EXPECT_NEAR(report.point_biserial[j], expected, 1e-9);
+    }
+  };
+
+  check(simd_scorer.score_with_report(exam_batch, correct_answers, points));
+  std::vector<ByteArray> exams;
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    exams.emplace_back(questions);
+    std::copy(exam_batch.row(i).begin(), exam_batch.row(i).end(),
+              exams.back().begin());
+  }
+  check(simd_scorer.score_with_report(exams, correct_answers, points));
+  if (Cpu::supports_avx512()) {
+    check(simd_avx512_scorer.score_with_report(exam_batch, correct_answers,
+                                               points));
+    check(simd_avx512_scorer.score_with_report(exams, correct_answers, points));
+  }
+
+  // Nobody got a question right
+  const auto report = simd_scorer.score_with_report(
+      ExamBatch(3, questions, ' '), correct_answers, points);
+  EXPECT_EQ(report.correct_count, std::vector<uint64_t>(questions, 0));
+  EXPECT_TRUE(std::isnan(report.point_biserial[0]));
+}
+
+TEST(MultiVersionScorerTest, ScoresEachExamAgainstItsVariant) {
+  const size_t questions = 50;
+  const auto exam_batch = generate_exam_batch(500, questions);
+
+  Scorer::AnswerKeyTable keys(questions);
+  for (int8_t v = 1; v <= 16; ++v) {
+    keys.add(generate_correct_answers(questions), ByteArray(questions, v));
+  }
+
+  std::vector<uint32_t> variants(exam_batch.exam_count());
+  for (size_t i = 0; i < variants.size(); ++i) {
+    // Some runs of the same variant, and some scattered ones
+    variants[i] = i < 100 ? static_cast<uint32_t>(i / 25)
+                          : static_cast<uint32_t>(i * 7919 % keys.size());
+  }
+
+  std::vector<ByteArray> exams;
+  std::vector<int32_t> expected;
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    exams.emplace_back(questions);
+    std::copy(exam_batch.row(i).begin(), exam_batch.row(i).end(),
+              exams.back().begin());
+    expected.push_back(Scorer::NaiveScorer().score(
+        std::vector(1, exams.back()), keys.correct_answers(variants[i]),
+        keys.points(variants[i]))[0]);
+  }
+
+  for (const bool group_by_variant : {false, true}) {
+    Scorer::MultiVersionScorer scorer(Scorer::make_best_scorer(),
+                                      group_by_variant);
+    EXPECT_EQ(scorer.score(exam_batch, variants, keys), expected);
+    EXPECT_EQ(scorer.score(exams, variants, keys), expected);
+  }
+
+  Scorer::MultiVersionScorer scorer(Scorer::make_best_scorer());
+  variants[3] = 16;
+  EXPECT_THROW(scorer.score(exam_batch, variants, keys), std::runtime_error);
+  variants.pop_back();
+  EXPECT_THROW(scorer.score(exam_batch, variants, keys), std::runtime_error);
+  EXPECT_THROW(keys.add(ByteArray(questions), ByteArray(questions - 1)),
+               std::runtime_error);
+}
+
+template <typename Point>
+static void expect_weighted_scorers_match_naive(const PointArray<Point> &points,
+                                                const PointArray<Point> &penalties,
+                                                const ExamBatch &exam_batch,
+                                                const ByteArray &correct_answers) {
+  std::vector<ByteArray> exams;
+  for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+    exams.emplace_back(exam_batch.question_count());
+    std::copy(exam_batch.row(i).begin(), exam_batch.row(i).end(),
+              exams.back().begin());
+  }
+
+  const auto expected = Scorer::NaiveWeightedScorer<Point>().score(
+      exams, correct_answers, points, penalties);
+
+  std::vector<std::shared_ptr<Scorer::BaseWeightedScorer<Point>>> scorers;
+  if (Cpu::supports_avx2()) {
+    scorers.push_back(std::make_shared<Scorer::SimdWeightedScorer<Point>>());
+  }
+  if (Cpu::supports_avx512()) {
+    scorers.push_back(
+        std::make_shared<Scorer::SimdAvx512WeightedScorer<Point>>());
+  }
+
+  for (const auto &scorer : scorers) {
+    EXPECT_EQ(scorer->score(exam_batch, correct_answers, points, penalties),
+              expected);
+    EXPECT_EQ(scorer->score(exams, correct_answers, points, penalties),
+              expected);
+  }
+}
+
+TEST(WeightedScorerTest, PointsAndPenalties) {
+  // 'C' is wrong, ' ' is blank
+  const ByteArray exam = {'A', 'C', ' ', 'D'};
+  const ByteArray correct_answers = {'A', 'B', 'C', 'D'};
+  const PointArray<int16_t> points = {1000, 2000, 3000, -4};
+  const PointArray<int16_t> penalties = {7, 250, 9, 11};
+
+  for (const auto &scorer :
+       {std::shared_ptr<Scorer::BaseWeightedScorer<int16_t>>(
+            std::make_shared<Scorer::NaiveWeightedScorer<int16_t>>()),
+        Scorer::make_best_weighted_scorer<int16_t>()}) {
+    EXPECT_EQ(scorer->score(std::vector(1, exam), correct_answers, points,
+                            penalties),
+              std::vector<int32_t>{1000 - 250 - 4});
+    EXPECT_EQ(scorer->score(std::vector(1, exam), correct_answers, points),
+              std::vector<int32_t>{1000 - 4});
+    EXPECT_THROW(scorer->score(std::vector(1, exam), correct_answers, points,
+                               PointArray<int16_t>(3)),
+                 std::runtime_error);
+  }
+}
+
+TEST(WeightedScorerTest, OverflowEdges) {
+  // Long exams with some blanks, to cross several blocks and their padding
+  for (const size_t questions : {1, 31, 64, 200, 1000}) {
+    auto exam_batch = generate_exam_batch(300, questions);
+    for (size_t i = 0; i < exam_batch.exam_count(); i += 3) {
+      exam_batch.row(i)[(i * 7) % questions] = Scorer::kBlankAnswer;
+    }
+    // Some perfect exams
+    const auto correct_answers = generate_correct_answers(questions);
+    std::copy(correct_answers.begin(), correct_answers.end(),
+              exam_batch.row(1).data());
+
+    std::mt19937 rng(static_cast<uint32_t>(questions));
+
+    for (const int8_t point : {int8_t{127}, int8_t{-128}, int8_t{-1}}) {
+      for (const int8_t penalty : {int8_t{127}, int8_t{-128}}) {
+        expect_weighted_scorers_match_naive(
+            PointArray<int8_t>(questions, point),
+            PointArray<int8_t>(questions, penalty), exam_batch,
+            correct_answers);
+      }
+    }
+    for (const int16_t point : {int16_t{32767}, int16_t{-32768}}) {
+      for (const int16_t penalty : {int16_t{32767}, int16_t{-32768}}) {
+        expect_weighted_scorers_match_naive(
+            PointArray<int16_t>(questions, point),
+            PointArray<int16_t>(questions, penalty), exam_batch,
+            correct_answers);
+      }
+    }
+
+    PointArray<int8_t> points8(questions), penalties8(questions);
+    PointArray<int16_t> points16(questions), penalties16(questions);
+    for (size_t j = 0; j < questions; ++j) {
+      points8[j] = static_cast<int8_t>(rng());
+      penalties8[j] = static_cast<int8_t>(rng());
+      points16[j] = static_cast<int16_t>(rng());
+      penalties16[j] = static_cast<int16_t>(rng());
+    }
+    expect_weighted_scorers_match_naive(points8, penalties8, exam_batch,
+                                        correct_answers);
+    expect_weighted_scorers_match_naive(points16, penalties16, exam_batch,
+                                        correct_answers);
+  }
+}
+
+TEST(ScoreDistributionTest, MatchesSortedScores) {
+  std::mt19937 rng(7);
+  std::vector<int32_t> scores(10'007);
+  for (auto &score : scores) {
+    score = static_cast<int32_t>(rng() % 301) - 100;
+  }
+
+  std::vector<uint32_t> expected_order(scores.size());
+  std::iota(expected_order.begin(), expected_order.end(), 0);
+  std::stable_sort(expected_order.begin(), expected_order.end(),
+                   [&](const uint32_t &a, const uint32_t &b) {
+                     return scores[a] > scores[b];
+                   });
+
+  ThreadPool pool(3);
+  for (ThreadPool *p : {static_cast<ThreadPool *>(nullptr), &pool}) {
+    const Scorer::ScoreDistribution distribution(scores, -120, 250, p);
+
+    EXPECT_EQ(distribution.stable_order(scores), expected_order);
+    for (const size_t k : {0, 1, 10, 1000, 10'007, 20'000}) {
+      const auto top = distribution.top_k(scores, k);
+      EXPECT_EQ(top, std::vector<uint32_t>(
+                         expected_order.begin(),
+                         expected_order.begin() +
+                             static_cast<std::ptrdiff_t>(
+                                 std::min(k, scores.size()))));
+    }
+
+    const auto ranks = distribution.ranks(scores, p);
+    for (size_t i = 0; i < scores.size(); ++i) {
+      const auto above = static_cast<uint32_t>(
+          std::count_if(scores.begin(), scores.end(),
+                        [&](const int32_t &s) { return s > scores[i]; }));
+      if (i % 97 == 0) {
+        ASSERT_EQ(ranks[i], above + 1);
+      }
+    }
+
+    std::vector<int32_t> sorted = scores;
+    std::sort(sorted.begin(), sorted.end());
+    for (const double percent : {0.01, 25.0, 50.0, 90.0, 100.0}) {
+      const auto rank = static_cast<size_t>(
+          std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+      EXPECT_EQ(distribution.percentile(percent), sorted[rank - 1]);
+    }
+
+    EXPECT_EQ(distribution.count_at_least(-100), scores.size());
+    EXPECT_EQ(distribution.count_at_least(201), 0);
+    EXPECT_EQ(distribution.count_at_least(150),
+              std::count_if(scores.begin(), scores.end(),
+                            [](const int32_t &s) { return s >= 150; }));
+    EXPECT_DOUBLE_EQ(distribution.percentile_rank(250), 100.0);
+  }
+
+  EXPECT_THROW(Scorer::ScoreDistribution(scores, -99, 200), std::runtime_error);
+
+  // Other scores than the distribution's are rejected instead of indexing past
+  // the histogram or the result
+  const Scorer::ScoreDistribution distribution(scores, -120, 250, &pool);
+  auto shorter = scores;
+  shorter.pop_back();
+  auto out_of_bounds = scores;
+  out_of_bounds[5] = 251;
+  // Same size and bounds, but one more top score than was counted
+  auto more_at_top = scores;
+  more_at_top[expected_order.back()] = scores[expected_order.front()];
+  for (const auto &other : {shorter, out_of_bounds, more_at_top}) {
+    EXPECT_THROW(distribution.stable_order(other), std::runtime_error);
+    EXPECT_THROW(distribution.top_k(other, other.size()), std::runtime_error);
+  }
+  EXPECT_THROW(distribution.ranks(shorter, &pool), std::runtime_error);
+  EXPECT_THROW(distribution.ranks(out_of_bounds, &pool), std::runtime_error);
+  EXPECT_EQ(Scorer::score_bounds(ByteArray{3, -2, 5}),
+            std::make_pair(-2, 8));
+  EXPECT_EQ(Scorer::score_bounds(PointArray<int16_t>{3, -2},
+                                 PointArray<int16_t>{1, -7}),
+            std::make_pair(-3, 10));
+}
+
+TEST(ExamGeneratorTest, DeterministicAcrossThreads) {
+  const auto correct_answers = generate_correct_answers(150, 42);
+  EXPECT_EQ(Scorer::NaiveScorer().score(
+                std::vector(1, generate_correct_answers(150, 42)),
+                correct_answers, ByteArray(150, 1))[0],
+            150);
+
+  for (const bool uniform : {true, false}) {
+    ExamGeneratorOptions options;
+    if (!uniform) {
+      options.correct_rate = 0.6;
+      options.ability_spread = 0.3;
+      options.blank_rate = 0.05;
+    }
+
+    options.thread_count = 1;
+    const auto single = generate_exam_batch(1000, correct_answers, 7, options);
+    options.thread_count = 3;
+    const auto multi = generate_exam_batch(1000, correct_answers, 7, options);
+    const auto exams = generate_exams(1000, correct_answers, 7, options);
+    const auto other_seed =
+        generate_exam_batch(1000, correct_answers, 8, options);
+
+    ASSERT_EQ(single.pitch(), multi.pitch());
+    EXPECT_EQ(std::memcmp(single.data(), multi.data(),
+                          single.exam_count() * single.pitch()),
+              0);
+    EXPECT_NE(std::memcmp(single.data(), other_seed.data(),
+                          single.exam_count() * single.pitch()),
+              0);
+    for (size_t i = 0; i < exams.size(); ++i) {
+      ASSERT_TRUE(std::equal(exams[i].begin(), exams[i].end(),
+                             single.row(i).begin()));
+      // The padding stays zeroed
+      for (size_t j = 150; j < single.pitch(); ++j) {
+        ASSERT_EQ(single.row(i).data()[j], 0);
+      }
+    }
+  }
+}
+
+TEST(ExamGeneratorTest, AnswerDistribution) {
+  const size_t exam_count = 4000, questions = 100;
+  const auto correct_answers = generate_correct_answers(questions, 1);
+
+  ExamGeneratorOptions options;
+  options.correct_rate = 0.7;
+  options.blank_rate = 0.1;
+  options.option_weights = {1, 0, 0, 0};
+  const auto exams =
+      generate_exam_batch(exam_count, correct_answers, 3, options);
+
+  size_t correct = 0, blank = 0, other = 0;
+  for (size_t i = 0; i < exam_count; ++i) {
+    for (size_t j = 0; j < questions; ++j) {
+      const int8_t answer = exams.row(i)[j];
+      if (answer == correct_answers[j]) {
+        ++correct;
+      } else if (answer == ' ') {
+        ++blank;
+      } else {
+        // The only popular wrong answer is 'A'
+        if (correct_answers[j] != 'A') {
+          ASSERT_EQ(answer, 'A');
+        }
+        ++other;
+      }
+    }
+  }
+
+  const double total = exam_count * questions;
+  EXPECT_NEAR(correct / total, 0.7, 0.01);
+  EXPECT_NEAR(blank / total, 0.1, 0.01);
+  EXPECT_NEAR(other / total, 0.2, 0.01);
+
+  // Uniform answers cover 'A'..'D' evenly
+  const auto uniform = generate_exam_batch(exam_count, questions);
+  std::array<size_t, 4> counts{};
+  for (size_t i = 0; i < exam_count; ++i) {
+    for (const auto &answer : uniform.row(i)) {
+      ASSERT_TRUE(answer >= 'A' && answer <= 'D');
+      ++counts[answer - 'A'];
+    }
+  }
+  for (const auto &count : counts) {
+    EXPECT_NEAR(count / total, 0.25, 0.01);
+  }
+}
+
+TEST(PerfCountersTest, InstrumentedScorerMatchesKernel) {
+  const auto key = generate_correct_answers(77, 2);
+  const auto exams = generate_exams(1000, key, 1);
+  const auto exam_batch = generate_exam_batch(1000, key, 3);
+  const auto correct_answers = generate_correct_answers(77, 4);
+  const auto points = generate_points(77);
+
+  const auto kernel = Scorer::make_best_scorer();
+  Scorer::InstrumentedScorer instrumented_scorer(kernel);
+  EXPECT_EQ(instrumented_scorer.score(exams, correct_answers, points),
+            kernel->score(exams, correct_answers, points));
+  EXPECT_EQ(instrumented_scorer.score(exam_batch, correct_answers, points),
+            kernel->score(exam_batch, correct_answers, points));
+  EXPECT_EQ(instrumented_scorer.calls(), 2);
+
+  // Whether or not this machine has perf events, the unavailable ones read 0
+  // and the available ones counted something
+  const auto &counts = instrumented_scorer.counts();
+  for (size_t e = 0; e < kPerfEventCount; ++e) {
+    const auto event = static_cast<PerfEvent>(e);
+    if (!counts.has(event)) {
+      EXPECT_EQ(counts[event], 0) << perf_event_name(event);
+    }
+  }
+  if (counts.has(PerfEvent::kInstructions)) {
+    // At least one instruction per 64 answers
+    EXPECT_GT(counts[PerfEvent::kInstructions], 1000 * 77 * 2 / 64);
+  }
+
+  instrumented_scorer.reset();
+  EXPECT_EQ(instrumented_scorer.calls(), 0);
+  EXPECT_EQ(instrumented_scorer.counts()[PerfEvent::kInstructions], 0);
+
+  // A scope without counters does nothing
+  { const PerfScope scope(nullptr); }
+}
+
+TEST(ScoringSessionTest, DeliversChunksInOrder) {
+  const auto correct_answers = generate_correct_answers(77, 1);
+  const auto points = generate_points(77);
+  const auto exams = generate_exam_batch(1000, correct_answers, 2);
+  const auto kernel = Scorer::make_best_scorer();
+  const auto expected = kernel->score(exams, correct_answers, points);
+
+  // More chunks than buffers, so that they are recycled, and a partial one
+  std::vector<int32_t> scores;
+  uint64_t next_sequence = 0;
+  {
+    Scorer::ScoringSession session(
+        kernel, correct_answers, points,
+        [&](const Scorer::ScoringChunk &chunk) {
+          EXPECT_EQ(chunk.sequence, next_sequence++);
+          scores.insert(scores.end(), chunk.scores.begin(),
+                        chunk.scores.begin() + chunk.exam_count);
+        },
+        64, 3);
+    for (size_t first = 0; first < exams.exam_count(); first += 64) {
+      auto &chunk = session.acquire();
+      chunk.exam_count = std::min<size_t>(64, exams.exam_count() - first);
+      std::copy_n(exams.row(first).data(), chunk.exam_count * exams.pitch(),
+                  chunk.exams.data());
+      session.submit(chunk);
+    }
+    session.close();
+  }
+  EXPECT_EQ(scores, expected);
+
+  // The same through futures
+  Scorer::ScoringSession session(kernel, correct_answers, points, nullptr,
+                                 300);
+  std::vector<std::future<std::vector<int32_t>>> futures;
+  for (size_t first = 0; first < exams.exam_count(); first += 300) {
+    auto &chunk = session.acquire();
+    chunk.exam_count = std::min<size_t>(300, exams.exam_count() - first);
+    std::copy_n(exams.row(first).data(), chunk.exam_count * exams.pitch(),
+                chunk.exams.data());
+    futures.push_back(session.score_async(chunk));
+  }
+  scores.clear();
+  for (auto &future : futures) {
+    const auto chunk_scores = future.get();
+    scores.insert(scores.end(), chunk_scores.begin(), chunk_scores.end());
+  }
+  EXPECT_EQ(scores, expected);
+
+  // Errors of the callback reach close()
+  Scorer::ScoringSession failing_session(
+      kernel, correct_answers, points,
+      [](const Scorer::ScoringChunk &) { throw std::runtime_error("full"); },
+      64);
+  failing_session.submit(failing_session.acquire());
+  EXPECT_THROW(failing_session.close(), std::runtime_error);
+
+  // Rejected chunks go back to the pool: more rejections than chunks, and
+  // the session still scores
+  Scorer::ScoringSession rejecting_session(kernel, correct_answers, points,
+                                           nullptr, 64, 3);
+  for (size_t i = 0; i < 4; ++i) {
+    auto &chunk = rejecting_session.acquire();
+    chunk.exam_count = 65;
+    EXPECT_THROW(rejecting_session.submit(chunk), std::runtime_error);
+    auto &async_chunk = rejecting_session.acquire();
+    async_chunk.exam_count = 65;
+    EXPECT_THROW(rejecting_session.score_async(async_chunk),
+                 std::runtime_error);
+  }
+  auto &chunk = rejecting_session.acquire();
+  chunk.exam_count = 64;
+  std::copy_n(exams.data(), 64 * exams.pitch(), chunk.exams.data());
+  auto future = rejecting_session.score_async(chunk);
+  EXPECT_EQ(future.get(),
+            std::vector<int32_t>(expected.begin(), expected.begin() + 64));
+
+  // A chunk submitted after close() is rejected instead of being lost, or
+  // blocking once the scoring queue is full
+  auto &late_chunk = rejecting_session.acquire();
+  auto &late_async_chunk = rejecting_session.acquire();
+  late_chunk.exam_count = late_async_chunk.exam_count = 1;
+  rejecting_session.close();
+  EXPECT_THROW(rejecting_session.submit(late_chunk), std::runtime_error);
+  EXPECT_THROW(rejecting_session.score_async(late_async_chunk),
+               std::runtime_error);
+}
+
+TEST(RescorerTest, MatchesFreshNaiveScoring) {
+  const auto old_correct_answers = generate_correct_answers(130, 1);
+  const auto old_points = generate_points(130);
+  const auto exam_batch = generate_exam_batch(1001, old_correct_answers, 2);
+  const auto exams = generate_exams(1001, old_correct_answers, 2);
+  const auto transposed = transpose_exams(exam_batch);
+  Scorer::NaiveScorer naive_scorer;
+  const auto old_scores =
+      naive_scorer.score(exam_batch, old_correct_answers, old_points);
+
+  // A corrected answer, a changed weight, a voided question, and two changes
+  // in the same 64-byte line
+  auto new_correct_answers = old_correct_answers;
+  auto new_points = old_points;
+  new_correct_answers[3] = new_correct_answers[3] == 'A' ? 'B' : 'A';
+  new_points[70] = static_cast<int8_t>(new_points[70] + 5);
+  new_points[129] = 0;
+  new_correct_answers[64] = 'D';
+  new_points[65] = -7;
+  EXPECT_EQ(Scorer::key_changes(old_correct_answers, old_points,
+                                new_correct_answers, new_points)
+                .size(),
+            5 - (old_correct_answers[64] == 'D'));
+
+  const auto expected =
+      naive_scorer.score(exam_batch, new_correct_answers, new_points);
+  Scorer::Rescorer rescorer;
+
+  auto scores = old_scores;
+  rescorer.rescore(exam_batch, scores, old_correct_answers, old_points,
+                   new_correct_answers, new_points);
+  EXPECT_EQ(scores, expected);
+
+  scores = old_scores;
+  rescorer.rescore(exams, scores, old_correct_answers, old_points,
+                   new_correct_answers, new_points);
+  EXPECT_EQ(scores, expected);
+
+  scores = old_scores;
+  rescorer.rescore(transposed, scores, old_correct_answers, old_points,
+                   new_correct_answers, new_points);
+  EXPECT_EQ(scores, expected);
+
+  scores.pop_back();
+  EXPECT_THROW(rescorer.rescore(exam_batch, scores, old_correct_answers,
+                                old_points, new_correct_answers, new_points),
+               std::runtime_error);
+}
+
+TEST(RescorerTest, VoidsAndGivesQuestionsToEveryone) {
+  const auto correct_answers = generate_correct_answers(130, 1);
+  auto old_points = generate_points(130);
+  old_points[40] = 0;
+  const auto exam_batch = generate_exam_batch(1001, correct_answers, 2);
+  const auto exams = generate_exams(1001, correct_answers, 2);
+  const auto transposed = transpose_exams(exam_batch);
+  Scorer::NaiveScorer naive_scorer;
+  const auto old_scores =
+      naive_scorer.score(exam_batch, correct_answers, old_points);
+
+  // Question 10 is voided, 20 is given to everyone, and so is 40, which was
+  // already worth nothing
+  const std::vector<Scorer::KeyChange> changes = {
+      Scorer::void_question(correct_answers, old_points, 10),
+      Scorer::give_to_everyone(correct_answers, old_points, 20, 3),
+      Scorer::give_to_everyone(correct_answers, old_points, 40, 4)};
+  auto new_points = old_points;
+  new_points[10] = 0;
+  new_points[20] = 0;
+  auto expected = naive_scorer.score(exam_batch, correct_answers, new_points);
+  for (auto &score : expected) {
+    score += 3 + 4;
+  }
+  Scorer::Rescorer rescorer;
+
+  auto scores = old_scores;
+  rescorer.rescore(exam_batch, scores, changes);
+  EXPECT_EQ(scores, expected);
+
+  scores = old_scores;
+  rescorer.rescore(exams, scores, changes);
+  EXPECT_EQ(scores, expected);
+
+  scores = old_scores;
+  rescorer.rescore(transposed, scores, changes);
+  EXPECT_EQ(scores, expected);
+
+  scores = old_scores;
+  EXPECT_THROW(rescorer.rescore(exam_batch, scores,
+                                {Scorer::KeyChange{130, 'A', 'A', 2, 0}}),
+               std::runtime_error);
+  EXPECT_EQ(scores, old_scores);
+}
+
+// `size` bytes that end right before an inaccessible page, so that reading a
+// single byte past them faults
+class GuardedBuffer {
+ private:
+  int8_t *_mapping;
+  size_t _mapping_size;
+  size_t _size;
+
+ public:
+  explicit GuardedBuffer(const size_t &size) : _size(size) {
+    const size_t page_size = ::sysconf(_SC_PAGESIZE);
+    const size_t pages = (size + page_size - 1) / page_size + 1;
+    _mapping_size = pages * page_size;
+    _mapping = static_cast<int8_t *>(::mmap(nullptr, _mapping_size,
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ::mprotect(_mapping + _mapping_size - page_size, page_size, PROT_NONE);
+  }
+
+  GuardedBuffer(const GuardedBuffer &) = delete;
+  GuardedBuffer &operator=(const GuardedBuffer &) = delete;
+
+  [[nodiscard]] int8_t *data() const {
+    return _mapping + _mapping_size - ::sysconf(_SC_PAGESIZE) - _size;
+  }
+
+  ~GuardedBuffer() { ::munmap(_mapping, _mapping_size); }
+};
+
+TEST(ExamBatchViewTest, ScoresUnpaddedBuffersInPlace) {
+  std::vector<std::shared_ptr<Scorer::BaseScorer>> scorers = {
+      std::make_shared<Scorer::NaiveScorer>(),
+      std::make_shared<Scorer::BooleanMultiplicationScorer>(),
+      std::make_shared<Scorer::ParallelScorer>(Scorer::make_best_scorer(), 2,
+                                               5)};
+  if (Cpu::supports_sse41()) {
+    scorers.push_back(std::make_shared<Scorer::SimdSse41Scorer>());
+  }
+  if (Cpu::supports_avx2()) {
+    scorers.push_back(std::make_shared<Scorer::SimdScorer>());
+  }
+  if (Cpu::supports_avx512()) {
+    scorers.push_back(std::make_shared<Scorer::SimdAvx512Scorer>());
+    scorers.push_back(std::make_shared<Scorer::SimdAvx512BlockedScorer>());
+  }
+
+  for (const size_t question_count :
+       {1, 3, 15, 16, 31, 33, 63, 64, 65, 100, 131}) {
+    for (const size_t gap : {0, 3}) {
+      const auto correct_answers = generate_correct_answers(question_count, 1);
+      const auto points = generate_points(question_count);
+      const auto exams = generate_exam_batch(37, correct_answers, 2);
+      const auto expected =
+          Scorer::NaiveScorer().score(exams, correct_answers, points);
+
+      // Unaligned, tightly packed (or `gap` bytes apart) rows, the last one
+      // ending on the guard page, like the key and the points
+      const size_t stride = question_count + gap;
+      GuardedBuffer rows(stride * 36 + question_count);
+      GuardedBuffer key(question_count);
+      GuardedBuffer weights(question_count);
+      for (size_t i = 0; i < exams.exam_count(); ++i) {
+        std::copy_n(exams.row(i).data(), question_count,
+                    rows.data() + i * stride);
+      }
+      std::copy_n(correct_answers.data(), question_count, key.data());
+      std::copy_n(points.data(), question_count, weights.data());
+
+      const ExamBatchView view(rows.data(), 37, question_count, stride);
+      for (const auto &scorer : scorers) {
+        EXPECT_EQ(scorer->score(view, ByteArrayView(key.data(), question_count),
+                                ByteArrayView(weights.data(), question_count)),
+                  expected)
+            << question_count << " questions";
+      }
+    }
+  }
+
+  // A ByteArray is a view too
+  const auto correct_answers = generate_correct_answers(10, 1);
+  const ExamBatch exams(3, 10, 'A');
+  EXPECT_THROW(Scorer::make_best_scorer()->score(
+                   ExamBatchView(exams.data(), 3, 9, exams.pitch()),
+                   ByteArrayView(correct_answers), generate_points(10)),
+               std::runtime_error);
+}
+
+TEST(SimdAvx512BlockedScorerTest, MatchesNaiveScorer) {
+  if (!Cpu::supports_avx512()) {
+    GTEST_SKIP() << "The CPU lacks AVX512 support";
+  }
+
+  Scorer::SimdAvx512BlockedScorer blocked_scorer;
+  // Full passes, a remainder, and the prefetch of a last partial pass
+  for (const size_t exam_count : {1, 7, 8, 9, 16, 23, 100}) {
+    for (const size_t question_count : {1, 63, 64, 65, 200, 1000}) {
+      const auto correct_answers = generate_correct_answers(question_count, 1);
+      const auto points = generate_points(question_count);
+      const auto exam_batch =
+          generate_exam_batch(exam_count, correct_answers, 2);
+      const auto exams = generate_exams(exam_count, correct_answers, 2);
+      const auto expected =
+          Scorer::NaiveScorer().score(exams, correct_answers, points);
+
+      EXPECT_EQ(blocked_scorer.score(exams, correct_answers, points), expected)
+          << exam_count << " exams, " << question_count << " questions";
+      EXPECT_EQ(blocked_scorer.score(exam_batch, correct_answers, points),
+                Scorer::NaiveScorer().score(exam_batch, correct_answers,
+                                            points))
+          << exam_count << " exams, " << question_count << " questions";
+    }
+  }
+}
+
+TEST(MultiSelectScorerTest, MixedRulesMatchNaiveScorer) {
+  using Scorer::QuestionRule;
+  using Scorer::select_options;
+
+  // 'B' is right, "AC" of "ACD" is 2/3 of 9 points, "AB" of "AC" is 1 - 1 = 0
+  // with the penalty, and "ABC" isn't "AB"
+  const Scorer::MultiSelectKey key(
+      {'B', select_options("ACD"), select_options("AC"), select_options("AB")},
+      {5, 9, 8, 7},
+      {QuestionRule::kExact, QuestionRule::kPartial,
+       QuestionRule::kPartialWithPenalty, QuestionRule::kExact});
+  const std::vector<ByteArray> exams = {
+      {'B', select_options("AC"), select_options("AB"), select_options("ABC")},
+      {'A', select_options("ACD"), select_options("C"), select_options("AB")},
+      {' ', ' ', ' ', ' '}};
+  EXPECT_EQ(Scorer::NaiveMultiSelectScorer().score(exams, key),
+            (std::vector<int32_t>{11, 20, 0}));
+  EXPECT_THROW(Scorer::MultiSelectKey({'A'}, {1}, {QuestionRule::kPartial}),
+               std::runtime_error);
+
+  std::vector<std::shared_ptr<Scorer::BaseMultiSelectScorer>> scorers;
+  if (Cpu::supports_avx2()) {
+    scorers.push_back(std::make_shared<Scorer::SimdMultiSelectScorer>());
+  }
+  if (Cpu::supports_avx512()) {
+    scorers.push_back(std::make_shared<Scorer::SimdAvx512MultiSelectScorer>());
+  }
+
+  // Random single- and multiple-select questions, answered with letters,
+  // bitmasks and blanks
+  std::mt19937 random(7);
+  for (const size_t question_count : {1, 31, 64, 65, 200}) {
+    ByteArray correct_answers(question_count);
+    ByteArray points(question_count);
+    std::vector<QuestionRule> rules(question_count);
+    for (size_t j = 0; j < question_count; ++j) {
+      rules[j] = static_cast<QuestionRule>(random() % 3);
+      correct_answers[j] = rules[j] == QuestionRule::kExact && random() % 2
+                               ? static_cast<int8_t>('A' + random() % 4)
+                               : static_cast<int8_t>(1 + random() % 15);
+      points[j] = static_cast<int8_t>(random() % 256);
+    }
+    const Scorer::MultiSelectKey mixed_key(correct_answers, points, rules);
+
+    ExamBatch exam_batch(50, question_count);
+    for (size_t i = 0; i < exam_batch.exam_count(); ++i) {
+      for (size_t j = 0; j < question_count; ++j) {
+        const uint32_t kind = random() % 4;
+        exam_batch.row(i)[j] =
+            kind == 0   ? correct_answers[j]
+            : kind == 1 ? static_cast<int8_t>('A' + random() % 4)
+            : kind == 2 ? static_cast<int8_t>(random() % 16)
+                        : static_cast<int8_t>(' ');
+      }
+    }
+
+    const auto expected =
+        Scorer::NaiveMultiSelectScorer().score(exam_batch, mixed_key);
+    for (const auto &scorer : scorers) {
+      EXPECT_EQ(scorer->score(exam_batch, mixed_key), expected)
+          << question_count << " questions";
+    }
+  }
+}
+
+TEST(FixedSizeScorerTest, MatchesGenericKernel) {
+  Scorer::FixedSizeScorer fixed_size_scorer;
+
+  // The specialized sizes, and sizes that fall back to the generic kernel
+  for (const size_t question_count : {10, 37, 40, 50, 64, 100, 200}) {
+    const auto correct_answers = generate_correct_answers(question_count, 1);
+    const auto points = generate_points(question_count);
+    const auto exam_batch = generate_exam_batch(45, correct_answers, 2);
+    const auto exams = generate_exams(45, correct_answers, 2);
+    const auto expected =
+        Scorer::NaiveScorer().score(exams, correct_answers, points);
+
+    EXPECT_EQ(fixed_size_scorer.is_specialized(question_count),
+              Cpu::supports_avx512() && question_count % 10 == 0);
+    EXPECT_EQ(fixed_size_scorer.score(exams, correct_answers, points),
+              expected);
+    EXPECT_EQ(fixed_size_scorer.score(exam_batch, correct_answers, points),
+              Scorer::NaiveScorer().score(exam_batch, correct_answers, points));
+    EXPECT_EQ(fixed_size_scorer.score(ExamBatchView(exam_batch),
+                                      ByteArrayView(correct_answers),
+                                      ByteArrayView(points)),
+              Scorer::NaiveScorer().score(exam_batch, correct_answers, points));
+  }
+
+  if (Cpu::supports_avx512()) {
+    EXPECT_THROW(Scorer::SimdAvx512FixedScorer<40>().score(
+                     generate_exam_batch(3, 50), generate_correct_answers(50),
+                     generate_points(50)),
+                 std::runtime_error);
+  }
+}
+
+TEST(SimdScorerCAbiTest, ScoresBorrowedBuffers) {
+  EXPECT_EQ(simd_scorer_abi_version(), SIMD_SCORER_ABI_VERSION);
+
+  simd_scorer *scorer = nullptr;
+  EXPECT_EQ(simd_scorer_create("nonexistent", &scorer),
+            SIMD_SCORER_INVALID_ARGUMENT);
+  EXPECT_EQ(scorer, nullptr);
+  EXPECT_STRNE(simd_scorer_last_error(), "");
+
+  // Rows of 70 answers, 75 bytes apart
+  const auto correct_answers = generate_correct_answers(70, 1);
+  const auto points = generate_points(70);
+  const auto exams = generate_exam_batch(20, correct_answers, 2);
+  std::vector<uint8_t> rows(75 * 20);
+  for (size_t i = 0; i < exams.exam_count(); ++i) {
+    std::copy_n(exams.row(i).data(), 70, rows.data() + i * 75);
+  }
+  const auto expected =
+      Scorer::NaiveScorer().score(exams, correct_answers, points);
+
+  for (const char *kernel : {"best", "parallel", "naive"}) {
+    ASSERT_EQ(simd_scorer_create(kernel, &scorer), SIMD_SCORER_OK) << kernel;
+
+    std::vector<int32_t> scores(20);
+    EXPECT_EQ(simd_scorer_score(
+                  scorer, rows.data(), 20, 70, 75,
+                  reinterpret_cast<const uint8_t *>(correct_answers.data()),
+                  reinterpret_cast<const uint8_t *>(points.data()),
+                  scores.data()),
+              SIMD_SCORER_OK);
+    EXPECT_EQ(scores, expected) << kernel;
+
+    EXPECT_EQ(simd_scorer_score(
+                  scorer, rows.data(), 20, 70, 60,
+                  reinterpret_cast<const uint8_t *>(correct_answers.data()),
+                  reinterpret_cast<const uint8_t *>(points.data()),
+                  scores.data()),
+              SIMD_SCORER_INVALID_ARGUMENT);
+
+    // Points of 128 and more would be negative for the scalar kernels and
+    // positive for the SIMD ones, so every kernel rejects them
+    std::vector<uint8_t> large_points(70, 127);
+    EXPECT_EQ(simd_scorer_score(
+                  scorer, rows.data(), 20, 70, 75,
+                  reinterpret_cast<const uint8_t *>(correct_answers.data()),
+                  large_points.data(), scores.data()),
+              SIMD_SCORER_OK);
+    EXPECT_EQ(scores,
+              Scorer::NaiveScorer().score(exams, correct_answers,
+                                          ByteArray(70, 127)))
+        << kernel;
+    large_points[69] = 200;
+    EXPECT_EQ(simd_scorer_score(
+                  scorer, rows.data(), 20, 70, 75,
+                  reinterpret_cast<const uint8_t *>(correct_answers.data()),
+                  large_points.data(), scores.data()),
+              SIMD_SCORER_INVALID_ARGUMENT)
+        << kernel;
+    simd_scorer_destroy(scorer);
+  }
+}
+
+TEST(AllocationTest, OptionsKeepPaddingZeroedAndScoresUnchanged) {
+  const auto correct_answers = generate_correct_answers(100, 1);
+  const auto points = generate_points(100);
+  const auto reference = generate_exam_batch(500, correct_answers, 2);
+  const auto expected =
+      Scorer::NaiveScorer().score(reference, correct_answers, points);
+
+  std::vector<AllocationOptions> options(5);
+  options[1].zero_fill = false;
+  options[2].huge_pages = true;
+  options[3].numa = NumaPlacement::kInterleave;
+  options[4].numa = NumaPlacement::kParallelFirstTouch;
+  options[4].first_touch_threads = 3;
+
+  for (const auto &option : options) {
+    ExamBatch exams(500, 100, option);
+    for (size_t i = 0; i < exams.exam_count(); ++i) {
+      // Only the answers are overwritten, the padding must already be zero
+      std::copy_n(reference.row(i).data(), 100, exams.row(i).data());
+      EXPECT_TRUE(std::all_of(exams.row(i).data() + 100,
+                              exams.row(i).data() + exams.pitch(),
+                              [](const int8_t &value) { return value == 0; }));
+    }
+    EXPECT_EQ(Scorer::make_best_scorer()->score(exams, correct_answers, points),
+              expected);
+
+    ByteArray key(100, option);
+    std::copy_n(correct_answers.data(), 100, key.data());
+    EXPECT_EQ(std::count(key.data() + 100, key.data() + key.capacity(), 0), 28);
+    // Moves hand over the mapping
+    ByteArray moved = std::move(key);
+    EXPECT_EQ(Scorer::make_best_scorer()->score(exams, moved, points),
+              expected);
+  }
+
+  // The first touch only counts as placed when its threads could be pinned,
+  // which Linux always allows within the process's own CPUs
+  AllocationOptions first_touch;
+  first_touch.numa = NumaPlacement::kParallelFirstTouch;
+  first_touch.first_touch_threads = 3;
+  const auto touched = allocate_buffer(size_t{1} << 20, first_touch);
+#ifdef __linux__
+  EXPECT_TRUE(touched.numa_placed);
 #endif
-}
\ No newline at end of file
+  free_buffer(touched.data, touched.mapped_bytes);
+
+  // Whatever the system supports, huge pages are either from the pool or
+  // advised, or the allocation fell back to regular pages
+  AllocationOptions huge;
+  huge.huge_pages = true;
+  const auto allocation = allocate_buffer(size_t{3} << 20, huge);
+  ASSERT_NE(allocation.data, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(allocation.data) % 64, 0);
+  if (allocation.hugetlb || allocation.transparent_huge_pages) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(allocation.data) % (2 << 20), 0);
+    EXPECT_EQ(allocation.mapped_bytes, size_t{4} << 20);
+  }
+  free_buffer(allocation.data, allocation.mapped_bytes);
+}
+
+TEST(AdaptiveScorerTest, MatchesNaiveScorerAndReusesTheCache) {
+  const auto cache_path =
+      (std::filesystem::temp_directory_path() / "adaptive_scorer_test.cache")
+          .string();
+  std::filesystem::remove(cache_path);
+
+  const std::vector<std::pair<size_t, size_t>> shapes = {
+      {1, 1}, {7, 10}, {45, 63}, {300, 100}, {3000, 200}};
+  {
+    Scorer::AdaptiveScorer adaptive_scorer(cache_path);
+    for (const auto &[exam_count, question_count] : shapes) {
+      EXPECT_FALSE(adaptive_scorer.is_calibrated(exam_count, question_count));
+
+      const auto correct_answers = generate_correct_answers(question_count, 1);
+      const auto points = generate_points(question_count);
+      const auto exam_batch =
+          generate_exam_batch(exam_count, correct_answers, 2);
+      const auto exams = generate_exams(exam_count, correct_answers, 2);
+      const auto expected =
+          Scorer::NaiveScorer().score(exams, correct_answers, points);
+
+      EXPECT_EQ(adaptive_scorer.score(exam_batch, correct_answers, points),
+                expected);
+      EXPECT_TRUE(adaptive_scorer.is_calibrated(exam_count, question_count));
+      EXPECT_EQ(adaptive_scorer.score(exams, correct_answers, points),
+                expected);
+      EXPECT_EQ(adaptive_scorer.score(ExamBatchView(exam_batch),
+                                      ByteArrayView(correct_answers),
+                                      ByteArrayView(points)),
+                expected);
+    }
+  }
+
+  // A new scorer starts from the saved winners, and skips the lines it
+  // can't use
+  std::ofstream(cache_path, std::ios::app) << "0 0 no_such_kernel\nbad\n";
+  Scorer::AdaptiveScorer loaded(cache_path);
+  Scorer::AdaptiveScorer reloaded(cache_path);
+  for (const auto &[exam_count, question_count] : shapes) {
+    EXPECT_TRUE(reloaded.is_calibrated(exam_count, question_count));
+    EXPECT_FALSE(reloaded.kernel_name(exam_count, question_count).empty());
+    EXPECT_EQ(reloaded.kernel_name(exam_count, question_count),
+              loaded.kernel_name(exam_count, question_count));
+  }
+  EXPECT_FALSE(reloaded.is_calibrated(1'000'000, 4096));
+  std::filesystem::remove(cache_path);
+}
+
+TEST(SimilaritySearchTest, MatchesAllPairsComparison) {
+  // One block of 64 questions, two, and more than the kernels keep in
+  // registers
+  for (const size_t question_count : {40, 100, 300}) {
+    const auto correct_answers = generate_correct_answers(question_count, 1);
+    ExamGeneratorOptions generator;
+    generator.blank_rate = 0.05;
+    auto exams = generate_exams(300, correct_answers, 2, generator);
+    // A copied sheet, and one that copied the wrong answers only
+    exams[17] = exams[5];
+    for (size_t j = 0; j < question_count; ++j) {
+      if (exams[42][j] != correct_answers[j]) {
+        exams[200][j] = exams[42][j];
+      }
+    }
+    ExamBatch exam_batch(exams.size(), question_count);
+    for (size_t i = 0; i < exams.size(); ++i) {
+      std::copy_n(exams[i].data(), question_count, exam_batch.row(i).data());
+    }
+    std::vector<uint32_t> groups(exams.size());
+    for (size_t i = 0; i < exams.size(); ++i) {
+      groups[i] = (i * 7) % 3;
+    }
+
+    Scorer::SimilarityOptions options;
+    // Random sheets share about 19% of their answers as the same wrong one
+    options.min_matching_wrong_answers = question_count * 28 / 100;
+    options.max_pairs_per_exam = 3;
+
+    // Every pair compared answer by answer, in the same order
+    const auto expected = [&](const bool &grouped) {
+      std::vector<std::vector<Scorer::SimilarPair>> lists(exams.size());
+      for (uint32_t a = 0; a < exams.size(); ++a) {
+        for (uint32_t b = a + 1; b < exams.size(); ++b) {
+          if (grouped && groups[a] != groups[b]) {
+            continue;
+          }
+          Scorer::SimilarPair pair{a, b, 0, 0};
+          for (size_t j = 0; j < question_count; ++j) {
+            if (exams[a][j] == exams[b][j] && exams[a][j] != ' ') {
+              ++pair.matching_answers;
+              pair.matching_wrong_answers += exams[a][j] != correct_answers[j];
+            }
+          }
+          if (pair.matching_wrong_answers >=
+              options.min_matching_wrong_answers) {
+            lists[a].push_back(pair);
+            lists[b].push_back(pair);
+          }
+        }
+      }
+      for (auto &list : lists) {
+        std::sort(list.begin(), list.end(),
+                  [](const auto &x, const auto &y) {
+                    return x.more_similar_than(y);
+                  });
+        list.resize(std::min(list.size(), options.max_pairs_per_exam));
+      }
+      return lists;
+    };
+
+    Scorer::SimilaritySearch search(options, 3);
+    for (const bool grouped : {false, true}) {
+      const auto lists = expected(grouped);
+      const auto no_groups = std::vector<uint32_t>();
+      const auto &exam_groups = grouped ? groups : no_groups;
+      const auto pairs =
+          search.search(exam_batch, correct_answers, exam_groups);
+      const auto vector_pairs =
+          search.search(exams, correct_answers, exam_groups);
+
+      for (size_t i = 0; i < exams.size(); ++i) {
+        const std::vector<Scorer::SimilarPair> found(pairs.of(i).begin(),
+                                                     pairs.of(i).end());
+        EXPECT_EQ(found, lists[i]) << i;
+        EXPECT_TRUE(std::equal(vector_pairs.of(i).begin(),
+                               vector_pairs.of(i).end(), found.begin(),
+                               found.end()));
+      }
+
+      // The copied sheets are the most similar pairs, unless split up
+      const auto unique = pairs.unique();
+      if (!grouped || groups[5] == groups[17]) {
+        ASSERT_FALSE(unique.empty());
+        EXPECT_EQ(unique[0].first, 5);
+        EXPECT_EQ(unique[0].second, 17);
+      }
+      const bool copied_wrong = !grouped || groups[42] == groups[200];
+      EXPECT_EQ(std::any_of(unique.begin(), unique.end(),
+                            [](const auto &pair) {
+                              return pair.first == 42 && pair.second == 200;
+                            }),
+                copied_wrong);
+    }
+  }
+}
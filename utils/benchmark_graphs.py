@@ -1,80 +1,124 @@
-import sys
-import matplotlib.pyplot as plt
+import argparse
 import json
+import re
+from collections import defaultdict
 from pathlib import Path
 
+import matplotlib.pyplot as plt
+
+# The throughput counters that main_benchmark reports, and how to plot them
+METRICS = {
+    "items": ("items_per_second", "Throughput (exams/s)", 1),
+    "bytes": ("bytes_per_second", "Throughput (GB/s)", 1e9),
+}
+# Positional arguments, for the benchmarks that don't name theirs
+POSITIONAL_ARGS = ["exams", "questions"]
+
+
+def parse_name(name: str):
+    """Split `BM_Family/exams:5000000/questions:200/warm:0` (or the positional
+    `BM_Family/5000000/200`) into the family and its arguments."""
+    parts = name.split("/")
+    family, args = parts[0], {}
+    for i, part in enumerate(parts[1:]):
+        if ":" in part:
+            key, value = part.split(":", 1)
+        elif re.fullmatch(r"-?\d+", part) and i < len(POSITIONAL_ARGS):
+            key, value = POSITIONAL_ARGS[i], part
+        else:
+            # e.g. the real_time suffix added by the library
+            continue
+        if re.fullmatch(r"-?\d+", value):
+            args[key] = int(value)
+    return family, args
+
 
-def render_benchmarks_in_dir(dir_path: str):
+def throughput(benchmark: dict, metric: str, args: dict):
+    counter, _, scale = METRICS[metric]
+    if counter in benchmark:
+        return benchmark[counter] / scale
+
+    # Older results have no counters: derive them from the time and the shape
+    if "exams" not in args or "questions" not in args:
+        return None
+    seconds = benchmark["real_time"] * {
+        "ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1
+    }[benchmark.get("time_unit", "ns")]
+    processed = args["exams"] * (args["questions"] if metric == "bytes" else 1)
+    return processed / seconds / scale
+
+
+def render_benchmarks_in_dir(dir_path: str, metric: str, family_filter: str):
     dir = Path(dir_path)
     for file_path in dir.glob('*.json'):
-        render_graphs(file_path)
+        render_graphs(file_path, metric, family_filter)
 
 
-def render_graphs(file_path: Path):
-    file = file_path.open(mode='r')
+def render_graphs(file_path: Path, metric: str, family_filter: str):
     file_name = file_path.name
-    data = json.load(file)
-    benchmarks = data["benchmarks"]
+    with file_path.open(mode='r') as file:
+        data = json.load(file)
 
-    exam_nums = [100_000, 5_000_000, 10_000_000]
-    mcq_nums = [10, 100, 200]
+    # figures[(exams, other args)][family] = [(questions, throughput)]
+    figures = defaultdict(lambda: defaultdict(list))
+    for benchmark in data["benchmarks"]:
+        # Skip the mean/median/stddev of the repetitions, and the skipped runs
+        if benchmark.get("run_type") == "aggregate" or benchmark.get(
+                "error_occurred"):
+            continue
 
-    benchmarks_dict = {}
-    for benchmark in benchmarks:
-        benchmarks_dict[benchmark["name"]] = benchmark["real_time"]
+        family, args = parse_name(benchmark["name"])
+        if "questions" not in args or not re.search(family_filter, family):
+            continue
+        value = throughput(benchmark, metric, args)
+        if value is None:
+            continue
 
-    for exam_num in exam_nums:
+        others = tuple(sorted((key, arg) for key, arg in args.items()
+                              if key not in ("exams", "questions")))
+        figures[(args.get("exams"), others)][family].append(
+            (args["questions"], value))
+
+    _, y_label, _ = METRICS[metric]
+    for (exam_num, others), families in sorted(
+            figures.items(), key=lambda item: (item[0][0] or 0, item[0][1])):
         # The figure size will be 1280x720
         fig, ax = plt.subplots(figsize=(12.8, 7.2), dpi=100)
-        naive_val = [
-            benchmarks_dict[f'BM_NaiveScorer/{exam_num}/10'],
-            benchmarks_dict[f'BM_NaiveScorer/{exam_num}/100'],
-            benchmarks_dict[f'BM_NaiveScorer/{exam_num}/200'],
-        ]
-        boolean_mul_val = [
-            benchmarks_dict[f'BM_BooleanMultiplicationScorer/{exam_num}/10'],
-            benchmarks_dict[f'BM_BooleanMultiplicationScorer/{exam_num}/100'],
-            benchmarks_dict[f'BM_BooleanMultiplicationScorer/{exam_num}/200'],
-        ]
-        simd_val = [
-            benchmarks_dict[f'BM_SimdScorer/{exam_num}/10'],
-            benchmarks_dict[f'BM_SimdScorer/{exam_num}/100'],
-            benchmarks_dict[f'BM_SimdScorer/{exam_num}/200'],
-        ]
-        simd_avx512_val = [
-            benchmarks_dict[f'BM_SimdAvx512Scorer/{exam_num}/10'],
-            benchmarks_dict[f'BM_SimdAvx512Scorer/{exam_num}/100'],
-            benchmarks_dict[f'BM_SimdAvx512Scorer/{exam_num}/200'],
-        ]
-
-        ax.plot(mcq_nums, naive_val, 'o-', label="Naive")
-        ax.plot(mcq_nums, boolean_mul_val, 'o-', label="Boolean Multiplication")
-        ax.plot(mcq_nums, simd_val, 'o-', label="SIMD AVX2")
-        ax.plot(mcq_nums, simd_avx512_val, 'o-', label="SIMD AVX512")
-
-        # Display the value above every data point
-        for x, y in zip(mcq_nums, naive_val):
-            ax.text(x, y - 25, f"{int(y)}", ha="center")
-        for x, y in zip(mcq_nums, boolean_mul_val):
-            ax.text(x, y + 25, f"{int(y)}", ha="center")
-        for x, y in zip(mcq_nums, simd_val):
-            ax.text(x, y - 25, f"{int(y)}", ha="center")
-        for x, y in zip(mcq_nums, simd_avx512_val):
-            ax.text(x, y + 25, f"{int(y)}", ha="center")
-
-        ax.set_title(f"Scoring time for {exam_num} exams\nBenchmark: {file_name}")
+
+        mcq_nums = set()
+        for family, points in sorted(families.items()):
+            points.sort()
+            xs = [x for x, _ in points]
+            ys = [y for _, y in points]
+            mcq_nums.update(xs)
+            ax.plot(xs, ys, 'o-', label=family.removeprefix("BM_"))
+
+        suffix = "".join(f"_{key}{value}" for key, value in others)
+        details = ", ".join(f"{key}={value}" for key, value in others)
+        ax.set_title(f"Throughput for {exam_num} exams"
+                     f"{' (' + details + ')' if details else ''}\n"
+                     f"Benchmark: {file_name}")
         ax.set_xlabel("Number of MCQs")
-        ax.set_xticks(mcq_nums)
-        ax.set_ylabel("Time (ms)")
-        ax.legend()
+        # The sweep goes from 1 to 4096 questions
+        ax.set_xscale("log", base=2)
+        ax.set_xticks(sorted(mcq_nums))
+        ax.set_xticklabels([str(x) for x in sorted(mcq_nums)])
+        ax.set_ylabel(y_label)
+        ax.legend(fontsize="small")
         ax.grid(True)
 
-        plt.savefig(f"graphs/{file_name}_{exam_num}.png")
-        plt.clf()
+        plt.savefig(f"graphs/{file_name}_{exam_num}{suffix}.png")
+        plt.close(fig)
 
 
 if __name__ == "__main__":
-    if len(sys.argv) <= 1:
-        print("Usage: benchmark_graphs.py <directory>")
-        sys.exit(1)
-    render_benchmarks_in_dir(sys.argv[1])
+    parser = argparse.ArgumentParser(
+        description="Plot the throughput of the benchmarks of every JSON "
+        "result in a directory, against the number of questions.")
+    parser.add_argument("directory")
+    parser.add_argument("--metric", choices=METRICS, default="bytes",
+                        help="plot the answers' GB/s or the exams/s")
+    parser.add_argument("--filter", default="",
+                        help="only plot the families matching this regex")
+    args = parser.parse_args()
+    render_benchmarks_in_dir(args.directory, args.metric, args.filter)